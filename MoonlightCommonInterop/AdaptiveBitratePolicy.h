@@ -0,0 +1,46 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Tuning for the adaptive bitrate controller. Bitrates are in Kbps, and zero
+			// leaves a setting at its default.
+			public ref class AdaptiveBitratePolicy sealed
+			{
+			public:
+				// Defaults to a quarter of StreamConfiguration::Bitrate
+				property int MinimumBitrate;
+
+				// Defaults to StreamConfiguration::Bitrate
+				property int MaximumBitrate;
+
+				// Defaults to 10
+				property int StepUpPercent;
+
+				// Defaults to 25
+				property int StepDownPercent;
+
+				// Frames lost in transit, defaults to 2
+				property double LossPercentThreshold;
+
+				// Interarrival jitter of reassembled frames, defaults to half a frame interval
+				property int JitterThresholdUs;
+
+				// Renderer time per frame as a share of the frame interval, defaults to 80
+				property int DecodeTimePercentThreshold;
+
+				// Length of each evaluation window, defaults to 2000
+				property int WindowMs;
+
+				// Clean windows in a row before stepping up, defaults to 10
+				property int StepUpWindows;
+
+				// Congested windows in a row before stepping down, defaults to 2
+				property int StepDownWindows;
+			};
+		}
+	}
+}
@@ -0,0 +1,265 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "Clock.h"
+#include "AsyncLogger.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define RATE_LIMIT_WINDOW_US 1000000
+#define RATE_LIMIT_MESSAGES_PER_WINDOW 20
+
+// The logging thread also wakes up this often on its own, since producers
+// signal it without taking the lock and a wakeup can occasionally be missed.
+#define LOG_THREAD_POLL_INTERVAL_MS 20
+
+AsyncLogger::AsyncLogger(INativeConnectionListener* listener)
+	: m_Listener(listener),
+	m_MinimumSeverity(LogSeverityVerbose),
+	m_EnqueuePosition(0),
+	m_DequeuePosition(0),
+	m_Stopping(false),
+	m_MessagesLogged(0),
+	m_MessagesSuppressed(0),
+	m_MessagesDropped(0)
+{
+	for (int i = 0; i < ASYNC_LOG_SLOT_COUNT; i++)
+	{
+		m_Slots[i].Sequence = i;
+	}
+
+	for (int i = 0; i < ASYNC_LOG_CALL_SITE_COUNT; i++)
+	{
+		m_CallSites[i].Format = NULL;
+		m_CallSites[i].Severity = LogSeverityInfo;
+		m_CallSites[i].WindowStartUs = 0;
+		m_CallSites[i].WindowCount = 0;
+		m_CallSites[i].Suppressed = 0;
+	}
+}
+
+AsyncLogger::~AsyncLogger()
+{
+	Stop();
+}
+
+void AsyncLogger::Start(LogSeverity minimumSeverity)
+{
+	if (m_Thread.joinable())
+	{
+		return;
+	}
+
+	m_MinimumSeverity = minimumSeverity;
+	m_Stopping = false;
+	m_Thread = std::thread(&AsyncLogger::ThreadProc, this);
+}
+
+void AsyncLogger::Stop()
+{
+	if (!m_Thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_WaitLock);
+		m_Stopping = true;
+	}
+	m_WaitCondition.notify_one();
+	m_Thread.join();
+}
+
+LogSeverity AsyncLogger::ClassifyMessage(const char* format)
+{
+	// moonlight-common-c doesn't tag its log lines, but its errors and
+	// warnings consistently say so in the text.
+	static const char* const s_ErrorWords[] = { "error", "Error", "failed", "Failed", "FAILED" };
+	static const char* const s_WarningWords[] = { "warning", "Warning", "lost", "Lost", "timed out", "Timed out" };
+
+	for (const char* word : s_ErrorWords)
+	{
+		if (strstr(format, word) != NULL)
+		{
+			return LogSeverityError;
+		}
+	}
+
+	for (const char* word : s_WarningWords)
+	{
+		if (strstr(format, word) != NULL)
+		{
+			return LogSeverityWarning;
+		}
+	}
+
+	return LogSeverityInfo;
+}
+
+AsyncLogger::CallSite* AsyncLogger::FindCallSite(const char* format)
+{
+	// Open addressing on the format pointer. A full table just means the
+	// remaining call sites go unlimited.
+	size_t hash = ((uintptr_t)format >> 3) * 2654435761u;
+	for (int probe = 0; probe < ASYNC_LOG_CALL_SITE_COUNT; probe++)
+	{
+		CallSite* callSite = &m_CallSites[(hash + probe) % ASYNC_LOG_CALL_SITE_COUNT];
+		const char* existing = callSite->Format.load(std::memory_order_acquire);
+		if (existing == format)
+		{
+			return callSite;
+		}
+
+		if (existing == NULL)
+		{
+			// Another thread can find the entry before its severity is set and log one
+			// message at the default severity, which is harmless.
+			const char* expected = NULL;
+			LogSeverity severity = ClassifyMessage(format);
+			if (callSite->Format.compare_exchange_strong(expected, format, std::memory_order_acq_rel))
+			{
+				callSite->Severity.store(severity, std::memory_order_relaxed);
+				return callSite;
+			}
+			if (expected == format)
+			{
+				return callSite;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+bool AsyncLogger::ShouldLog(CallSite* callSite)
+{
+	long long nowUs = GetTimeMicroseconds();
+	long long windowStartUs = callSite->WindowStartUs.load(std::memory_order_relaxed);
+	if (nowUs - windowStartUs >= RATE_LIMIT_WINDOW_US &&
+		callSite->WindowStartUs.compare_exchange_strong(windowStartUs, nowUs, std::memory_order_relaxed))
+	{
+		callSite->WindowCount = 0;
+
+		int suppressed = callSite->Suppressed.exchange(0);
+		if (suppressed > 0)
+		{
+			EnqueueString("Suppressed %d similar messages: %.64s", suppressed, callSite->Format.load(std::memory_order_relaxed));
+		}
+	}
+
+	if (callSite->WindowCount.fetch_add(1, std::memory_order_relaxed) >= RATE_LIMIT_MESSAGES_PER_WINDOW)
+	{
+		callSite->Suppressed++;
+		m_MessagesSuppressed++;
+		return false;
+	}
+
+	return true;
+}
+
+void AsyncLogger::Log(const char* format, va_list args)
+{
+	CallSite* callSite = FindCallSite(format);
+	if (callSite != NULL)
+	{
+		if (callSite->Severity.load(std::memory_order_relaxed) < m_MinimumSeverity || !ShouldLog(callSite))
+		{
+			return;
+		}
+	}
+
+	Enqueue(format, args);
+}
+
+void AsyncLogger::EnqueueString(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	Enqueue(format, args);
+	va_end(args);
+}
+
+void AsyncLogger::Enqueue(const char* format, va_list args)
+{
+	// Bounded multi-producer queue: each slot's sequence number says whether it's
+	// free for the producer claiming this position or still holds an older message.
+	unsigned long long position = m_EnqueuePosition.load(std::memory_order_relaxed);
+	LogSlot* slot;
+	for (;;)
+	{
+		slot = &m_Slots[position % ASYNC_LOG_SLOT_COUNT];
+		unsigned long long sequence = slot->Sequence.load(std::memory_order_acquire);
+		long long difference = (long long)(sequence - position);
+		if (difference == 0)
+		{
+			if (m_EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// The logging thread hasn't caught up, so drop rather than wait
+			m_MessagesDropped++;
+			return;
+		}
+		else
+		{
+			position = m_EnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	vsnprintf(slot->Message, ASYNC_LOG_MESSAGE_SIZE, format, args);
+	slot->Sequence.store(position + 1, std::memory_order_release);
+	m_MessagesLogged++;
+
+	m_WaitCondition.notify_one();
+}
+
+bool AsyncLogger::Drain()
+{
+	bool delivered = false;
+	for (;;)
+	{
+		LogSlot* slot = &m_Slots[m_DequeuePosition % ASYNC_LOG_SLOT_COUNT];
+		if (slot->Sequence.load(std::memory_order_acquire) != m_DequeuePosition + 1)
+		{
+			return delivered;
+		}
+
+		m_Listener->LogMessage(slot->Message);
+		delivered = true;
+
+		slot->Sequence.store(m_DequeuePosition + ASYNC_LOG_SLOT_COUNT, std::memory_order_release);
+		m_DequeuePosition++;
+	}
+}
+
+void AsyncLogger::ThreadProc()
+{
+	while (!m_Stopping)
+	{
+		if (!Drain())
+		{
+			std::unique_lock<std::mutex> lock(m_WaitLock);
+			m_WaitCondition.wait_for(lock, std::chrono::milliseconds(LOG_THREAD_POLL_INTERVAL_MS));
+		}
+	}
+
+	Drain();
+}
+
+long long AsyncLogger::GetMessagesLogged() const
+{
+	return m_MessagesLogged;
+}
+
+long long AsyncLogger::GetMessagesSuppressed() const
+{
+	return m_MessagesSuppressed;
+}
+
+long long AsyncLogger::GetMessagesDropped() const
+{
+	return m_MessagesDropped;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdarg.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "SessionInterfaces.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			enum LogSeverity
+			{
+				LogSeverityVerbose,
+				LogSeverityInfo,
+				LogSeverityWarning,
+				LogSeverityError,
+			};
+
+			#define ASYNC_LOG_SLOT_COUNT 128
+			#define ASYNC_LOG_MESSAGE_SIZE 1024
+			#define ASYNC_LOG_CALL_SITE_COUNT 256
+
+			// Takes log messages off the moonlight-common-c threads. The caller formats
+			// into a preallocated ring slot (a va_list can't outlive the call, since %s
+			// arguments often point at the caller's stack) and a background thread hands
+			// the finished messages to the connection listener. Logging never allocates
+			// or blocks. When the ring is full, messages are dropped and counted.
+			//
+			// Each call site, identified by its format string pointer, may log a limited
+			// number of messages per second. The excess is suppressed before it's even
+			// formatted, and one summary line is emitted when the window rolls over.
+			class AsyncLogger
+			{
+			public:
+				AsyncLogger(INativeConnectionListener* listener);
+				~AsyncLogger();
+
+				void Start(LogSeverity minimumSeverity);
+
+				// Delivers everything already queued before returning
+				void Stop();
+
+				// Safe to call from any number of threads at once
+				void Log(const char* format, va_list args);
+
+				long long GetMessagesLogged() const;
+
+				long long GetMessagesSuppressed() const;
+
+				long long GetMessagesDropped() const;
+
+			private:
+				AsyncLogger(const AsyncLogger&) = delete;
+				AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+				struct LogSlot
+				{
+					std::atomic<unsigned long long> Sequence;
+					char Message[ASYNC_LOG_MESSAGE_SIZE];
+				};
+
+				struct CallSite
+				{
+					std::atomic<const char*> Format;
+					std::atomic<int> Severity;
+					std::atomic<long long> WindowStartUs;
+					std::atomic<int> WindowCount;
+					std::atomic<int> Suppressed;
+				};
+
+				CallSite* FindCallSite(const char* format);
+
+				bool ShouldLog(CallSite* callSite);
+
+				void Enqueue(const char* format, va_list args);
+
+				void EnqueueString(const char* format, ...);
+
+				void ThreadProc();
+
+				bool Drain();
+
+				static LogSeverity ClassifyMessage(const char* format);
+
+				INativeConnectionListener* m_Listener;
+				LogSeverity m_MinimumSeverity;
+
+				LogSlot m_Slots[ASYNC_LOG_SLOT_COUNT];
+				std::atomic<unsigned long long> m_EnqueuePosition;
+				unsigned long long m_DequeuePosition;
+
+				CallSite m_CallSites[ASYNC_LOG_CALL_SITE_COUNT];
+
+				std::mutex m_WaitLock;
+				std::condition_variable m_WaitCondition;
+				std::atomic<bool> m_Stopping;
+				std::thread m_Thread;
+
+				std::atomic<long long> m_MessagesLogged;
+				std::atomic<long long> m_MessagesSuppressed;
+				std::atomic<long long> m_MessagesDropped;
+			};
+		}
+	}
+}
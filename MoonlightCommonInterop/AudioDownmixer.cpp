@@ -0,0 +1,228 @@
+#include <string.h>
+#include "CpuFeatures.h"
+#include "AudioDownmixer.h"
+
+#if defined(INTEROP_ARCH_X86)
+#include <immintrin.h>
+#elif defined(INTEROP_ARCH_ARM)
+#include <arm_neon.h>
+#endif
+
+using namespace Moonlight::Xbox::Interop;
+
+// -3 dB, the ITU-R BS.775 gain for centre and surround channels
+#define MINUS_3DB 0.70710678f
+
+static void DownmixScalar(const float* input, float* output, int sampleFrames, int inputChannelCount, const float* matrix)
+{
+	const float* leftRow = matrix;
+	const float* rightRow = matrix + DOWNMIX_MAX_INPUT_CHANNELS;
+
+	for (int i = 0; i < sampleFrames; i++)
+	{
+		const float* frame = &input[i * inputChannelCount];
+		float left = 0;
+		float right = 0;
+		for (int channel = 0; channel < inputChannelCount; channel++)
+		{
+			left += frame[channel] * leftRow[channel];
+			right += frame[channel] * rightRow[channel];
+		}
+
+		output[i * 2] = left;
+		output[i * 2 + 1] = right;
+	}
+}
+
+// The vector kernels load DOWNMIX_MAX_INPUT_CHANNELS samples starting at each frame.
+// With fewer input channels that runs into the next frame, which the zero padding in
+// the matrix cancels out, but it means the last few frames have to be done separately
+// to avoid reading past the end of the input.
+static int GetVectorFrameCount(int sampleFrames, int inputChannelCount)
+{
+	int overread = DOWNMIX_MAX_INPUT_CHANNELS - inputChannelCount;
+	int tailFrames = (overread + inputChannelCount - 1) / inputChannelCount;
+	return sampleFrames > tailFrames ? sampleFrames - tailFrames : 0;
+}
+
+#if defined(INTEROP_ARCH_X86)
+
+static void DownmixSse2(const float* input, float* output, int sampleFrames, int inputChannelCount, const float* matrix)
+{
+	const __m128 leftLow = _mm_loadu_ps(&matrix[0]);
+	const __m128 leftHigh = _mm_loadu_ps(&matrix[4]);
+	const __m128 rightLow = _mm_loadu_ps(&matrix[DOWNMIX_MAX_INPUT_CHANNELS]);
+	const __m128 rightHigh = _mm_loadu_ps(&matrix[DOWNMIX_MAX_INPUT_CHANNELS + 4]);
+
+	int vectorFrames = GetVectorFrameCount(sampleFrames, inputChannelCount);
+	int i = 0;
+	for (; i < vectorFrames; i++)
+	{
+		const float* frame = &input[i * inputChannelCount];
+		__m128 low = _mm_loadu_ps(frame);
+		__m128 high = _mm_loadu_ps(frame + 4);
+
+		__m128 left = _mm_add_ps(_mm_mul_ps(low, leftLow), _mm_mul_ps(high, leftHigh));
+		__m128 right = _mm_add_ps(_mm_mul_ps(low, rightLow), _mm_mul_ps(high, rightHigh));
+
+		// Reduce both accumulators at once: [l0+l2, r0+r2, l1+l3, r1+r3], then fold the halves
+		__m128 sums = _mm_add_ps(_mm_unpacklo_ps(left, right), _mm_unpackhi_ps(left, right));
+		sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+		_mm_storel_pi((__m64*)&output[i * 2], sums);
+	}
+
+	DownmixScalar(&input[i * inputChannelCount], &output[i * 2], sampleFrames - i, inputChannelCount, matrix);
+}
+
+INTEROP_TARGET_AVX2
+static void DownmixAvx2(const float* input, float* output, int sampleFrames, int inputChannelCount, const float* matrix)
+{
+	const __m256 leftRow = _mm256_loadu_ps(&matrix[0]);
+	const __m256 rightRow = _mm256_loadu_ps(&matrix[DOWNMIX_MAX_INPUT_CHANNELS]);
+
+	int vectorFrames = GetVectorFrameCount(sampleFrames, inputChannelCount);
+	int i = 0;
+	for (; i < vectorFrames; i++)
+	{
+		__m256 frame = _mm256_loadu_ps(&input[i * inputChannelCount]);
+		__m256 left = _mm256_mul_ps(frame, leftRow);
+		__m256 right = _mm256_mul_ps(frame, rightRow);
+
+		__m128 leftHalves = _mm_add_ps(_mm256_castps256_ps128(left), _mm256_extractf128_ps(left, 1));
+		__m128 rightHalves = _mm_add_ps(_mm256_castps256_ps128(right), _mm256_extractf128_ps(right, 1));
+
+		__m128 sums = _mm_add_ps(_mm_unpacklo_ps(leftHalves, rightHalves), _mm_unpackhi_ps(leftHalves, rightHalves));
+		sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+		_mm_storel_pi((__m64*)&output[i * 2], sums);
+	}
+
+	DownmixScalar(&input[i * inputChannelCount], &output[i * 2], sampleFrames - i, inputChannelCount, matrix);
+}
+
+#elif defined(INTEROP_ARCH_ARM)
+
+static void DownmixNeon(const float* input, float* output, int sampleFrames, int inputChannelCount, const float* matrix)
+{
+	const float32x4_t leftLow = vld1q_f32(&matrix[0]);
+	const float32x4_t leftHigh = vld1q_f32(&matrix[4]);
+	const float32x4_t rightLow = vld1q_f32(&matrix[DOWNMIX_MAX_INPUT_CHANNELS]);
+	const float32x4_t rightHigh = vld1q_f32(&matrix[DOWNMIX_MAX_INPUT_CHANNELS + 4]);
+
+	int vectorFrames = GetVectorFrameCount(sampleFrames, inputChannelCount);
+	int i = 0;
+	for (; i < vectorFrames; i++)
+	{
+		const float* frame = &input[i * inputChannelCount];
+		float32x4_t low = vld1q_f32(frame);
+		float32x4_t high = vld1q_f32(frame + 4);
+
+		float32x4_t left = vmlaq_f32(vmulq_f32(low, leftLow), high, leftHigh);
+		float32x4_t right = vmlaq_f32(vmulq_f32(low, rightLow), high, rightHigh);
+
+		// Pairwise adds leave [l0+l1+l2+l3, r0+r1+r2+r3]
+		float32x2_t leftPairs = vpadd_f32(vget_low_f32(left), vget_high_f32(left));
+		float32x2_t rightPairs = vpadd_f32(vget_low_f32(right), vget_high_f32(right));
+		vst1_f32(&output[i * 2], vpadd_f32(leftPairs, rightPairs));
+	}
+
+	DownmixScalar(&input[i * inputChannelCount], &output[i * 2], sampleFrames - i, inputChannelCount, matrix);
+}
+
+#endif
+
+AudioDownmixer::AudioDownmixer()
+	: m_InputChannelCount(0),
+	m_Kernel(DownmixScalar)
+{
+	memset(m_Matrix, 0, sizeof(m_Matrix));
+}
+
+bool AudioDownmixer::Initialize(int inputChannelCount, const float* matrix)
+{
+	if (inputChannelCount <= 0 || inputChannelCount > DOWNMIX_MAX_INPUT_CHANNELS)
+	{
+		return false;
+	}
+
+	float defaultMatrix[DOWNMIX_OUTPUT_CHANNELS * DOWNMIX_MAX_INPUT_CHANNELS];
+	if (matrix == NULL)
+	{
+		if (!GetDefaultMatrix(inputChannelCount, defaultMatrix))
+		{
+			return false;
+		}
+		matrix = defaultMatrix;
+	}
+
+	memset(m_Matrix, 0, sizeof(m_Matrix));
+	for (int row = 0; row < DOWNMIX_OUTPUT_CHANNELS; row++)
+	{
+		memcpy(&m_Matrix[row * DOWNMIX_MAX_INPUT_CHANNELS], &matrix[row * inputChannelCount], inputChannelCount * sizeof(float));
+	}
+	m_InputChannelCount = inputChannelCount;
+
+	const CpuFeatures& features = GetCpuFeatures();
+	m_Kernel = DownmixScalar;
+#if defined(INTEROP_ARCH_X86)
+	if (features.Avx2)
+	{
+		m_Kernel = DownmixAvx2;
+	}
+	else if (features.Sse2)
+	{
+		m_Kernel = DownmixSse2;
+	}
+#elif defined(INTEROP_ARCH_ARM)
+	if (features.Neon)
+	{
+		m_Kernel = DownmixNeon;
+	}
+#else
+	(void)features;
+#endif
+
+	return true;
+}
+
+void AudioDownmixer::Process(const float* input, float* output, int sampleFrames) const
+{
+	m_Kernel(input, output, sampleFrames, m_InputChannelCount, m_Matrix);
+}
+
+void AudioDownmixer::ProcessScalar(const float* input, float* output, int sampleFrames) const
+{
+	DownmixScalar(input, output, sampleFrames, m_InputChannelCount, m_Matrix);
+}
+
+int AudioDownmixer::GetInputChannelCount() const
+{
+	return m_InputChannelCount;
+}
+
+bool AudioDownmixer::GetDefaultMatrix(int inputChannelCount, float* matrix)
+{
+	// Gains of each input channel on the left output. The right output mirrors it.
+	static const float s_LeftGains[DOWNMIX_MAX_INPUT_CHANNELS] = { 1.0f, 0.0f, MINUS_3DB, 0.0f, MINUS_3DB, 0.0f, MINUS_3DB, 0.0f };
+	static const float s_RightGains[DOWNMIX_MAX_INPUT_CHANNELS] = { 0.0f, 1.0f, MINUS_3DB, 0.0f, 0.0f, MINUS_3DB, 0.0f, MINUS_3DB };
+
+	if (inputChannelCount != 6 && inputChannelCount != 8)
+	{
+		return false;
+	}
+
+	float leftSum = 0;
+	float rightSum = 0;
+	for (int channel = 0; channel < inputChannelCount; channel++)
+	{
+		leftSum += s_LeftGains[channel];
+		rightSum += s_RightGains[channel];
+	}
+
+	for (int channel = 0; channel < inputChannelCount; channel++)
+	{
+		matrix[channel] = s_LeftGains[channel] / leftSum;
+		matrix[inputChannelCount + channel] = s_RightGains[channel] / rightSum;
+	}
+
+	return true;
+}
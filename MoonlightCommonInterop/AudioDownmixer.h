@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			#define DOWNMIX_MAX_INPUT_CHANNELS 8
+			#define DOWNMIX_OUTPUT_CHANNELS 2
+
+			// Mixes interleaved surround float PCM down to stereo through a 2xN matrix.
+			// Row 0 of the matrix produces the left channel and row 1 the right, with one
+			// coefficient per input channel in the stream's channel order (FL, FR, FC,
+			// LFE, BL, BR, SL, SR). The fastest kernel the CPU supports is picked when
+			// the downmixer is initialized.
+			class AudioDownmixer
+			{
+			public:
+				AudioDownmixer();
+
+				// Passing NULL for the matrix selects the default from GetDefaultMatrix
+				bool Initialize(int inputChannelCount, const float* matrix);
+
+				void Process(const float* input, float* output, int sampleFrames) const;
+
+				// Same as Process, but always with the portable kernel, for comparing
+				// against the vector ones
+				void ProcessScalar(const float* input, float* output, int sampleFrames) const;
+
+				int GetInputChannelCount() const;
+
+				// ITU-R BS.775 coefficients with the LFE channel dropped, scaled so that a
+				// full scale signal on every input can't clip either output.
+				static bool GetDefaultMatrix(int inputChannelCount, float* matrix);
+
+			private:
+				typedef void (*DownmixKernel)(const float* input, float* output, int sampleFrames, int inputChannelCount, const float* matrix);
+
+				int m_InputChannelCount;
+
+				// Each row zero padded to DOWNMIX_MAX_INPUT_CHANNELS so the vector kernels
+				// can treat every frame as a fixed-width vector.
+				float m_Matrix[DOWNMIX_OUTPUT_CHANNELS * DOWNMIX_MAX_INPUT_CHANNELS];
+
+				DownmixKernel m_Kernel;
+			};
+		}
+	}
+}
@@ -0,0 +1,318 @@
+#include <string.h>
+#include "Clock.h"
+#include "AudioJitterBuffer.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Never hold more than this much audio, however bad the jitter gets
+#define MAX_JITTER_BUFFER_MS 250
+
+// How many multiples of the measured jitter to keep buffered
+#define JITTER_HEADROOM_MULTIPLIER 4
+
+// Largest speed change used to converge on the target depth, in parts per thousand
+#define MAX_STRETCH_PER_MILLE 20
+
+// RFC 3550 style smoothing factor for the interarrival jitter estimate
+#define JITTER_SMOOTHING_FACTOR 16.0
+
+AudioJitterBuffer::AudioJitterBuffer()
+	: m_CapacityFrames(0),
+	m_ReadFrame(0),
+	m_DepthFrames(0),
+	m_Primed(false),
+	m_ChannelCount(0),
+	m_SampleRate(0),
+	m_SamplesPerFrame(0),
+	m_TargetLatencyFrames(0),
+	m_LastArrivalUs(0),
+	m_LastWriteDurationUs(0),
+	m_JitterUs(0),
+	m_DepthMs(0),
+	m_TargetDepthMs(0),
+	m_Underruns(0),
+	m_Overruns(0),
+	m_SamplesDropped(0),
+	m_SamplesInserted(0)
+{
+}
+
+bool AudioJitterBuffer::Initialize(int channelCount, int sampleRate, int samplesPerFrame, int targetLatencyMs)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_ChannelCount = channelCount;
+	m_SampleRate = sampleRate;
+	m_SamplesPerFrame = samplesPerFrame;
+	m_TargetLatencyFrames = sampleRate * targetLatencyMs / 1000;
+	m_CapacityFrames = sampleRate * MAX_JITTER_BUFFER_MS / 1000;
+	if (m_CapacityFrames < m_TargetLatencyFrames + 2 * samplesPerFrame)
+	{
+		m_CapacityFrames = m_TargetLatencyFrames + 2 * samplesPerFrame;
+	}
+
+	m_Samples.assign((size_t)m_CapacityFrames * channelCount, 0);
+	m_StretchBuffer.assign((size_t)(samplesPerFrame * 2 + 1) * channelCount, 0);
+	m_ReadFrame = 0;
+	m_DepthFrames = 0;
+	m_Primed = false;
+	m_LastArrivalUs = 0;
+	m_LastWriteDurationUs = 0;
+	m_JitterUs = 0;
+
+	m_DepthMs = 0;
+	m_TargetDepthMs = targetLatencyMs;
+	m_Underruns = 0;
+	m_Overruns = 0;
+	m_SamplesDropped = 0;
+	m_SamplesInserted = 0;
+
+	return true;
+}
+
+void AudioJitterBuffer::Cleanup()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_Samples.clear();
+	m_Samples.shrink_to_fit();
+	m_StretchBuffer.clear();
+	m_StretchBuffer.shrink_to_fit();
+	m_CapacityFrames = 0;
+	m_DepthFrames = 0;
+}
+
+void AudioJitterBuffer::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_ReadFrame = 0;
+	m_DepthFrames = 0;
+	m_Primed = false;
+	m_LastArrivalUs = 0;
+	m_LastWriteDurationUs = 0;
+	m_JitterUs = 0;
+	m_DepthMs = 0;
+}
+
+int AudioJitterBuffer::GetTargetDepthFrames() const
+{
+	int jitterFrames = (int)(m_JitterUs * JITTER_HEADROOM_MULTIPLIER * m_SampleRate / 1000000);
+	int target = m_SamplesPerFrame + jitterFrames;
+	if (target < m_TargetLatencyFrames)
+	{
+		target = m_TargetLatencyFrames;
+	}
+
+	// Leave room for at least one packet to land on top of the target
+	if (target > m_CapacityFrames - m_SamplesPerFrame)
+	{
+		target = m_CapacityFrames - m_SamplesPerFrame;
+	}
+
+	return target;
+}
+
+void AudioJitterBuffer::Write(const float* samples, int sampleFrames)
+{
+	long long nowUs = GetTimeMicroseconds();
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (m_CapacityFrames == 0)
+	{
+		return;
+	}
+
+	if (m_LastArrivalUs != 0)
+	{
+		// Compare the gap since the last write with how much audio that write carried
+		double deviationUs = (double)(nowUs - m_LastArrivalUs - m_LastWriteDurationUs);
+		if (deviationUs < 0)
+		{
+			deviationUs = -deviationUs;
+		}
+		m_JitterUs += (deviationUs - m_JitterUs) / JITTER_SMOOTHING_FACTOR;
+	}
+	m_LastArrivalUs = nowUs;
+	m_LastWriteDurationUs = (long long)sampleFrames * 1000000 / m_SampleRate;
+
+	// On overrun, discard the oldest audio to make room
+	int overflow = m_DepthFrames + sampleFrames - m_CapacityFrames;
+	if (overflow > 0)
+	{
+		m_Overruns++;
+		m_ReadFrame = (m_ReadFrame + overflow) % m_CapacityFrames;
+		m_DepthFrames -= overflow;
+	}
+
+	int writeFrame = (m_ReadFrame + m_DepthFrames) % m_CapacityFrames;
+	int firstChunk = m_CapacityFrames - writeFrame;
+	if (firstChunk > sampleFrames)
+	{
+		firstChunk = sampleFrames;
+	}
+
+	memcpy(&m_Samples[(size_t)writeFrame * m_ChannelCount], samples, (size_t)firstChunk * m_ChannelCount * sizeof(float));
+	if (firstChunk < sampleFrames)
+	{
+		memcpy(&m_Samples[0], &samples[firstChunk * m_ChannelCount], (size_t)(sampleFrames - firstChunk) * m_ChannelCount * sizeof(float));
+	}
+
+	m_DepthFrames += sampleFrames;
+	m_DepthMs = m_DepthFrames * 1000 / m_SampleRate;
+}
+
+void AudioJitterBuffer::CopyOut(float* samples, int sampleFrames)
+{
+	int firstChunk = m_CapacityFrames - m_ReadFrame;
+	if (firstChunk > sampleFrames)
+	{
+		firstChunk = sampleFrames;
+	}
+
+	memcpy(samples, &m_Samples[(size_t)m_ReadFrame * m_ChannelCount], (size_t)firstChunk * m_ChannelCount * sizeof(float));
+	if (firstChunk < sampleFrames)
+	{
+		memcpy(&samples[firstChunk * m_ChannelCount], &m_Samples[0], (size_t)(sampleFrames - firstChunk) * m_ChannelCount * sizeof(float));
+	}
+
+	m_ReadFrame = (m_ReadFrame + sampleFrames) % m_CapacityFrames;
+	m_DepthFrames -= sampleFrames;
+}
+
+void AudioJitterBuffer::StretchOut(float* samples, int outputFrames, int inputFrames)
+{
+	// Linearly resample inputFrames of buffered audio onto outputFrames
+	CopyOut(m_StretchBuffer.data(), inputFrames);
+
+	const float* input = m_StretchBuffer.data();
+	float step = outputFrames > 1 ? (float)(inputFrames - 1) / (outputFrames - 1) : 0.0f;
+	for (int i = 0; i < outputFrames; i++)
+	{
+		float position = i * step;
+		int index = (int)position;
+		float fraction = position - index;
+		int nextIndex = index + 1 < inputFrames ? index + 1 : index;
+
+		for (int channel = 0; channel < m_ChannelCount; channel++)
+		{
+			float current = input[index * m_ChannelCount + channel];
+			float next = input[nextIndex * m_ChannelCount + channel];
+			samples[i * m_ChannelCount + channel] = current + (next - current) * fraction;
+		}
+	}
+}
+
+void AudioJitterBuffer::Read(float* samples, int sampleFrames)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (m_CapacityFrames == 0)
+	{
+		memset(samples, 0, (size_t)sampleFrames * m_ChannelCount * sizeof(float));
+		return;
+	}
+
+	int targetFrames = GetTargetDepthFrames();
+	m_TargetDepthMs = targetFrames * 1000 / m_SampleRate;
+
+	// After running dry, refill to the target before playing again
+	// so we don't bounce in and out of underrun on every packet.
+	if (!m_Primed && m_DepthFrames >= targetFrames)
+	{
+		m_Primed = true;
+	}
+
+	if (!m_Primed || m_DepthFrames < sampleFrames)
+	{
+		if (m_Primed)
+		{
+			m_Underruns++;
+			m_Primed = false;
+		}
+
+		memset(samples, 0, (size_t)sampleFrames * m_ChannelCount * sizeof(float));
+		m_DepthMs = m_DepthFrames * 1000 / m_SampleRate;
+		return;
+	}
+
+	int maxStretchFrames = sampleFrames * MAX_STRETCH_PER_MILLE / 1000;
+	if (maxStretchFrames < 1)
+	{
+		maxStretchFrames = 1;
+	}
+
+	// Stay inside a half-packet window around the target to avoid constant stretching
+	int error = m_DepthFrames - targetFrames;
+	int hysteresis = m_SamplesPerFrame / 2;
+	int inputFrames = sampleFrames;
+	if (error > hysteresis)
+	{
+		inputFrames += (error - hysteresis < maxStretchFrames) ? error - hysteresis : maxStretchFrames;
+	}
+	else if (error < -hysteresis)
+	{
+		inputFrames -= (-hysteresis - error < maxStretchFrames) ? -hysteresis - error : maxStretchFrames;
+	}
+
+	if (inputFrames > m_DepthFrames)
+	{
+		inputFrames = m_DepthFrames;
+	}
+
+	if (inputFrames == sampleFrames)
+	{
+		CopyOut(samples, sampleFrames);
+	}
+	else
+	{
+		StretchOut(samples, sampleFrames, inputFrames);
+		if (inputFrames > sampleFrames)
+		{
+			m_SamplesDropped += inputFrames - sampleFrames;
+		}
+		else
+		{
+			m_SamplesInserted += sampleFrames - inputFrames;
+		}
+	}
+
+	m_DepthMs = m_DepthFrames * 1000 / m_SampleRate;
+}
+
+int AudioJitterBuffer::GetDepthMs() const
+{
+	return m_DepthMs;
+}
+
+int AudioJitterBuffer::GetTargetDepthMs() const
+{
+	return m_TargetDepthMs;
+}
+
+int AudioJitterBuffer::GetJitterUs() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return (int)m_JitterUs;
+}
+
+long long AudioJitterBuffer::GetUnderruns() const
+{
+	return m_Underruns;
+}
+
+long long AudioJitterBuffer::GetOverruns() const
+{
+	return m_Overruns;
+}
+
+long long AudioJitterBuffer::GetSamplesDropped() const
+{
+	return m_SamplesDropped;
+}
+
+long long AudioJitterBuffer::GetSamplesInserted() const
+{
+	return m_SamplesInserted;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Buffers decoded PCM between the network-driven decoder and a steadily clocked
+			// playout thread. The target depth starts at the configured latency and grows
+			// with the measured packet arrival jitter. The buffer converges on that target
+			// by time-stretching each frame it plays by up to a couple of percent, so that
+			// drift is corrected by dropping or inserting samples rather than with gaps.
+			class AudioJitterBuffer
+			{
+			public:
+				AudioJitterBuffer();
+
+				bool Initialize(int channelCount, int sampleRate, int samplesPerFrame, int targetLatencyMs);
+
+				void Cleanup();
+
+				// Discards buffered audio and the jitter estimate, keeping the allocation
+				void Flush();
+
+				// Called on the decoder thread with the PCM decoded from one packet
+				void Write(const float* samples, int sampleFrames);
+
+				// Called on the playout thread. Always fills the output, with silence if
+				// the buffer has run dry.
+				void Read(float* samples, int sampleFrames);
+
+				int GetDepthMs() const;
+
+				int GetTargetDepthMs() const;
+
+				int GetJitterUs() const;
+
+				long long GetUnderruns() const;
+
+				long long GetOverruns() const;
+
+				long long GetSamplesDropped() const;
+
+				long long GetSamplesInserted() const;
+
+			private:
+				AudioJitterBuffer(const AudioJitterBuffer&) = delete;
+				AudioJitterBuffer& operator=(const AudioJitterBuffer&) = delete;
+
+				int GetTargetDepthFrames() const;
+
+				void CopyOut(float* samples, int sampleFrames);
+
+				void StretchOut(float* samples, int outputFrames, int inputFrames);
+
+				mutable std::mutex m_Lock;
+
+				std::vector<float> m_Samples;
+				int m_CapacityFrames;
+				int m_ReadFrame;
+				int m_DepthFrames;
+				bool m_Primed;
+
+				int m_ChannelCount;
+				int m_SampleRate;
+				int m_SamplesPerFrame;
+				int m_TargetLatencyFrames;
+
+				long long m_LastArrivalUs;
+				long long m_LastWriteDurationUs;
+				double m_JitterUs;
+
+				std::vector<float> m_StretchBuffer;
+
+				std::atomic<int> m_DepthMs;
+				std::atomic<int> m_TargetDepthMs;
+				std::atomic<long long> m_Underruns;
+				std::atomic<long long> m_Overruns;
+				std::atomic<long long> m_SamplesDropped;
+				std::atomic<long long> m_SamplesInserted;
+			};
+		}
+	}
+}
@@ -0,0 +1,580 @@
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "Clock.h"
+#include "AudioSampleConversion.h"
+#include "AudioPipeline.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// 120 ms at 48 KHz, the longest duration a single Opus packet can decode to
+#define MAX_OPUS_FRAME_SIZE 5760
+
+// Adaptive batching grows the batch until HandleFrame costs no more than this
+// share of the audio it delivers.
+#define BATCHING_TARGET_OVERHEAD_PERCENT 1
+
+#define MAX_FRAMES_PER_SUBMISSION 16
+
+// If the playout thread falls further behind than this, restart its clock
+// rather than bursting frames at the renderer to catch up.
+#define MAX_PLAYOUT_LAG_FRAMES 4
+
+// Opus TOC configurations below this value are SILK-only or hybrid packets,
+// which are the only modes that can carry in-band FEC (LBRR) data.
+#define OPUS_FIRST_CELT_ONLY_CONFIG 16
+
+static bool PacketCanCarryFec(const unsigned char* packet, int length)
+{
+	return length > 0 && (packet[0] >> 3) < OPUS_FIRST_CELT_ONLY_CONFIG;
+}
+
+AudioPipeline::AudioPipeline(INativeAudioRenderer* renderer)
+	: m_Renderer(renderer),
+	m_OpusDecoder(NULL),
+	m_FloatOutput(false),
+	m_DecodeBuffer(NULL),
+	m_OutputBuffer(NULL),
+	m_MaxFramesPerSubmission(1),
+	m_AdaptiveBatching(false),
+	m_FramesPerSubmission(1),
+	m_BatchedFrames(0),
+	m_BatchedBytes(0),
+	m_RendererCallCostUs(0),
+	m_DownmixEnabled(false),
+	m_DownmixBuffer(NULL),
+	m_ResamplerEnabled(false),
+	m_ResampleBuffer(NULL),
+	m_MaxOutputFrames(0),
+	m_PendingLostPackets(0),
+	m_FecAvailable(false),
+	m_JitterBufferEnabled(false),
+	m_PlayoutBuffer(NULL),
+	m_SampleRate(0),
+	m_OutputSampleRate(0),
+	m_ResamplerLatencySamples(0),
+	m_DecodeChannelCount(0),
+	m_ChannelCount(0),
+	m_SamplesPerFrame(0),
+	m_PlayoutFrameCapacity(0),
+	m_LastFrameSize(0),
+	m_PlayoutStopping(false),
+	m_FramesDecoded(0),
+	m_PacketsLost(0),
+	m_FramesConcealed(0),
+	m_FramesRecovered(0),
+	m_RendererCalls(0),
+	m_TotalRendererCallUs(0),
+	m_MaxRendererCallUs(0)
+{
+}
+
+AudioPipeline::~AudioPipeline()
+{
+	Cleanup();
+}
+
+int AudioPipeline::Initialize(const POPUS_MULTISTREAM_CONFIGURATION opusConfig, const AudioPipelineConfiguration& configuration)
+{
+	int err;
+	m_OpusDecoder =
+		opus_multistream_decoder_create(
+			opusConfig->sampleRate,
+			opusConfig->channelCount,
+			opusConfig->streams,
+			opusConfig->coupledStreams,
+			opusConfig->mapping,
+			&err);
+	if (m_OpusDecoder == NULL)
+	{
+		Cleanup();
+		return -1;
+	}
+
+	// We know ahead of time what the buffer size will be for decoded audio, so pre-allocate it
+	m_DecodeChannelCount = opusConfig->channelCount;
+	m_ChannelCount = GetOutputChannelCount(opusConfig, configuration);
+	m_SamplesPerFrame = opusConfig->samplesPerFrame;
+	if (m_SamplesPerFrame <= 0 || m_SamplesPerFrame > MAX_OPUS_FRAME_SIZE)
+	{
+		// Older hosts don't report a packet duration, and they always use 5 ms
+		m_SamplesPerFrame = opusConfig->sampleRate / 200;
+	}
+	m_LastFrameSize = m_SamplesPerFrame;
+
+	// Size for the largest legal packet, since the host may change durations mid-stream
+	m_DecodeBuffer = (float *)malloc(m_DecodeChannelCount * MAX_OPUS_FRAME_SIZE * sizeof(float));
+	if (m_DecodeBuffer == NULL)
+	{
+		Cleanup();
+		return -1;
+	}
+
+	m_DownmixEnabled = m_ChannelCount != m_DecodeChannelCount;
+	if (m_DownmixEnabled)
+	{
+		const float* matrix = NULL;
+		if (configuration.DownmixMatrix != NULL &&
+			configuration.DownmixMatrixLength == DOWNMIX_OUTPUT_CHANNELS * m_DecodeChannelCount)
+		{
+			matrix = configuration.DownmixMatrix;
+		}
+
+		m_DownmixBuffer = (float *)malloc(m_ChannelCount * MAX_OPUS_FRAME_SIZE * sizeof(float));
+		if (m_DownmixBuffer == NULL || !m_Downmixer.Initialize(m_DecodeChannelCount, matrix))
+		{
+			Cleanup();
+			return -1;
+		}
+	}
+
+	m_SampleRate = opusConfig->sampleRate;
+	m_OutputSampleRate = configuration.OutputSampleRate > 0 ? configuration.OutputSampleRate : m_SampleRate;
+	m_ResamplerEnabled = m_OutputSampleRate != m_SampleRate;
+	m_MaxOutputFrames = MAX_OPUS_FRAME_SIZE;
+	m_ResamplerLatencySamples = 0;
+	if (m_ResamplerEnabled)
+	{
+		if (!m_Resampler.Initialize(m_ChannelCount, m_SampleRate, m_OutputSampleRate, MAX_OPUS_FRAME_SIZE))
+		{
+			Cleanup();
+			return -1;
+		}
+
+		m_MaxOutputFrames = m_Resampler.GetMaxOutputFrames();
+		m_ResamplerLatencySamples = m_Resampler.GetLatencySamples();
+		m_ResampleBuffer = (float *)malloc(m_ChannelCount * m_MaxOutputFrames * sizeof(float));
+		if (m_ResampleBuffer == NULL)
+		{
+			Cleanup();
+			return -1;
+		}
+	}
+
+	m_MaxFramesPerSubmission = configuration.MaxFramesPerSubmission;
+	if (m_MaxFramesPerSubmission < 1)
+	{
+		m_MaxFramesPerSubmission = 1;
+	}
+	else if (m_MaxFramesPerSubmission > MAX_FRAMES_PER_SUBMISSION)
+	{
+		m_MaxFramesPerSubmission = MAX_FRAMES_PER_SUBMISSION;
+	}
+	m_AdaptiveBatching = configuration.AdaptiveBatching && m_MaxFramesPerSubmission > 1;
+	m_FramesPerSubmission = m_AdaptiveBatching ? 1 : m_MaxFramesPerSubmission;
+	m_BatchedFrames = 0;
+	m_BatchedBytes = 0;
+	m_RendererCallCostUs = 0;
+
+	// Float renderers take the processed samples as they are, unless they're being batched
+	m_FloatOutput = configuration.FloatOutput;
+	if (!m_FloatOutput || m_MaxFramesPerSubmission > 1)
+	{
+		int bytesPerSample = m_FloatOutput ? sizeof(float) : sizeof(short);
+		m_OutputBuffer = (char *)malloc(m_ChannelCount * m_MaxOutputFrames * bytesPerSample * m_MaxFramesPerSubmission);
+		if (m_OutputBuffer == NULL)
+		{
+			Cleanup();
+			return -1;
+		}
+	}
+
+	m_JitterBufferEnabled = configuration.JitterBufferTargetMs > 0;
+	if (m_JitterBufferEnabled)
+	{
+		m_PlayoutFrameCapacity = (int)(((long long)m_SamplesPerFrame * m_OutputSampleRate + m_SampleRate - 1) / m_SampleRate);
+		m_PlayoutBuffer = (float *)malloc(m_ChannelCount * m_PlayoutFrameCapacity * sizeof(float));
+		if (m_PlayoutBuffer == NULL ||
+			!m_JitterBuffer.Initialize(m_ChannelCount, m_OutputSampleRate, m_PlayoutFrameCapacity, configuration.JitterBufferTargetMs))
+		{
+			Cleanup();
+			return -1;
+		}
+	}
+
+	m_PendingLostPackets = 0;
+	m_FecAvailable = false;
+	m_FramesDecoded = 0;
+	m_PacketsLost = 0;
+	m_FramesConcealed = 0;
+	m_FramesRecovered = 0;
+	m_RendererCalls = 0;
+	m_TotalRendererCallUs = 0;
+	m_MaxRendererCallUs = 0;
+
+	return 0;
+}
+
+void AudioPipeline::Start()
+{
+	if (!m_JitterBufferEnabled || m_PlayoutThread.joinable())
+	{
+		return;
+	}
+
+	m_PlayoutStopping = false;
+	m_PlayoutThread = std::thread(&AudioPipeline::PlayoutThreadProc, this);
+}
+
+void AudioPipeline::Stop()
+{
+	if (!m_PlayoutThread.joinable())
+	{
+		return;
+	}
+
+	m_PlayoutStopping = true;
+	m_PlayoutThread.join();
+}
+
+void AudioPipeline::Reset()
+{
+	if (m_OpusDecoder == NULL)
+	{
+		return;
+	}
+
+	opus_multistream_decoder_ctl(m_OpusDecoder, OPUS_RESET_STATE);
+	m_LastFrameSize = m_SamplesPerFrame;
+	m_PendingLostPackets = 0;
+	m_FecAvailable = false;
+	m_BatchedFrames = 0;
+	m_BatchedBytes = 0;
+
+	if (m_ResamplerEnabled)
+	{
+		m_Resampler.Reset();
+	}
+
+	if (m_JitterBufferEnabled)
+	{
+		m_JitterBuffer.Flush();
+	}
+}
+
+void AudioPipeline::Cleanup()
+{
+	Stop();
+
+	if (m_OpusDecoder != NULL)
+	{
+		opus_multistream_decoder_destroy(m_OpusDecoder);
+		m_OpusDecoder = NULL;
+	}
+
+	if (m_DecodeBuffer != NULL)
+	{
+		free(m_DecodeBuffer);
+		m_DecodeBuffer = NULL;
+	}
+
+	if (m_OutputBuffer != NULL)
+	{
+		free(m_OutputBuffer);
+		m_OutputBuffer = NULL;
+	}
+
+	if (m_DownmixBuffer != NULL)
+	{
+		free(m_DownmixBuffer);
+		m_DownmixBuffer = NULL;
+	}
+	m_DownmixEnabled = false;
+
+	if (m_ResampleBuffer != NULL)
+	{
+		free(m_ResampleBuffer);
+		m_ResampleBuffer = NULL;
+	}
+	m_Resampler.Cleanup();
+	m_ResamplerEnabled = false;
+
+	if (m_PlayoutBuffer != NULL)
+	{
+		free(m_PlayoutBuffer);
+		m_PlayoutBuffer = NULL;
+	}
+
+	m_JitterBuffer.Cleanup();
+	m_JitterBufferEnabled = false;
+}
+
+int AudioPipeline::GetOutputChannelCount(const POPUS_MULTISTREAM_CONFIGURATION opusConfig, const AudioPipelineConfiguration& configuration)
+{
+	if (configuration.DownmixToStereo && opusConfig->channelCount > DOWNMIX_OUTPUT_CHANNELS)
+	{
+		return DOWNMIX_OUTPUT_CHANNELS;
+	}
+
+	return opusConfig->channelCount;
+}
+
+void AudioPipeline::SubmitFrame(int sampleFrames)
+{
+	m_LastFrameSize = sampleFrames;
+
+	const float* samples = m_DecodeBuffer;
+	if (m_DownmixEnabled)
+	{
+		m_Downmixer.Process(m_DecodeBuffer, m_DownmixBuffer, sampleFrames);
+		samples = m_DownmixBuffer;
+	}
+
+	if (m_ResamplerEnabled)
+	{
+		sampleFrames = m_Resampler.Process(samples, sampleFrames, m_ResampleBuffer);
+		samples = m_ResampleBuffer;
+	}
+
+	if (m_JitterBufferEnabled)
+	{
+		m_JitterBuffer.Write(samples, sampleFrames);
+	}
+	else
+	{
+		RenderFrame(samples, sampleFrames);
+	}
+}
+
+void AudioPipeline::RenderFrame(const float* samples, int sampleFrames)
+{
+	int sampleCount = sampleFrames * m_ChannelCount;
+	int framesPerSubmission = m_FramesPerSubmission;
+
+	if (m_FloatOutput)
+	{
+		if (framesPerSubmission == 1 && m_BatchedFrames == 0)
+		{
+			SubmitBatch((const char*)samples, sampleCount * sizeof(float));
+			return;
+		}
+
+		memcpy(m_OutputBuffer + m_BatchedBytes, samples, sampleCount * sizeof(float));
+		m_BatchedBytes += sampleCount * sizeof(float);
+	}
+	else
+	{
+		ConvertFloatToInt16(samples, (short*)(m_OutputBuffer + m_BatchedBytes), sampleCount);
+		m_BatchedBytes += sampleCount * sizeof(short);
+	}
+
+	m_BatchedFrames++;
+	if (m_BatchedFrames >= framesPerSubmission)
+	{
+		SubmitBatch(m_OutputBuffer, m_BatchedBytes);
+		m_BatchedFrames = 0;
+		m_BatchedBytes = 0;
+	}
+}
+
+void AudioPipeline::SubmitBatch(const char* data, int length)
+{
+	long long startTimeUs = GetTimeMicroseconds();
+	m_Renderer->HandleFrame(data, length);
+	int callTimeUs = (int)(GetTimeMicroseconds() - startTimeUs);
+
+	m_RendererCalls++;
+	m_TotalRendererCallUs += callTimeUs;
+	if (callTimeUs > m_MaxRendererCallUs)
+	{
+		m_MaxRendererCallUs = callTimeUs;
+	}
+
+	if (m_AdaptiveBatching)
+	{
+		// Smallest batch whose call overhead stays within budget. Every frame added
+		// to a batch is a frame of extra latency, so don't go beyond that.
+		m_RendererCallCostUs += (callTimeUs - m_RendererCallCostUs) / 16.0;
+
+		double frameDurationUs = (double)m_SamplesPerFrame * 1000000 / m_SampleRate;
+		double budgetUs = frameDurationUs * BATCHING_TARGET_OVERHEAD_PERCENT / 100;
+		int framesPerSubmission = (int)(m_RendererCallCostUs / budgetUs) + 1;
+		if (framesPerSubmission > m_MaxFramesPerSubmission)
+		{
+			framesPerSubmission = m_MaxFramesPerSubmission;
+		}
+		m_FramesPerSubmission = framesPerSubmission;
+	}
+}
+
+void AudioPipeline::PlayoutThreadProc()
+{
+	const std::chrono::microseconds frameDuration((long long)m_SamplesPerFrame * 1000000 / m_SampleRate);
+	std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+
+	// When a packet doesn't resample to a whole number of frames, carry the
+	// remainder so the playout rate matches the output rate exactly.
+	long long outputFrameRemainder = 0;
+
+	while (!m_PlayoutStopping)
+	{
+		std::this_thread::sleep_until(nextFrameTime);
+
+		outputFrameRemainder += (long long)m_SamplesPerFrame * m_OutputSampleRate;
+		int outputFrames = (int)(outputFrameRemainder / m_SampleRate);
+		outputFrameRemainder -= (long long)outputFrames * m_SampleRate;
+
+		m_JitterBuffer.Read(m_PlayoutBuffer, outputFrames);
+		RenderFrame(m_PlayoutBuffer, outputFrames);
+
+		nextFrameTime += frameDuration;
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - nextFrameTime > frameDuration * MAX_PLAYOUT_LAG_FRAMES)
+		{
+			nextFrameTime = now;
+		}
+	}
+}
+
+void AudioPipeline::ConcealLostFrame()
+{
+	// Decoding a NULL packet runs Opus packet loss concealment. Assume the
+	// lost packet was as long as the last one we played.
+	int decodeLen =
+		opus_multistream_decode_float(
+			m_OpusDecoder,
+			NULL,
+			0,
+			m_DecodeBuffer,
+			m_LastFrameSize,
+			0);
+	if (decodeLen > 0)
+	{
+		m_FramesConcealed++;
+		SubmitFrame(decodeLen);
+	}
+}
+
+void AudioPipeline::DecodeAndPlaySample(const char* sampleData, int sampleLength)
+{
+	if (sampleData == NULL || sampleLength <= 0)
+	{
+		m_PacketsLost++;
+
+		if (m_FecAvailable)
+		{
+			// Wait for the next packet, which may carry a copy of this one
+			m_PendingLostPackets++;
+		}
+		else
+		{
+			ConcealLostFrame();
+		}
+
+		return;
+	}
+
+	const unsigned char* packet = (const unsigned char*)sampleData;
+	if (m_PendingLostPackets > 0)
+	{
+		// FEC data only describes the packet immediately preceding this one,
+		// so anything lost before that has to be concealed.
+		while (m_PendingLostPackets > 1)
+		{
+			ConcealLostFrame();
+			m_PendingLostPackets--;
+		}
+		m_PendingLostPackets = 0;
+
+		if (PacketCanCarryFec(packet, sampleLength))
+		{
+			// FEC decoding needs the exact duration of the lost frame,
+			// which matches the frame that carried the redundant copy.
+			int decodeLen =
+				opus_multistream_decode_float(
+					m_OpusDecoder,
+					packet,
+					sampleLength,
+					m_DecodeBuffer,
+					opus_packet_get_samples_per_frame(packet, m_SampleRate),
+					1);
+			if (decodeLen > 0)
+			{
+				m_FramesRecovered++;
+				SubmitFrame(decodeLen);
+			}
+		}
+		else
+		{
+			ConcealLostFrame();
+		}
+	}
+
+	m_FecAvailable = PacketCanCarryFec(packet, sampleLength);
+
+	int decodeLen =
+		opus_multistream_decode_float(
+			m_OpusDecoder,
+			packet,
+			sampleLength,
+			m_DecodeBuffer,
+			MAX_OPUS_FRAME_SIZE,
+			0);
+	if (decodeLen > 0)
+	{
+		m_FramesDecoded++;
+		SubmitFrame(decodeLen);
+	}
+}
+
+long long AudioPipeline::GetFramesDecoded() const
+{
+	return m_FramesDecoded;
+}
+
+long long AudioPipeline::GetPacketsLost() const
+{
+	return m_PacketsLost;
+}
+
+long long AudioPipeline::GetFramesConcealed() const
+{
+	return m_FramesConcealed;
+}
+
+long long AudioPipeline::GetFramesRecovered() const
+{
+	return m_FramesRecovered;
+}
+
+bool AudioPipeline::IsJitterBufferEnabled() const
+{
+	return m_JitterBufferEnabled;
+}
+
+const AudioJitterBuffer& AudioPipeline::GetJitterBuffer() const
+{
+	return m_JitterBuffer;
+}
+
+int AudioPipeline::GetOutputSampleRate() const
+{
+	return m_OutputSampleRate;
+}
+
+int AudioPipeline::GetResamplerLatencySamples() const
+{
+	return m_ResamplerLatencySamples;
+}
+
+int AudioPipeline::GetFramesPerSubmission() const
+{
+	return m_FramesPerSubmission;
+}
+
+long long AudioPipeline::GetRendererCalls() const
+{
+	return m_RendererCalls;
+}
+
+int AudioPipeline::GetAverageRendererCallUs() const
+{
+	long long calls = m_RendererCalls;
+	return calls > 0 ? (int)(m_TotalRendererCallUs / calls) : 0;
+}
+
+int AudioPipeline::GetMaxRendererCallUs() const
+{
+	return m_MaxRendererCallUs;
+}
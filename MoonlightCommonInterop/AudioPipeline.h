@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <opus_multistream.h>
+#include "Limelight.h"
+#include "AudioDownmixer.h"
+#include "AudioJitterBuffer.h"
+#include "AudioResampler.h"
+#include "SessionInterfaces.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			struct AudioPipelineConfiguration
+			{
+				// Target playout latency, or 0 to submit frames as soon as they're decoded
+				int JitterBufferTargetMs;
+
+				// Hand the renderer interleaved float32 samples instead of int16
+				bool FloatOutput;
+
+				// Mix surround streams down to stereo before they reach the renderer
+				bool DownmixToStereo;
+
+				// Optional 2xN downmix matrix for an N channel stream. The default
+				// matrix is used when this is NULL or doesn't match the stream.
+				const float* DownmixMatrix;
+				int DownmixMatrixLength;
+
+				// Rate the renderer wants, or 0 to keep the stream's rate
+				int OutputSampleRate;
+
+				// Most decoded frames to gather into one HandleFrame call
+				int MaxFramesPerSubmission;
+
+				// Pick the batch size from the measured cost of HandleFrame, up to the
+				// maximum above, instead of always filling it.
+				bool AdaptiveBatching;
+			};
+
+			// Decodes Opus packets from moonlight-common-c and hands the resulting PCM to
+			// the audio renderer. Lost packets (signalled by moonlight-common-c as a NULL
+			// sample) are recovered from the next packet's in-band FEC data when the
+			// stream carries it, and concealed with Opus PLC otherwise, so the renderer
+			// always receives one frame of audio per packet interval.
+			//
+			// When a jitter buffer target is configured, decoded PCM is buffered and a
+			// playout thread feeds the renderer on a steady clock instead.
+			//
+			// Audio is decoded and processed as float and converted to the renderer's
+			// sample format in a single pass on the way out.
+			class AudioPipeline
+			{
+			public:
+				AudioPipeline(INativeAudioRenderer* renderer);
+				~AudioPipeline();
+
+				int Initialize(const POPUS_MULTISTREAM_CONFIGURATION opusConfig, const AudioPipelineConfiguration& configuration);
+
+				void Start();
+
+				void Stop();
+
+				void Cleanup();
+
+				// Returns an initialized pipeline to its just-initialized state without
+				// reallocating anything, so it can be reused for a new connection to the
+				// same stream. The pipeline must be stopped.
+				void Reset();
+
+				// Channel count of the PCM handed to the renderer
+				static int GetOutputChannelCount(const POPUS_MULTISTREAM_CONFIGURATION opusConfig, const AudioPipelineConfiguration& configuration);
+
+				void DecodeAndPlaySample(const char* sampleData, int sampleLength);
+
+				long long GetFramesDecoded() const;
+
+				long long GetPacketsLost() const;
+
+				long long GetFramesConcealed() const;
+
+				long long GetFramesRecovered() const;
+
+				bool IsJitterBufferEnabled() const;
+
+				int GetOutputSampleRate() const;
+
+				// Delay added by resampling, in output samples
+				int GetResamplerLatencySamples() const;
+
+				int GetFramesPerSubmission() const;
+
+				long long GetRendererCalls() const;
+
+				int GetAverageRendererCallUs() const;
+
+				int GetMaxRendererCallUs() const;
+
+				const AudioJitterBuffer& GetJitterBuffer() const;
+
+			private:
+				AudioPipeline(const AudioPipeline&) = delete;
+				AudioPipeline& operator=(const AudioPipeline&) = delete;
+
+				void ConcealLostFrame();
+
+				void SubmitFrame(int sampleFrames);
+
+				void RenderFrame(const float* samples, int sampleFrames);
+
+				void SubmitBatch(const char* data, int length);
+
+				void PlayoutThreadProc();
+
+				INativeAudioRenderer* m_Renderer;
+				OpusMSDecoder* m_OpusDecoder;
+				bool m_FloatOutput;
+				float* m_DecodeBuffer;
+				char* m_OutputBuffer;
+
+				// Frames gathered in m_OutputBuffer towards the next HandleFrame call
+				int m_MaxFramesPerSubmission;
+				bool m_AdaptiveBatching;
+				std::atomic<int> m_FramesPerSubmission;
+				int m_BatchedFrames;
+				int m_BatchedBytes;
+				double m_RendererCallCostUs;
+
+				bool m_DownmixEnabled;
+				AudioDownmixer m_Downmixer;
+				float* m_DownmixBuffer;
+
+				bool m_ResamplerEnabled;
+				AudioResampler m_Resampler;
+				float* m_ResampleBuffer;
+
+				// Most frames a single decoded packet can turn into after resampling
+				int m_MaxOutputFrames;
+
+				// Packets reported lost that haven't been concealed yet. These are held
+				// back only while the stream is in a mode that can carry FEC data.
+				int m_PendingLostPackets;
+				bool m_FecAvailable;
+
+				bool m_JitterBufferEnabled;
+				AudioJitterBuffer m_JitterBuffer;
+				float* m_PlayoutBuffer;
+				int m_SampleRate;
+				std::atomic<int> m_OutputSampleRate;
+				std::atomic<int> m_ResamplerLatencySamples;
+				int m_DecodeChannelCount;
+
+				// Channels after downmixing, which everything past the decoder works in
+				int m_ChannelCount;
+
+				// Nominal packet duration, which paces the playout thread
+				int m_SamplesPerFrame;
+
+				// Output frames per playout tick, rounded up for non-integer rate ratios
+				int m_PlayoutFrameCapacity;
+
+				// Duration of the last frame submitted, used to size concealment
+				int m_LastFrameSize;
+				std::atomic<bool> m_PlayoutStopping;
+				std::thread m_PlayoutThread;
+
+				std::atomic<long long> m_FramesDecoded;
+				std::atomic<long long> m_PacketsLost;
+				std::atomic<long long> m_FramesConcealed;
+				std::atomic<long long> m_FramesRecovered;
+				std::atomic<long long> m_RendererCalls;
+				std::atomic<long long> m_TotalRendererCallUs;
+				std::atomic<int> m_MaxRendererCallUs;
+			};
+		}
+	}
+}
@@ -0,0 +1,273 @@
+#include <math.h>
+#include <string.h>
+#include "CpuFeatures.h"
+#include "AudioResampler.h"
+
+#if defined(INTEROP_ARCH_X86)
+#include <immintrin.h>
+#elif defined(INTEROP_ARCH_ARM)
+#include <arm_neon.h>
+#endif
+
+using namespace Moonlight::Xbox::Interop;
+
+// Taps per phase. 32 keeps the group delay to 16 input samples (a third of a
+// millisecond at 48 KHz) with roughly 80 dB of stopband attenuation.
+#define RESAMPLER_TAPS 32
+
+// Upper bound on L after reducing the ratio, to keep the coefficient table small.
+// Every common device rate against 48 KHz is far below this.
+#define RESAMPLER_MAX_PHASES 1024
+
+#define KAISER_BETA 8.0
+
+#define RESAMPLER_PI 3.14159265358979323846
+
+// Fraction of the lower Nyquist frequency passed without attenuation
+#define PASSBAND_FRACTION 0.91
+
+static int GreatestCommonDivisor(int a, int b)
+{
+	while (b != 0)
+	{
+		int remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	return a;
+}
+
+// Zeroth order modified Bessel function of the first kind
+static double BesselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (int k = 1; k < 50; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+		{
+			break;
+		}
+	}
+	return sum;
+}
+
+static float DotProductScalar(const float* samples, const float* coefficients)
+{
+	float sum = 0;
+	for (int i = 0; i < RESAMPLER_TAPS; i++)
+	{
+		sum += samples[i] * coefficients[i];
+	}
+	return sum;
+}
+
+#if defined(INTEROP_ARCH_X86)
+
+static float DotProductSse2(const float* samples, const float* coefficients)
+{
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	for (int i = 0; i < RESAMPLER_TAPS; i += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(&samples[i]), _mm_loadu_ps(&coefficients[i])));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(&samples[i + 4]), _mm_loadu_ps(&coefficients[i + 4])));
+	}
+
+	__m128 sum = _mm_add_ps(sum0, sum1);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+INTEROP_TARGET_AVX2
+static float DotProductAvx2(const float* samples, const float* coefficients)
+{
+	__m256 sum = _mm256_setzero_ps();
+	for (int i = 0; i < RESAMPLER_TAPS; i += 8)
+	{
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&samples[i]), _mm256_loadu_ps(&coefficients[i])));
+	}
+
+	__m128 halves = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	halves = _mm_add_ps(halves, _mm_movehl_ps(halves, halves));
+	halves = _mm_add_ss(halves, _mm_shuffle_ps(halves, halves, 1));
+	return _mm_cvtss_f32(halves);
+}
+
+#elif defined(INTEROP_ARCH_ARM)
+
+static float DotProductNeon(const float* samples, const float* coefficients)
+{
+	float32x4_t sum0 = vdupq_n_f32(0);
+	float32x4_t sum1 = vdupq_n_f32(0);
+	for (int i = 0; i < RESAMPLER_TAPS; i += 8)
+	{
+		sum0 = vmlaq_f32(sum0, vld1q_f32(&samples[i]), vld1q_f32(&coefficients[i]));
+		sum1 = vmlaq_f32(sum1, vld1q_f32(&samples[i + 4]), vld1q_f32(&coefficients[i + 4]));
+	}
+
+	float32x4_t sum = vaddq_f32(sum0, sum1);
+	float32x2_t pairs = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+	return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+}
+
+#endif
+
+AudioResampler::AudioResampler()
+	: m_ChannelCount(0),
+	m_Interpolation(1),
+	m_Decimation(1),
+	m_MaxInputFrames(0),
+	m_LatencySamples(0),
+	m_HistoryStride(0),
+	m_InputIndex(0),
+	m_Phase(0),
+	m_DotProduct(DotProductScalar)
+{
+}
+
+bool AudioResampler::Initialize(int channelCount, int inputSampleRate, int outputSampleRate, int maxInputFrames)
+{
+	if (channelCount <= 0 || inputSampleRate <= 0 || outputSampleRate <= 0 || maxInputFrames <= 0)
+	{
+		return false;
+	}
+
+	int divisor = GreatestCommonDivisor(inputSampleRate, outputSampleRate);
+	int interpolation = outputSampleRate / divisor;
+	int decimation = inputSampleRate / divisor;
+	if (interpolation > RESAMPLER_MAX_PHASES)
+	{
+		return false;
+	}
+
+	m_ChannelCount = channelCount;
+	m_Interpolation = interpolation;
+	m_Decimation = decimation;
+	m_MaxInputFrames = maxInputFrames;
+
+	// Design the prototype low pass at the upsampled rate, cutting off below
+	// whichever of the two Nyquist frequencies is lower.
+	int length = RESAMPLER_TAPS * interpolation;
+	double cutoff = PASSBAND_FRACTION * 0.5 / (interpolation > decimation ? interpolation : decimation);
+	double center = (length - 1) / 2.0;
+	double windowScale = BesselI0(KAISER_BETA);
+
+	m_Coefficients.assign((size_t)length, 0);
+	for (int phase = 0; phase < interpolation; phase++)
+	{
+		for (int tap = 0; tap < RESAMPLER_TAPS; tap++)
+		{
+			int n = phase + tap * interpolation;
+			double x = n - center;
+			double sinc = x == 0 ? 2.0 * cutoff : sin(2.0 * RESAMPLER_PI * cutoff * x) / (RESAMPLER_PI * x);
+			double ratio = x / center;
+			double window = BesselI0(KAISER_BETA * sqrt(1.0 - ratio * ratio)) / windowScale;
+
+			// Tap k multiplies the sample k steps in the past, so store it mirrored
+			m_Coefficients[(size_t)phase * RESAMPLER_TAPS + (RESAMPLER_TAPS - 1 - tap)] = (float)(sinc * window * interpolation);
+		}
+	}
+
+	m_HistoryStride = RESAMPLER_TAPS - 1 + maxInputFrames;
+	Reset();
+
+	m_LatencySamples = (int)(center / decimation + 0.5);
+
+	const CpuFeatures& features = GetCpuFeatures();
+	m_DotProduct = DotProductScalar;
+#if defined(INTEROP_ARCH_X86)
+	if (features.Avx2)
+	{
+		m_DotProduct = DotProductAvx2;
+	}
+	else if (features.Sse2)
+	{
+		m_DotProduct = DotProductSse2;
+	}
+#elif defined(INTEROP_ARCH_ARM)
+	if (features.Neon)
+	{
+		m_DotProduct = DotProductNeon;
+	}
+#else
+	(void)features;
+#endif
+
+	return true;
+}
+
+void AudioResampler::Cleanup()
+{
+	m_Coefficients.clear();
+	m_Coefficients.shrink_to_fit();
+	m_History.clear();
+	m_History.shrink_to_fit();
+	m_MaxInputFrames = 0;
+}
+
+void AudioResampler::Reset()
+{
+	m_History.assign((size_t)m_HistoryStride * m_ChannelCount, 0);
+	m_InputIndex = RESAMPLER_TAPS - 1;
+	m_Phase = 0;
+}
+
+int AudioResampler::Process(const float* input, int inputFrames, float* output)
+{
+	if (inputFrames > m_MaxInputFrames)
+	{
+		inputFrames = m_MaxInputFrames;
+	}
+
+	// Deinterleave the new block in after the history
+	for (int channel = 0; channel < m_ChannelCount; channel++)
+	{
+		float* history = &m_History[(size_t)channel * m_HistoryStride + RESAMPLER_TAPS - 1];
+		for (int i = 0; i < inputFrames; i++)
+		{
+			history[i] = input[i * m_ChannelCount + channel];
+		}
+	}
+
+	int available = RESAMPLER_TAPS - 1 + inputFrames;
+	int outputFrames = 0;
+	while (m_InputIndex < available)
+	{
+		const float* coefficients = &m_Coefficients[(size_t)m_Phase * RESAMPLER_TAPS];
+		int firstTap = m_InputIndex - (RESAMPLER_TAPS - 1);
+		for (int channel = 0; channel < m_ChannelCount; channel++)
+		{
+			const float* history = &m_History[(size_t)channel * m_HistoryStride + firstTap];
+			output[outputFrames * m_ChannelCount + channel] = m_DotProduct(history, coefficients);
+		}
+		outputFrames++;
+
+		m_Phase += m_Decimation;
+		m_InputIndex += m_Phase / m_Interpolation;
+		m_Phase %= m_Interpolation;
+	}
+
+	// Keep the tail of this block as history for the next one
+	for (int channel = 0; channel < m_ChannelCount; channel++)
+	{
+		float* history = &m_History[(size_t)channel * m_HistoryStride];
+		memmove(history, &history[inputFrames], (RESAMPLER_TAPS - 1) * sizeof(float));
+	}
+	m_InputIndex -= inputFrames;
+
+	return outputFrames;
+}
+
+int AudioResampler::GetMaxOutputFrames() const
+{
+	return (int)(((long long)m_MaxInputFrames * m_Interpolation + m_Decimation - 1) / m_Decimation) + 1;
+}
+
+int AudioResampler::GetLatencySamples() const
+{
+	return m_LatencySamples;
+}
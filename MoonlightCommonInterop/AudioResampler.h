@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Rational polyphase resampler for interleaved float PCM. The ratio is reduced
+			// to L/M and a Kaiser windowed sinc prototype is split into L phases of
+			// RESAMPLER_TAPS coefficients each. All buffers are allocated up front, so
+			// Process never allocates, and each output sample is one short dot product
+			// run with the fastest kernel the CPU supports.
+			class AudioResampler
+			{
+			public:
+				AudioResampler();
+
+				// maxInputFrames bounds the size of a single Process call
+				bool Initialize(int channelCount, int inputSampleRate, int outputSampleRate, int maxInputFrames);
+
+				void Cleanup();
+
+				// Clears the filter history so the next block starts from silence
+				void Reset();
+
+				// Returns the number of frames written, which is at most GetMaxOutputFrames()
+				int Process(const float* input, int inputFrames, float* output);
+
+				int GetMaxOutputFrames() const;
+
+				// Group delay of the filter, in output samples
+				int GetLatencySamples() const;
+
+			private:
+				typedef float (*DotProductKernel)(const float* samples, const float* coefficients);
+
+				int m_ChannelCount;
+				int m_Interpolation;
+				int m_Decimation;
+				int m_MaxInputFrames;
+				int m_LatencySamples;
+
+				// RESAMPLER_TAPS coefficients per phase, stored newest sample last to
+				// match the order of the history buffer.
+				std::vector<float> m_Coefficients;
+
+				// One planar buffer per channel holding the filter history followed by
+				// the block being processed.
+				std::vector<float> m_History;
+				int m_HistoryStride;
+
+				int m_InputIndex;
+				int m_Phase;
+
+				DotProductKernel m_DotProduct;
+			};
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#include <math.h>
+#include "CpuFeatures.h"
+#include "AudioSampleConversion.h"
+
+#if defined(INTEROP_ARCH_X86)
+#include <immintrin.h>
+#elif defined(INTEROP_ARCH_ARM)
+#include <arm_neon.h>
+#endif
+
+using namespace Moonlight::Xbox::Interop;
+
+#define INT16_SCALE 32768.0f
+
+typedef void (*FloatToInt16Kernel)(const float* input, short* output, int sampleCount);
+
+static void FloatToInt16Scalar(const float* input, short* output, int sampleCount)
+{
+	for (int i = 0; i < sampleCount; i++)
+	{
+		float sample = input[i] * INT16_SCALE;
+		if (sample > 32767.0f)
+		{
+			sample = 32767.0f;
+		}
+		else if (sample < -32768.0f)
+		{
+			sample = -32768.0f;
+		}
+		output[i] = (short)lrintf(sample);
+	}
+}
+
+#if defined(INTEROP_ARCH_X86)
+
+static void FloatToInt16Sse2(const float* input, short* output, int sampleCount)
+{
+	const __m128 scale = _mm_set1_ps(INT16_SCALE);
+
+	// Clamp before converting, since out of range floats convert to INT_MIN
+	const __m128 maximum = _mm_set1_ps(32767.0f);
+	const __m128 minimum = _mm_set1_ps(-32768.0f);
+
+	int i = 0;
+	for (; i + 8 <= sampleCount; i += 8)
+	{
+		__m128 low = _mm_mul_ps(_mm_loadu_ps(&input[i]), scale);
+		__m128 high = _mm_mul_ps(_mm_loadu_ps(&input[i + 4]), scale);
+		low = _mm_max_ps(_mm_min_ps(low, maximum), minimum);
+		high = _mm_max_ps(_mm_min_ps(high, maximum), minimum);
+
+		__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+		_mm_storeu_si128((__m128i*)&output[i], packed);
+	}
+
+	FloatToInt16Scalar(&input[i], &output[i], sampleCount - i);
+}
+
+INTEROP_TARGET_AVX2
+static void FloatToInt16Avx2(const float* input, short* output, int sampleCount)
+{
+	const __m256 scale = _mm256_set1_ps(INT16_SCALE);
+	const __m256 maximum = _mm256_set1_ps(32767.0f);
+	const __m256 minimum = _mm256_set1_ps(-32768.0f);
+
+	int i = 0;
+	for (; i + 16 <= sampleCount; i += 16)
+	{
+		__m256 low = _mm256_mul_ps(_mm256_loadu_ps(&input[i]), scale);
+		__m256 high = _mm256_mul_ps(_mm256_loadu_ps(&input[i + 8]), scale);
+		low = _mm256_max_ps(_mm256_min_ps(low, maximum), minimum);
+		high = _mm256_max_ps(_mm256_min_ps(high, maximum), minimum);
+
+		// Packing works within each 128-bit lane, so put the quadwords back in order afterwards
+		__m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(low), _mm256_cvtps_epi32(high));
+		packed = _mm256_permute4x64_epi64(packed, 0xD8);
+		_mm256_storeu_si256((__m256i*)&output[i], packed);
+	}
+
+	FloatToInt16Sse2(&input[i], &output[i], sampleCount - i);
+}
+
+#elif defined(INTEROP_ARCH_ARM)
+
+static inline int32x4_t RoundToInt32Neon(float32x4_t value)
+{
+	// ARMv7 only has a truncating conversion, so add 0.5 with the sign of the value first
+	const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+	const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+	float32x4_t bias = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(value), signMask), half));
+	return vcvtq_s32_f32(vaddq_f32(value, bias));
+}
+
+static void FloatToInt16Neon(const float* input, short* output, int sampleCount)
+{
+	const float32x4_t scale = vdupq_n_f32(INT16_SCALE);
+
+	int i = 0;
+	for (; i + 8 <= sampleCount; i += 8)
+	{
+		// The narrowing move saturates, so only the float to int conversion needs care
+		int32x4_t low = RoundToInt32Neon(vmulq_f32(vld1q_f32(&input[i]), scale));
+		int32x4_t high = RoundToInt32Neon(vmulq_f32(vld1q_f32(&input[i + 4]), scale));
+
+		vst1q_s16(&output[i], vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+	}
+
+	FloatToInt16Scalar(&input[i], &output[i], sampleCount - i);
+}
+
+#endif
+
+static FloatToInt16Kernel SelectFloatToInt16Kernel()
+{
+	const CpuFeatures& features = GetCpuFeatures();
+
+#if defined(INTEROP_ARCH_X86)
+	if (features.Avx2)
+	{
+		return FloatToInt16Avx2;
+	}
+	else if (features.Sse2)
+	{
+		return FloatToInt16Sse2;
+	}
+#elif defined(INTEROP_ARCH_ARM)
+	if (features.Neon)
+	{
+		return FloatToInt16Neon;
+	}
+#else
+	(void)features;
+#endif
+
+	return FloatToInt16Scalar;
+}
+
+void Moonlight::Xbox::Interop::ConvertFloatToInt16(const float* input, short* output, int sampleCount)
+{
+	static const FloatToInt16Kernel s_Kernel = SelectFloatToInt16Kernel();
+	s_Kernel(input, output, sampleCount);
+}
+
+void Moonlight::Xbox::Interop::ConvertFloatToInt16Scalar(const float* input, short* output, int sampleCount)
+{
+	FloatToInt16Scalar(input, output, sampleCount);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Converts the Opus decoder's interleaved float PCM to int16 for renderers that
+			// don't take float output. Full scale is 32768 and input outside [-1, 1)
+			// saturates. The fastest kernel the CPU supports (SSE2, AVX2 or NEON) is
+			// selected on first use. Channels stay in the order the multistream decoder
+			// emits them, which already follows the stream's channel mapping, so there
+			// is no separate remapping pass.
+			void ConvertFloatToInt16(const float* input, short* output, int sampleCount);
+
+			// The portable kernel ConvertFloatToInt16 falls back to, for comparing against
+			// the vector kernels
+			void ConvertFloatToInt16Scalar(const float* input, short* output, int sampleCount);
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			using namespace Platform;
+
+			public ref class AudioStatistics sealed
+			{
+			public:
+				property __int64 FramesDecoded;
+
+				property __int64 PacketsLost;
+
+				property __int64 FramesConcealed;
+
+				property __int64 FramesRecovered;
+
+				property int JitterBufferDepthMs;
+
+				property int JitterBufferTargetDepthMs;
+
+				property int JitterUs;
+
+				property __int64 JitterBufferUnderruns;
+
+				property __int64 JitterBufferOverruns;
+
+				property __int64 SamplesDropped;
+
+				property __int64 SamplesInserted;
+
+				property int OutputSampleRate;
+
+				property int ResamplerLatencySamples;
+
+				property int FramesPerSubmission;
+
+				property __int64 RendererCalls;
+
+				property int AverageRendererCallUs;
+
+				property int MaxRendererCallUs;
+			};
+		}
+	}
+}
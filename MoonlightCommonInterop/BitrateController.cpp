@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BitrateController.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define DEFAULT_FPS 60
+#define DEFAULT_STEP_UP_PERCENT 10
+#define DEFAULT_STEP_DOWN_PERCENT 25
+#define DEFAULT_LOSS_PERCENT_THRESHOLD 2.0
+#define DEFAULT_DECODE_TIME_PERCENT_THRESHOLD 80
+#define DEFAULT_WINDOW_MS 2000
+#define DEFAULT_STEP_UP_WINDOWS 10
+#define DEFAULT_STEP_DOWN_WINDOWS 2
+
+// The default minimum is this fraction of the configured bitrate
+#define DEFAULT_MINIMUM_BITRATE_DIVISOR 4
+
+// Gain of the RFC 3550 jitter estimator
+#define JITTER_SMOOTHING 16
+
+// Frame number gaps beyond this are a restart of the stream rather than loss
+#define MAX_FRAME_NUMBER_GAP 1000
+
+BitrateController::BitrateController()
+	: m_Enabled(false),
+	m_FramePeriodUs(0),
+	m_Bitrate(0),
+	m_TargetBitrate(0),
+	m_WindowStartUs(0),
+	m_WindowFramesReceived(0),
+	m_WindowFramesLost(0),
+	m_WindowFramesDecoded(0),
+	m_WindowDecodeTimeUs(0),
+	m_HaveLastFrame(false),
+	m_LastFrameNumber(0),
+	m_LastArrivalUs(0),
+	m_JitterUs(0),
+	m_CongestedWindows(0),
+	m_CleanWindows(0),
+	m_DecisionCount(0),
+	m_Increases(0),
+	m_Decreases(0)
+{
+	memset(&m_Policy, 0, sizeof(m_Policy));
+}
+
+void BitrateController::Initialize(bool enabled, const BitratePolicyConfiguration& policy, int fps, int bitrate)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_Enabled = enabled;
+	m_FramePeriodUs = 1000000 / (fps > 0 ? fps : DEFAULT_FPS);
+
+	m_Policy = policy;
+	if (m_Policy.MaximumBitrate <= 0)
+	{
+		m_Policy.MaximumBitrate = bitrate;
+	}
+	if (m_Policy.MinimumBitrate <= 0)
+	{
+		m_Policy.MinimumBitrate = bitrate / DEFAULT_MINIMUM_BITRATE_DIVISOR;
+	}
+	if (m_Policy.MinimumBitrate > m_Policy.MaximumBitrate)
+	{
+		m_Policy.MinimumBitrate = m_Policy.MaximumBitrate;
+	}
+	if (m_Policy.StepUpPercent <= 0)
+	{
+		m_Policy.StepUpPercent = DEFAULT_STEP_UP_PERCENT;
+	}
+	if (m_Policy.StepDownPercent <= 0 || m_Policy.StepDownPercent >= 100)
+	{
+		m_Policy.StepDownPercent = DEFAULT_STEP_DOWN_PERCENT;
+	}
+	if (m_Policy.LossPercentThreshold <= 0)
+	{
+		m_Policy.LossPercentThreshold = DEFAULT_LOSS_PERCENT_THRESHOLD;
+	}
+	if (m_Policy.JitterThresholdUs <= 0)
+	{
+		// Half a frame of jitter means frames regularly miss their display interval
+		m_Policy.JitterThresholdUs = (int)(m_FramePeriodUs / 2);
+	}
+	if (m_Policy.DecodeTimePercentThreshold <= 0)
+	{
+		m_Policy.DecodeTimePercentThreshold = DEFAULT_DECODE_TIME_PERCENT_THRESHOLD;
+	}
+	if (m_Policy.WindowMs <= 0)
+	{
+		m_Policy.WindowMs = DEFAULT_WINDOW_MS;
+	}
+	if (m_Policy.StepUpWindows <= 0)
+	{
+		m_Policy.StepUpWindows = DEFAULT_STEP_UP_WINDOWS;
+	}
+	if (m_Policy.StepDownWindows <= 0)
+	{
+		m_Policy.StepDownWindows = DEFAULT_STEP_DOWN_WINDOWS;
+	}
+
+	m_Bitrate = bitrate;
+	m_TargetBitrate = bitrate;
+	m_DecisionCount = 0;
+	m_Increases = 0;
+	m_Decreases = 0;
+	m_CongestedWindows = 0;
+	m_CleanWindows = 0;
+	m_HaveLastFrame = false;
+	m_JitterUs = 0;
+	ResetWindow(0);
+}
+
+bool BitrateController::IsEnabled() const
+{
+	return m_Enabled;
+}
+
+void BitrateController::SetBitrate(int bitrate)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	// The new connection starts over, so none of the old measurements apply
+	m_Bitrate = bitrate;
+	m_TargetBitrate = bitrate;
+	m_CongestedWindows = 0;
+	m_CleanWindows = 0;
+	m_HaveLastFrame = false;
+	m_JitterUs = 0;
+	ResetWindow(0);
+}
+
+void BitrateController::ResetWindow(long long nowUs)
+{
+	m_WindowStartUs = nowUs;
+	m_WindowFramesReceived = 0;
+	m_WindowFramesLost = 0;
+	m_WindowFramesDecoded = 0;
+	m_WindowDecodeTimeUs = 0;
+}
+
+bool BitrateController::FrameReceived(int frameNumber, long long arrivalUs)
+{
+	if (!m_Enabled)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (m_HaveLastFrame)
+	{
+		int gap = frameNumber - m_LastFrameNumber - 1;
+		if (gap > 0 && gap < MAX_FRAME_NUMBER_GAP)
+		{
+			m_WindowFramesLost += gap;
+		}
+
+		// Lost frames stretch the interval they fall in, so only consecutive
+		// frames feed the jitter estimate
+		if (gap == 0)
+		{
+			long long deviationUs = llabs(arrivalUs - m_LastArrivalUs - m_FramePeriodUs);
+			m_JitterUs += (deviationUs - m_JitterUs) / JITTER_SMOOTHING;
+		}
+	}
+
+	m_HaveLastFrame = true;
+	m_LastFrameNumber = frameNumber;
+	m_LastArrivalUs = arrivalUs;
+	m_WindowFramesReceived++;
+
+	if (m_WindowStartUs == 0)
+	{
+		m_WindowStartUs = arrivalUs;
+		return false;
+	}
+
+	if (arrivalUs - m_WindowStartUs < (long long)m_Policy.WindowMs * 1000)
+	{
+		return false;
+	}
+
+	return EvaluateWindow(arrivalUs);
+}
+
+void BitrateController::FrameDecoded(long long decodeTimeUs)
+{
+	if (!m_Enabled)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_WindowFramesDecoded++;
+	m_WindowDecodeTimeUs += decodeTimeUs;
+}
+
+bool BitrateController::EvaluateWindow(long long nowUs)
+{
+	BitrateDecisionRecord& record = m_Decisions[m_DecisionCount % BITRATE_DECISION_LOG_SIZE];
+	record.TimestampUs = nowUs;
+	record.FramesReceived = m_WindowFramesReceived;
+	record.FramesLost = m_WindowFramesLost;
+	record.JitterUs = (int)m_JitterUs;
+	record.AverageDecodeTimeUs =
+		m_WindowFramesDecoded > 0 ? (int)(m_WindowDecodeTimeUs / m_WindowFramesDecoded) : 0;
+	record.Bitrate = m_Bitrate;
+	m_DecisionCount++;
+
+	double lossPercent = record.FramesLost * 100.0 / (record.FramesReceived + record.FramesLost);
+	bool congested = true;
+	if (lossPercent > m_Policy.LossPercentThreshold)
+	{
+		record.Reason = "loss";
+	}
+	else if (record.JitterUs > m_Policy.JitterThresholdUs)
+	{
+		record.Reason = "jitter";
+	}
+	else if (record.AverageDecodeTimeUs * 100LL > m_FramePeriodUs * m_Policy.DecodeTimePercentThreshold)
+	{
+		record.Reason = "decode time";
+	}
+	else
+	{
+		record.Reason = "clean";
+		congested = false;
+	}
+
+	ResetWindow(nowUs);
+
+	int previousTarget = m_TargetBitrate;
+	if (m_TargetBitrate == m_Bitrate)
+	{
+		if (congested)
+		{
+			m_CleanWindows = 0;
+			if (++m_CongestedWindows >= m_Policy.StepDownWindows)
+			{
+				m_CongestedWindows = 0;
+				m_TargetBitrate = (int)((long long)m_Bitrate * (100 - m_Policy.StepDownPercent) / 100);
+				if (m_TargetBitrate < m_Policy.MinimumBitrate)
+				{
+					m_TargetBitrate = m_Policy.MinimumBitrate;
+				}
+			}
+		}
+		else
+		{
+			m_CongestedWindows = 0;
+			if (++m_CleanWindows >= m_Policy.StepUpWindows)
+			{
+				m_CleanWindows = 0;
+				m_TargetBitrate = (int)((long long)m_Bitrate * (100 + m_Policy.StepUpPercent) / 100);
+				if (m_TargetBitrate > m_Policy.MaximumBitrate)
+				{
+					m_TargetBitrate = m_Policy.MaximumBitrate;
+				}
+			}
+		}
+	}
+
+	record.TargetBitrate = m_TargetBitrate;
+	if (m_TargetBitrate == previousTarget)
+	{
+		return false;
+	}
+
+	if (m_TargetBitrate > previousTarget)
+	{
+		m_Increases++;
+	}
+	else
+	{
+		m_Decreases++;
+	}
+	return true;
+}
+
+int BitrateController::GetTargetBitrate() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_TargetBitrate;
+}
+
+long long BitrateController::GetIncreases() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_Increases;
+}
+
+long long BitrateController::GetDecreases() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_Decreases;
+}
+
+BitrateDecisionRecord BitrateController::GetLastDecision() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (m_DecisionCount == 0)
+	{
+		BitrateDecisionRecord record;
+		memset(&record, 0, sizeof(record));
+		record.Bitrate = m_Bitrate;
+		record.TargetBitrate = m_TargetBitrate;
+		record.Reason = "";
+		return record;
+	}
+
+	return m_Decisions[(m_DecisionCount - 1) % BITRATE_DECISION_LOG_SIZE];
+}
+
+std::string BitrateController::ExportDecisions() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	char buffer[512];
+	snprintf(buffer, sizeof(buffer),
+		"{\"policy\":{\"frameIntervalUs\":%lld,\"minimumBitrate\":%d,\"maximumBitrate\":%d,"
+		"\"stepUpPercent\":%d,\"stepDownPercent\":%d,\"lossPercentThreshold\":%.2f,"
+		"\"jitterThresholdUs\":%d,\"decodeTimePercentThreshold\":%d,\"windowMs\":%d,"
+		"\"stepUpWindows\":%d,\"stepDownWindows\":%d},\"decisions\":[",
+		m_FramePeriodUs,
+		m_Policy.MinimumBitrate,
+		m_Policy.MaximumBitrate,
+		m_Policy.StepUpPercent,
+		m_Policy.StepDownPercent,
+		m_Policy.LossPercentThreshold,
+		m_Policy.JitterThresholdUs,
+		m_Policy.DecodeTimePercentThreshold,
+		m_Policy.WindowMs,
+		m_Policy.StepUpWindows,
+		m_Policy.StepDownWindows);
+	std::string json = buffer;
+
+	long long first = m_DecisionCount > BITRATE_DECISION_LOG_SIZE ? m_DecisionCount - BITRATE_DECISION_LOG_SIZE : 0;
+	for (long long i = first; i < m_DecisionCount; i++)
+	{
+		const BitrateDecisionRecord& record = m_Decisions[i % BITRATE_DECISION_LOG_SIZE];
+		snprintf(buffer, sizeof(buffer),
+			"%s{\"timeUs\":%lld,\"framesReceived\":%d,\"framesLost\":%d,\"jitterUs\":%d,"
+			"\"decodeTimeUs\":%d,\"bitrate\":%d,\"targetBitrate\":%d,\"reason\":\"%s\"}",
+			i != first ? "," : "",
+			record.TimestampUs,
+			record.FramesReceived,
+			record.FramesLost,
+			record.JitterUs,
+			record.AverageDecodeTimeUs,
+			record.Bitrate,
+			record.TargetBitrate,
+			record.Reason);
+		json += buffer;
+	}
+
+	json += "]}";
+	return json;
+}
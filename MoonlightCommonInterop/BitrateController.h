@@ -0,0 +1,109 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include "SessionInterfaces.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			#define BITRATE_DECISION_LOG_SIZE 512
+
+			// One evaluation window, with everything the decision was based on
+			struct BitrateDecisionRecord
+			{
+				long long TimestampUs;
+				int FramesReceived;
+				int FramesLost;
+				int JitterUs;
+				int AverageDecodeTimeUs;
+				int Bitrate;
+				int TargetBitrate;
+
+				// What made the window congested, or "clean"
+				const char* Reason;
+			};
+
+			// Picks a target bitrate from what the client sees of the stream. Each window
+			// it looks at frames lost in transit (gaps in the frame numbers), interarrival
+			// jitter of reassembled frames and the renderer's time per frame.
+			// - A window is congested when any of them is over its threshold.
+			// - The target steps down after StepDownWindows congested windows in a row.
+			// - It steps up after StepUpWindows clean windows in a row.
+			// - While the target differs from the running bitrate, it holds until the
+			//   connection is restarted at the new bitrate.
+			// Every window is logged with its inputs so policies can be replayed offline.
+			class BitrateController
+			{
+			public:
+				BitrateController();
+
+				// bitrate is the configured bitrate, the default maximum
+				void Initialize(bool enabled, const BitratePolicyConfiguration& policy, int fps, int bitrate);
+
+				bool IsEnabled() const;
+
+				// The bitrate the connection is running at. Restarts the measurements.
+				void SetBitrate(int bitrate);
+
+				// Returns true if the window this frame closed changed the target bitrate
+				bool FrameReceived(int frameNumber, long long arrivalUs);
+
+				void FrameDecoded(long long decodeTimeUs);
+
+				int GetTargetBitrate() const;
+
+				long long GetIncreases() const;
+
+				long long GetDecreases() const;
+
+				BitrateDecisionRecord GetLastDecision() const;
+
+				// The resolved policy and decision log as JSON
+				std::string ExportDecisions() const;
+
+			private:
+				BitrateController(const BitrateController&) = delete;
+				BitrateController& operator=(const BitrateController&) = delete;
+
+				void ResetWindow(long long nowUs);
+
+				// Called with m_Lock held
+				bool EvaluateWindow(long long nowUs);
+
+				mutable std::mutex m_Lock;
+				bool m_Enabled;
+				BitratePolicyConfiguration m_Policy;
+				long long m_FramePeriodUs;
+
+				int m_Bitrate;
+				int m_TargetBitrate;
+
+				long long m_WindowStartUs;
+				int m_WindowFramesReceived;
+				int m_WindowFramesLost;
+				int m_WindowFramesDecoded;
+				long long m_WindowDecodeTimeUs;
+
+				bool m_HaveLastFrame;
+				int m_LastFrameNumber;
+				long long m_LastArrivalUs;
+
+				// RFC 3550 interarrival jitter against the nominal frame period
+				double m_JitterUs;
+
+				int m_CongestedWindows;
+				int m_CleanWindows;
+
+				BitrateDecisionRecord m_Decisions[BITRATE_DECISION_LOG_SIZE];
+				long long m_DecisionCount;
+
+				long long m_Increases;
+				long long m_Decreases;
+			};
+		}
+	}
+}
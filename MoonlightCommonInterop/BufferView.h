@@ -0,0 +1,20 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// A view over one entry of a decode unit's buffer list. Data is the address
+			// of native memory owned by the interop layer, and is only valid for the
+			// duration of the renderer call it was passed to.
+			public value struct BufferView
+			{
+				__int64 Data;
+				int Length;
+				int BufferType;
+			};
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Monotonic timestamp in microseconds used for all interop-side measurements
+			inline long long GetTimeMicroseconds()
+			{
+				return std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#include "CpuFeatures.h"
+
+#if defined(INTEROP_ARCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(INTEROP_ARCH_X86)
+#include <cpuid.h>
+#endif
+
+using namespace Moonlight::Xbox::Interop;
+
+#if defined(INTEROP_ARCH_X86)
+
+static void QueryCpuid(int leaf, int registers[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex(registers, leaf, 0);
+#else
+	unsigned int eax, ebx, ecx, edx;
+	__cpuid_count(leaf, 0, eax, ebx, ecx, edx);
+	registers[0] = (int)eax;
+	registers[1] = (int)ebx;
+	registers[2] = (int)ecx;
+	registers[3] = (int)edx;
+#endif
+}
+
+static unsigned long long QueryXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static CpuFeatures ProbeCpuFeatures()
+{
+	CpuFeatures features = {};
+
+	int registers[4];
+	QueryCpuid(0, registers);
+	int maxLeaf = registers[0];
+
+	QueryCpuid(1, registers);
+	features.Sse2 = (registers[3] & (1 << 26)) != 0;
+
+	// AVX2 also needs the OS to save the YMM registers across context switches
+	bool osxsave = (registers[2] & (1 << 27)) != 0;
+	if (maxLeaf >= 7 && osxsave && (QueryXcr0() & 0x6) == 0x6)
+	{
+		QueryCpuid(7, registers);
+		features.Avx2 = (registers[1] & (1 << 5)) != 0;
+	}
+
+	return features;
+}
+
+#else
+
+static CpuFeatures ProbeCpuFeatures()
+{
+	CpuFeatures features = {};
+
+#if defined(INTEROP_ARCH_ARM)
+	// Windows on ARM requires NEON
+	features.Neon = true;
+#endif
+
+	return features;
+}
+
+#endif
+
+const CpuFeatures& Moonlight::Xbox::Interop::GetCpuFeatures()
+{
+	static const CpuFeatures s_CpuFeatures = ProbeCpuFeatures();
+	return s_CpuFeatures;
+}
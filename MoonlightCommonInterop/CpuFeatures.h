@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+			#define INTEROP_ARCH_X86 1
+			#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+			#define INTEROP_ARCH_ARM 1
+			#endif
+
+			// MSVC emits any intrinsic regardless of /arch, GCC and Clang need each
+			// function that uses AVX2 to opt in.
+			#if defined(__GNUC__)
+			#define INTEROP_TARGET_AVX2 __attribute__((target("avx2")))
+			#else
+			#define INTEROP_TARGET_AVX2
+			#endif
+
+			// Instruction set extensions usable on this machine, probed once at startup
+			struct CpuFeatures
+			{
+				bool Sse2;
+				bool Avx2;
+				bool Neon;
+			};
+
+			const CpuFeatures& GetCpuFeatures();
+		}
+	}
+}
@@ -0,0 +1,191 @@
+#include <limits.h>
+#include <stdlib.h>
+#include "FrameBufferPool.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define INITIAL_FRAME_BUFFER_SIZE 32768
+#define FRAME_BUFFER_ALIGNMENT 65536
+
+// IDR frames are several times larger than the average frame at a given bitrate.
+#define IDR_FRAME_SIZE_MULTIPLIER 8
+
+static FrameBuffer* AllocateFrameBuffer(int capacity, bool pooled)
+{
+	FrameBuffer* buffer = new FrameBuffer();
+	buffer->Data = (char*)malloc(capacity);
+	if (buffer->Data == NULL)
+	{
+		delete buffer;
+		return NULL;
+	}
+
+	buffer->Capacity = capacity;
+	buffer->Pooled = pooled;
+	return buffer;
+}
+
+static void FreeFrameBuffer(FrameBuffer* buffer)
+{
+	free(buffer->Data);
+	delete buffer;
+}
+
+static int RoundUpBufferSize(int size)
+{
+	return (size + FRAME_BUFFER_ALIGNMENT - 1) & ~(FRAME_BUFFER_ALIGNMENT - 1);
+}
+
+FrameBufferPool::FrameBufferPool()
+	: m_BufferSize(0),
+	m_Hits(0),
+	m_Misses(0)
+{
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+	Cleanup();
+}
+
+int FrameBufferPool::EstimateBufferSize(int width, int height, int fps, int bitrateKbps)
+{
+	// Size for the larger of a worst-case IDR frame at the requested bitrate
+	// and a quarter of an uncompressed 4:2:0 frame at the requested resolution.
+	long long averageFrameSize = 0;
+	if (fps > 0)
+	{
+		averageFrameSize = (long long)bitrateKbps * 1000 / 8 / fps;
+	}
+
+	long long size = averageFrameSize * IDR_FRAME_SIZE_MULTIPLIER;
+	long long resolutionSize = (long long)width * height * 3 / 2 / 4;
+	if (size < resolutionSize)
+	{
+		size = resolutionSize;
+	}
+
+	if (size < INITIAL_FRAME_BUFFER_SIZE)
+	{
+		size = INITIAL_FRAME_BUFFER_SIZE;
+	}
+	else if (size > INT_MAX / 2)
+	{
+		size = INT_MAX / 2;
+	}
+
+	return RoundUpBufferSize((int)size);
+}
+
+bool FrameBufferPool::Initialize(int width, int height, int fps, int bitrateKbps, int bufferCount)
+{
+	Cleanup();
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_BufferSize = EstimateBufferSize(width, height, fps, bitrateKbps);
+	m_Hits = 0;
+	m_Misses = 0;
+
+	for (int i = 0; i < bufferCount; i++)
+	{
+		FrameBuffer* buffer = AllocateFrameBuffer(m_BufferSize, true);
+		if (buffer == NULL)
+		{
+			break;
+		}
+
+		m_Buffers.push_back(buffer);
+		m_FreeBuffers.push_back(buffer);
+	}
+
+	return !m_Buffers.empty();
+}
+
+void FrameBufferPool::Cleanup()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	// Buffers that are still checked out are freed here as well. Callers must
+	// make sure the renderer is done with them before cleaning up the pool.
+	for (FrameBuffer* buffer : m_Buffers)
+	{
+		FreeFrameBuffer(buffer);
+	}
+
+	m_Buffers.clear();
+	m_FreeBuffers.clear();
+	m_BufferSize = 0;
+}
+
+FrameBuffer* FrameBufferPool::Acquire(int length)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		if (!m_FreeBuffers.empty())
+		{
+			FrameBuffer* buffer = m_FreeBuffers.back();
+			if (buffer->Capacity >= length)
+			{
+				m_FreeBuffers.pop_back();
+				m_Hits++;
+				return buffer;
+			}
+
+			// Grow the pooled buffer rather than leaking it, so the next
+			// frame of this size is a hit.
+			int newCapacity = RoundUpBufferSize(length);
+			char* newData = (char*)realloc(buffer->Data, newCapacity);
+			if (newData != NULL)
+			{
+				buffer->Data = newData;
+				buffer->Capacity = newCapacity;
+				if (m_BufferSize < newCapacity)
+				{
+					m_BufferSize = newCapacity;
+				}
+
+				m_FreeBuffers.pop_back();
+				m_Misses++;
+				return buffer;
+			}
+		}
+	}
+
+	// The pool is exhausted, so hand out a one-off buffer that is freed on release.
+	m_Misses++;
+	return AllocateFrameBuffer(length, false);
+}
+
+void FrameBufferPool::Release(FrameBuffer* buffer)
+{
+	if (buffer == NULL)
+	{
+		return;
+	}
+
+	if (!buffer->Pooled)
+	{
+		FreeFrameBuffer(buffer);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_FreeBuffers.push_back(buffer);
+}
+
+int FrameBufferPool::GetBufferSize() const
+{
+	return m_BufferSize;
+}
+
+long long FrameBufferPool::GetHitCount() const
+{
+	return m_Hits;
+}
+
+long long FrameBufferPool::GetMissCount() const
+{
+	return m_Misses;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			struct FrameBuffer
+			{
+				char* Data;
+				int Capacity;
+				bool Pooled;
+			};
+
+			// Fixed-capacity pool of video frame buffers. Buffers are sized up front from
+			// the stream configuration so that steady-state streaming never allocates.
+			// Frames that don't fit, or that arrive while every buffer is in use, are served
+			// from a one-off allocation and counted as misses.
+			class FrameBufferPool
+			{
+			public:
+				FrameBufferPool();
+				~FrameBufferPool();
+
+				bool Initialize(int width, int height, int fps, int bitrateKbps, int bufferCount);
+
+				void Cleanup();
+
+				FrameBuffer* Acquire(int length);
+
+				void Release(FrameBuffer* buffer);
+
+				int GetBufferSize() const;
+
+				long long GetHitCount() const;
+
+				long long GetMissCount() const;
+
+				static int EstimateBufferSize(int width, int height, int fps, int bitrateKbps);
+
+			private:
+				FrameBufferPool(const FrameBufferPool&) = delete;
+				FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+				std::mutex m_Lock;
+				std::vector<FrameBuffer*> m_Buffers;
+				std::vector<FrameBuffer*> m_FreeBuffers;
+
+				// Grown under m_Lock by Acquire, but read by GetBufferSize without it
+				std::atomic<int> m_BufferSize;
+				std::atomic<long long> m_Hits;
+				std::atomic<long long> m_Misses;
+			};
+		}
+	}
+}
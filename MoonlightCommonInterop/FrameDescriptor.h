@@ -0,0 +1,28 @@
+#pragma once
+
+#include "FrameSliceTypes.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Summary of a frame's bitstream, built while the interop layer indexes it
+			public value struct FrameDescriptor
+			{
+				int FrameNumber;
+				int FrameType;
+				bool Idr;
+
+				// Some picture in the frame may be used to predict later frames
+				bool Reference;
+
+				// Mastering display colour volume or content light level SEI present
+				bool HdrMetadata;
+
+				FrameSliceTypes SliceTypes;
+			};
+		}
+	}
+}
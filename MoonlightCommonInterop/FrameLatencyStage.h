@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			public enum class FrameLatencyStage
+			{
+				// First packet of the frame received until moonlight-common-c hands over the reassembled frame
+				Reassembly,
+
+				// Reassembled frame until its buffer list has been copied for the renderer
+				BufferCopy,
+
+				// Buffer copied until the renderer is called, including time spent in the decode queue
+				QueueWait,
+
+				// Time spent inside the renderer's HandleFrame calls
+				Render,
+
+				// Renderer returning until it reports the frame as presented
+				Present,
+
+				// First packet received until the renderer returns
+				ReceiveToRender,
+
+				// First packet received until the renderer reports the frame as presented
+				ReceiveToPresent,
+			};
+		}
+	}
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include "FrameLatencyTracker.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Enough history for several seconds of video at high frame rates
+#define FRAME_TRACE_RECORD_COUNT 1024
+
+#define INVALID_FRAME_NUMBER -1
+
+FrameLatencyTracker::FrameLatencyTracker()
+	: m_Records(FRAME_TRACE_RECORD_COUNT)
+{
+	Reset();
+}
+
+void FrameLatencyTracker::Reset()
+{
+	for (FrameTraceRecord& record : m_Records)
+	{
+		record.FrameNumber = INVALID_FRAME_NUMBER;
+		for (int i = 0; i < FrameTracePointCount; i++)
+		{
+			record.TimestampsUs[i] = 0;
+		}
+	}
+}
+
+FrameLatencyTracker::FrameTraceRecord* FrameLatencyTracker::GetRecord(int frameNumber)
+{
+	return &m_Records[(unsigned int)frameNumber % m_Records.size()];
+}
+
+void FrameLatencyTracker::BeginFrame(int frameNumber, long long firstPacketReceivedUs, long long reassembledUs)
+{
+	FrameTraceRecord* record = GetRecord(frameNumber);
+
+	// Invalidate the slot while it is being rewritten so that readers
+	// never pair timestamps from two different frames.
+	record->FrameNumber.store(INVALID_FRAME_NUMBER, std::memory_order_relaxed);
+	for (int i = 0; i < FrameTracePointCount; i++)
+	{
+		record->TimestampsUs[i].store(0, std::memory_order_relaxed);
+	}
+
+	record->TimestampsUs[FrameTraceFirstPacketReceived].store(firstPacketReceivedUs, std::memory_order_relaxed);
+	record->TimestampsUs[FrameTraceReassembled].store(reassembledUs, std::memory_order_relaxed);
+	record->FrameNumber.store(frameNumber, std::memory_order_release);
+}
+
+void FrameLatencyTracker::RecordPoint(int frameNumber, FrameTracePoint point, long long timestampUs)
+{
+	FrameTraceRecord* record = GetRecord(frameNumber);
+	if (record->FrameNumber.load(std::memory_order_acquire) == frameNumber)
+	{
+		record->TimestampsUs[point].store(timestampUs, std::memory_order_release);
+	}
+}
+
+static long long GetPercentile(std::vector<long long>& samples, int percentile)
+{
+	size_t index = (samples.size() - 1) * percentile / 100;
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index];
+}
+
+LatencyPercentileResult Moonlight::Xbox::Interop::ComputeLatencyPercentiles(std::vector<long long>& samples)
+{
+	LatencyPercentileResult result = {};
+	result.SampleCount = (int)samples.size();
+	if (!samples.empty())
+	{
+		result.P50Us = GetPercentile(samples, 50);
+		result.P95Us = GetPercentile(samples, 95);
+		result.P99Us = GetPercentile(samples, 99);
+	}
+
+	return result;
+}
+
+LatencyPercentileResult FrameLatencyTracker::GetPercentiles(FrameTracePoint from, FrameTracePoint to) const
+{
+	std::vector<long long> samples;
+	samples.reserve(m_Records.size());
+
+	for (const FrameTraceRecord& record : m_Records)
+	{
+		int frameNumber = record.FrameNumber.load(std::memory_order_acquire);
+		if (frameNumber == INVALID_FRAME_NUMBER)
+		{
+			continue;
+		}
+
+		long long fromUs = record.TimestampsUs[from].load(std::memory_order_acquire);
+		long long toUs = record.TimestampsUs[to].load(std::memory_order_acquire);
+
+		// Skip records that were recycled while we were reading them
+		if (fromUs == 0 || toUs == 0 || toUs < fromUs ||
+			record.FrameNumber.load(std::memory_order_acquire) != frameNumber)
+		{
+			continue;
+		}
+
+		samples.push_back(toUs - fromUs);
+	}
+
+	return ComputeLatencyPercentiles(samples);
+}
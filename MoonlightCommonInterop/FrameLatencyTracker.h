@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Points in a frame's life at which a timestamp is recorded
+			enum FrameTracePoint
+			{
+				FrameTraceFirstPacketReceived,
+				FrameTraceReassembled,
+				FrameTraceBufferCopied,
+				FrameTraceRenderStart,
+				FrameTraceRenderEnd,
+				FrameTracePresented,
+				FrameTracePointCount
+			};
+
+			struct LatencyPercentileResult
+			{
+				int SampleCount;
+				long long P50Us;
+				long long P95Us;
+				long long P99Us;
+			};
+
+			// Reorders the samples in the process
+			LatencyPercentileResult ComputeLatencyPercentiles(std::vector<long long>& samples);
+
+			// Records per-frame timestamps into a fixed ring indexed by frame number. Each
+			// trace point may be written from a different thread, so every slot is tagged
+			// with the frame number it currently describes and writers for stale frames
+			// are ignored. Nothing on the recording side locks or allocates.
+			class FrameLatencyTracker
+			{
+			public:
+				FrameLatencyTracker();
+
+				void Reset();
+
+				// Starts a new record, overwriting whatever frame previously used the slot
+				void BeginFrame(int frameNumber, long long firstPacketReceivedUs, long long reassembledUs);
+
+				void RecordPoint(int frameNumber, FrameTracePoint point, long long timestampUs);
+
+				// Computes percentiles of the time between two trace points across every
+				// record in the ring that has both of them.
+				LatencyPercentileResult GetPercentiles(FrameTracePoint from, FrameTracePoint to) const;
+
+			private:
+				FrameLatencyTracker(const FrameLatencyTracker&) = delete;
+				FrameLatencyTracker& operator=(const FrameLatencyTracker&) = delete;
+
+				struct FrameTraceRecord
+				{
+					std::atomic<int> FrameNumber;
+					std::atomic<long long> TimestampsUs[FrameTracePointCount];
+				};
+
+				FrameTraceRecord* GetRecord(int frameNumber);
+
+				std::vector<FrameTraceRecord> m_Records;
+			};
+		}
+	}
+}
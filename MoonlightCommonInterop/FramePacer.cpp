@@ -0,0 +1,386 @@
+#include "Limelight.h"
+#include "Clock.h"
+#include "FramePacer.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define DEFAULT_FPS 60
+
+// Smoothing factor for the measured vsync period
+#define VSYNC_PERIOD_SMOOTHING 8
+
+// Vsync is synthesised once the renderer hasn't reported one for this many periods
+#define VSYNC_TIMEOUT_PERIODS 2
+
+// Frames the smoothest policy keeps ready ahead of the display
+#define SMOOTH_BUFFERED_FRAMES 1
+
+FramePacer::FramePacer()
+	: m_Mode(FramePacingOff),
+	m_FrameBufferPool(NULL),
+	m_Handler(NULL),
+	m_Context(NULL),
+	m_Stopping(true),
+	m_PendingHead(0),
+	m_PendingCount(0),
+	m_DeliveryCount(0),
+	m_WaitingForIdr(false),
+	m_RendererFailed(false),
+	m_FramePeriodUs(0),
+	m_VsyncPeriodUs(0),
+	m_LastVsyncUs(0),
+	m_LastExternalVsyncUs(0),
+	m_NextSyntheticVsyncUs(0),
+	m_VsyncCount(0),
+	m_HandledVsyncCount(0),
+	m_FrameCreditUs(0),
+	m_Primed(false),
+	m_LastArrivalUs(0),
+	m_FramesDisplayed(0),
+	m_FramesDropped(0),
+	m_FramesLate(0)
+{
+}
+
+FramePacer::~FramePacer()
+{
+	Stop();
+}
+
+bool FramePacer::Start(FramePacingMode mode, int fps, int refreshRateX100, FrameBufferPool* frameBufferPool, VideoFrameHandler handler, void* context)
+{
+	Stop();
+
+	if (mode == FramePacingOff)
+	{
+		return false;
+	}
+
+	m_Mode = mode;
+	m_FrameBufferPool = frameBufferPool;
+	m_Handler = handler;
+	m_Context = context;
+	m_PendingHead = 0;
+	m_PendingCount = 0;
+	m_DeliveryCount = 0;
+	m_WaitingForIdr = false;
+	m_RendererFailed = false;
+
+	m_FramePeriodUs = 1000000 / (fps > 0 ? fps : DEFAULT_FPS);
+	m_VsyncPeriodUs = refreshRateX100 > 0 ? (int)(100000000LL / refreshRateX100) : (int)m_FramePeriodUs;
+	m_LastVsyncUs = 0;
+	m_LastExternalVsyncUs = 0;
+	m_NextSyntheticVsyncUs = GetTimeMicroseconds() + m_VsyncPeriodUs;
+	m_VsyncCount = 0;
+	m_HandledVsyncCount = 0;
+	m_FrameCreditUs = 0;
+	m_Primed = false;
+	m_LastArrivalUs = 0;
+
+	m_FramesDisplayed = 0;
+	m_FramesDropped = 0;
+	m_FramesLate = 0;
+
+	m_Stopping = false;
+	m_Thread = std::thread(&FramePacer::ThreadProc, this);
+	return true;
+}
+
+void FramePacer::Stop()
+{
+	if (!m_Thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Stopping = true;
+	}
+	m_Condition.notify_one();
+	m_Thread.join();
+
+	// Submit checks m_Stopping under the lock, so nothing is added after this
+	std::lock_guard<std::mutex> lock(m_Lock);
+	while (m_PendingCount > 0)
+	{
+		m_FrameBufferPool->Release(m_Pending[m_PendingHead].Frame.Buffer);
+		m_PendingHead = (m_PendingHead + 1) % FRAME_PACER_CAPACITY;
+		m_PendingCount--;
+	}
+}
+
+int FramePacer::Submit(const VideoFrame* frame, bool reference)
+{
+	long long nowUs = GetTimeMicroseconds();
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (m_Stopping)
+	{
+		// The stream is ending, so there is nothing to request an IDR frame for
+		m_FrameBufferPool->Release(frame->Buffer);
+		return DR_OK;
+	}
+
+	// One IDR request covers every failure until the IDR frame arrives
+	if (m_RendererFailed.exchange(false) && frame->FrameType != FRAME_TYPE_IDR && !m_WaitingForIdr)
+	{
+		// The decoder state is no longer trustworthy, so resync on the next IDR frame
+		m_WaitingForIdr = true;
+		m_FrameBufferPool->Release(frame->Buffer);
+		m_FramesDropped++;
+		return DR_NEED_IDR;
+	}
+
+	if (m_WaitingForIdr)
+	{
+		if (frame->FrameType != FRAME_TYPE_IDR)
+		{
+			m_FrameBufferPool->Release(frame->Buffer);
+			m_FramesDropped++;
+			return DR_OK;
+		}
+
+		m_WaitingForIdr = false;
+	}
+
+	// With nothing to wait for, a frame is late when it misses the interval it was due in
+	if (m_Mode == FramePacingLowestLatency &&
+		m_LastArrivalUs != 0 &&
+		nowUs - m_LastArrivalUs > m_FramePeriodUs * 3 / 2)
+	{
+		m_FramesLate++;
+	}
+	m_LastArrivalUs = nowUs;
+
+	if (m_PendingCount == FRAME_PACER_CAPACITY)
+	{
+		// The display has stalled. Dropping this frame breaks the reference chain,
+		// so everything up to the next IDR frame goes with it.
+		m_WaitingForIdr = true;
+		m_FrameBufferPool->Release(frame->Buffer);
+		m_FramesDropped++;
+		return DR_NEED_IDR;
+	}
+
+	PendingFrame& pending = m_Pending[(m_PendingHead + m_PendingCount) % FRAME_PACER_CAPACITY];
+	pending.Frame = *frame;
+	pending.Frame.EnqueueTimeUs = nowUs;
+	pending.Reference = reference;
+	m_PendingCount++;
+
+	m_Condition.notify_one();
+	return DR_OK;
+}
+
+void FramePacer::NotifyVsync(long long timestampUs)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		if (m_LastExternalVsyncUs != 0)
+		{
+			int periodUs = m_VsyncPeriodUs;
+			long long intervalUs = timestampUs - m_LastExternalVsyncUs;
+
+			// Skip intervals that span missed vsyncs or a pause in reporting
+			if (intervalUs > 0 && intervalUs < periodUs * 3 / 2)
+			{
+				m_VsyncPeriodUs = periodUs + (int)((intervalUs - periodUs) / VSYNC_PERIOD_SMOOTHING);
+			}
+		}
+
+		m_LastExternalVsyncUs = timestampUs;
+		m_LastVsyncUs = timestampUs;
+		m_VsyncCount++;
+	}
+
+	m_Condition.notify_one();
+}
+
+void FramePacer::PopFrame(bool deliver)
+{
+	PendingFrame& pending = m_Pending[m_PendingHead];
+	m_PendingHead = (m_PendingHead + 1) % FRAME_PACER_CAPACITY;
+	m_PendingCount--;
+
+	if (deliver)
+	{
+		m_Deliveries[m_DeliveryCount++] = pending.Frame;
+		m_FramesDisplayed++;
+	}
+	else
+	{
+		m_FrameBufferPool->Release(pending.Frame.Buffer);
+		m_FramesDropped++;
+	}
+}
+
+void FramePacer::OnVsync(long long timestampUs)
+{
+	m_LastVsyncUs = timestampUs;
+
+	// Only act on vsyncs that start a new frame interval. Allow half a vsync of
+	// slack so rates like 59.94 Hz against 60 fps don't skip intervals.
+	m_FrameCreditUs += m_VsyncPeriodUs;
+	if (m_FrameCreditUs < m_FramePeriodUs - m_VsyncPeriodUs / 2)
+	{
+		return;
+	}
+
+	m_FrameCreditUs -= m_FramePeriodUs;
+	if (m_FrameCreditUs > m_FramePeriodUs)
+	{
+		m_FrameCreditUs = 0;
+	}
+
+	if (m_Mode == FramePacingSmoothest)
+	{
+		// Refill the buffer before starting, and again after running dry
+		if (!m_Primed)
+		{
+			if (m_PendingCount <= SMOOTH_BUFFERED_FRAMES)
+			{
+				return;
+			}
+			m_Primed = true;
+		}
+
+		if (m_PendingCount == 0)
+		{
+			m_FramesLate++;
+			m_Primed = false;
+			return;
+		}
+
+		PopFrame(true);
+
+		// Catch up when frames arrive faster than the display takes them
+		while (m_PendingCount > SMOOTH_BUFFERED_FRAMES + 1)
+		{
+			PopFrame(m_Pending[m_PendingHead].Reference);
+		}
+	}
+	else
+	{
+		if (m_PendingCount == 0)
+		{
+			if (m_FramesDisplayed > 0)
+			{
+				m_FramesLate++;
+			}
+			return;
+		}
+
+		while (m_PendingCount > 1)
+		{
+			PopFrame(m_Pending[m_PendingHead].Reference);
+		}
+		PopFrame(true);
+	}
+}
+
+void FramePacer::DeliverFrames()
+{
+	for (int i = 0; i < m_DeliveryCount; i++)
+	{
+		if (m_Handler(&m_Deliveries[i], m_Context) != DR_OK)
+		{
+			m_RendererFailed = true;
+		}
+
+		m_FrameBufferPool->Release(m_Deliveries[i].Buffer);
+	}
+
+	m_DeliveryCount = 0;
+}
+
+void FramePacer::ThreadProc()
+{
+	std::unique_lock<std::mutex> lock(m_Lock);
+	while (!m_Stopping)
+	{
+		if (m_Mode == FramePacingLowestLatency)
+		{
+			if (m_PendingCount == 0)
+			{
+				m_Condition.wait(lock);
+				continue;
+			}
+
+			while (m_PendingCount > 0)
+			{
+				PopFrame(true);
+			}
+		}
+		else
+		{
+			long long nowUs = GetTimeMicroseconds();
+			long long timeoutUs = (long long)m_VsyncPeriodUs * VSYNC_TIMEOUT_PERIODS;
+			bool externalVsync = m_LastExternalVsyncUs != 0 && nowUs - m_LastExternalVsyncUs < timeoutUs;
+
+			if (m_VsyncCount != m_HandledVsyncCount)
+			{
+				m_HandledVsyncCount = m_VsyncCount;
+				OnVsync(m_LastVsyncUs);
+			}
+			else if (!externalVsync && nowUs >= m_NextSyntheticVsyncUs)
+			{
+				OnVsync(nowUs);
+
+				m_NextSyntheticVsyncUs += m_VsyncPeriodUs;
+				if (m_NextSyntheticVsyncUs <= nowUs)
+				{
+					m_NextSyntheticVsyncUs = nowUs + m_VsyncPeriodUs;
+				}
+			}
+			else
+			{
+				if (externalVsync)
+				{
+					// Wake up in time to take over if the renderer stops reporting vsync
+					m_NextSyntheticVsyncUs = m_LastExternalVsyncUs + timeoutUs;
+				}
+
+				m_Condition.wait_until(
+					lock,
+					std::chrono::steady_clock::time_point(std::chrono::microseconds(m_NextSyntheticVsyncUs)));
+				continue;
+			}
+		}
+
+		if (m_DeliveryCount > 0)
+		{
+			// Render outside the lock so the receive path never waits on the renderer
+			lock.unlock();
+			DeliverFrames();
+			lock.lock();
+		}
+	}
+}
+
+FramePacingMode FramePacer::GetMode() const
+{
+	return m_Mode;
+}
+
+long long FramePacer::GetFramesDisplayed() const
+{
+	return m_FramesDisplayed;
+}
+
+long long FramePacer::GetFramesDropped() const
+{
+	return m_FramesDropped;
+}
+
+long long FramePacer::GetFramesLate() const
+{
+	return m_FramesLate;
+}
+
+int FramePacer::GetVsyncPeriodUs() const
+{
+	return m_VsyncPeriodUs;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "FrameBufferPool.h"
+#include "VideoDecodeQueue.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Same values as the WinRT FramePacingPolicy enum
+			enum FramePacingMode
+			{
+				FramePacingOff,
+				FramePacingLowestLatency,
+				FramePacingSmoothest,
+				FramePacingMailbox,
+			};
+
+			// Most frames the pacer holds before it starts catching up
+			#define FRAME_PACER_CAPACITY 8
+
+			// Releases assembled frames to the renderer on its own thread, in step with the
+			// display. The renderer reports each vsync through NotifyVsync. Until it does,
+			// or if it stops, vsync is synthesised from the client refresh rate.
+			//
+			// - Lowest latency hands each frame over as soon as it arrives.
+			// - Smoothest keeps one frame buffered and releases one per frame interval.
+			// - Mailbox releases the newest frame each interval. Older non-reference
+			//   frames are dropped, and older reference frames are still handed over
+			//   first so the decoder's reference chain stays intact.
+			//
+			// Frame intervals are counted in vsyncs, so a 60 fps stream on a 120 Hz
+			// display is released on every other vsync.
+			class FramePacer
+			{
+			public:
+				FramePacer();
+				~FramePacer();
+
+				bool Start(FramePacingMode mode, int fps, int refreshRateX100, FrameBufferPool* frameBufferPool, VideoFrameHandler handler, void* context);
+
+				void Stop();
+
+				// Takes ownership of the frame's buffer. Frames submitted while the pacer
+				// isn't running are dropped, since moonlight-common-c stops the renderer
+				// before it joins its own threads.
+				int Submit(const VideoFrame* frame, bool reference);
+
+				void NotifyVsync(long long timestampUs);
+
+				FramePacingMode GetMode() const;
+
+				long long GetFramesDisplayed() const;
+
+				long long GetFramesDropped() const;
+
+				long long GetFramesLate() const;
+
+				int GetVsyncPeriodUs() const;
+
+			private:
+				FramePacer(const FramePacer&) = delete;
+				FramePacer& operator=(const FramePacer&) = delete;
+
+				struct PendingFrame
+				{
+					VideoFrame Frame;
+					bool Reference;
+				};
+
+				void ThreadProc();
+
+				// Picks the frames to release on a vsync. Called with m_Lock held.
+				void OnVsync(long long timestampUs);
+
+				void PopFrame(bool deliver);
+
+				void DeliverFrames();
+
+				FramePacingMode m_Mode;
+				FrameBufferPool* m_FrameBufferPool;
+				VideoFrameHandler m_Handler;
+				void* m_Context;
+
+				std::mutex m_Lock;
+				std::condition_variable m_Condition;
+				std::thread m_Thread;
+				bool m_Stopping;
+
+				PendingFrame m_Pending[FRAME_PACER_CAPACITY];
+				int m_PendingHead;
+				int m_PendingCount;
+
+				// Frames picked for release, handed to the renderer outside the lock
+				VideoFrame m_Deliveries[FRAME_PACER_CAPACITY];
+				int m_DeliveryCount;
+
+				// Set after a frame had to be dropped or failed to render, until the next IDR frame
+				bool m_WaitingForIdr;
+				std::atomic<bool> m_RendererFailed;
+
+				long long m_FramePeriodUs;
+				std::atomic<int> m_VsyncPeriodUs;
+				long long m_LastVsyncUs;
+				long long m_LastExternalVsyncUs;
+				long long m_NextSyntheticVsyncUs;
+				unsigned long long m_VsyncCount;
+				unsigned long long m_HandledVsyncCount;
+
+				// Time owed towards the next frame interval, advanced by one vsync period per vsync
+				long long m_FrameCreditUs;
+				bool m_Primed;
+				long long m_LastArrivalUs;
+
+				std::atomic<long long> m_FramesDisplayed;
+				std::atomic<long long> m_FramesDropped;
+				std::atomic<long long> m_FramesLate;
+			};
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// How decoded frames are released to the renderer relative to the display's
+			// vsync. Anything other than Off replaces the decode queue with the frame pacer.
+			public enum class FramePacingPolicy
+			{
+				// Frames are rendered on moonlight-common-c's receive thread, or through
+				// the decode queue if VideoDecodeQueueDepth is set
+				Off,
+
+				// Each frame is handed over as soon as it arrives
+				LowestLatency,
+
+				// One frame is kept buffered and one is released per frame interval
+				Smoothest,
+
+				// The newest frame is released each frame interval and older ones dropped
+				Mailbox,
+			};
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Slice types in a frame, shared by H.264 and HEVC. SP and SI slices are
+			// reported as P and I.
+			[Platform::Metadata::Flags]
+			public enum class FrameSliceTypes : unsigned int
+			{
+				None = 0,
+				I = 0x1,
+				P = 0x2,
+				B = 0x4,
+			};
+		}
+	}
+}
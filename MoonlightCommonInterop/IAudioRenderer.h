@@ -12,6 +12,14 @@ namespace Moonlight
 			{
 				property int Capabilities;
 
+				// Sample rate HandleFrame should receive, or 0 for the stream's native rate
+				property int OutputSampleRate;
+
+				// Most decoded frames to concatenate into one HandleFrame call. 0 or 1
+				// submits every frame on its own. With AdaptiveBatching set, the interop
+				// only batches as far as the measured cost of HandleFrame calls for.
+				property int MaxFramesPerSubmission;
+
 				int Initialize(int audioFormat);
 
 				void Start();
@@ -1,5 +1,10 @@
 #pragma once
 
+#include "BufferView.h"
+#include "FrameDescriptor.h"
+#include "NalUnitDescriptor.h"
+#include "RendererCapabilities.h"
+
 namespace Moonlight
 {
 	namespace Xbox
@@ -21,6 +26,12 @@ namespace Moonlight
 				void Cleanup();
 
 				int HandleFrame(const Array<unsigned char>^ frameData, int frameType, int frameNumber, __int64 receiveTimeMs);
+
+				int HandleFrameBufferList(const Array<BufferView>^ buffers, int frameType, int frameNumber, __int64 receiveTimeMs);
+
+				// Called before the frame it describes is handed over, when the renderer
+				// sets VideoRendererCapabilities::FrameDescriptors
+				void HandleFrameDescriptor(FrameDescriptor descriptor, const Array<NalUnitDescriptor>^ nalUnits);
 			};
 		}
 	}
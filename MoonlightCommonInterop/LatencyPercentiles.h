@@ -0,0 +1,24 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			using namespace Platform;
+
+			public ref class LatencyPercentiles sealed
+			{
+			public:
+				property int SampleCount;
+
+				property __int64 P50Us;
+
+				property __int64 P95Us;
+
+				property __int64 P99Us;
+			};
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Lowest severity of moonlight-common-c log message passed to IConnectionListener::LogMessage
+			public enum class LogLevel
+			{
+				Verbose,
+				Info,
+				Warning,
+				Error,
+			};
+		}
+	}
+}
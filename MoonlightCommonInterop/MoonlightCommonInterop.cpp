@@ -1,354 +1,553 @@
-#include <stdarg.h>
-#include <string>
-#include <opus_multistream.h>
+#include <memory>
+#include <mutex>
+#include <ppltasks.h>
 #include "Limelight.h"
+#include "PlatformStringMarshaling.h"
+#include "SessionCallbacks.h"
+#include "StreamingSession.h"
+#include "WinRtRendererAdapters.h"
 #include "MoonlightCommonInterop.h"
 
 using namespace Platform;
 using namespace Moonlight::Xbox::Interop;
 
-// C callback declarations
-static int DrSetup(int videoFormat, int width, int height, int redrawRate, void* context, int drFlags);
-static void DrStart();
-static void DrStop();
-static void DrCleanup();
-static int DrSubmitDecodeUnit(PDECODE_UNIT decodeUnit);
-static int ArInit(int audioConfiguration, const POPUS_MULTISTREAM_CONFIGURATION opusConfig, void* context, int arFlags);
-static void ArStart();
-static void ArStop();
-static void ArCleanup();
-static void ArDecodeAndPlaySample(char *sampleData, int sampleLength);
-static void ClStageStarting(int stage);
-static void ClStageComplete(int stage);
-static void ClStageFailed(int stage, long errorCode);
-static void ClConnectionStarted();
-static void ClConnectionTerminated(long errorCode);
-static void ClDisplayMessage(const char* message);
-static void ClDisplayTransientMessage(const char* message);
-static void ClLogMessage(const char* format, ...);
-
-static IVideoRenderer^ s_VideoRenderer;
-static IAudioRenderer^ s_AudioRenderer;
-static IConnectionListener^ s_ConnectionListener;
-
-#define INITIAL_FRAME_BUFFER_SIZE 32768
-static int s_VideoFrameBufferSize = 0;
-static char* s_VideoFrameBuffer = NULL;
-
-#define PCM_FRAME_SIZE 240
-#define CHANNEL_COUNT 2
-static int s_AudioFrameBufferSize = 0;
-static char* s_AudioFrameBuffer = NULL;
-static OpusMSDecoder* s_OpusDecoder = NULL;
-
-inline String^ CStringToPlatformString(const char* string)
+// Connects the session using the stream configuration it holds
+static int StartSessionConnection(StreamingSession* session)
 {
-	std::string stdString = std::string(string);
-	std::wstring wString = std::wstring(stdString.begin(), stdString.end());
-	return ref new String(wString.c_str());
-}
+	SERVER_INFORMATION interopServerInformation;
+	LiInitializeServerInformation(&interopServerInformation);
+	interopServerInformation.address = session->GetConfiguration().Address.c_str();
+	interopServerInformation.serverInfoAppVersion = session->GetConfiguration().AppVersion.c_str();
+	interopServerInformation.serverInfoGfeVersion = session->GetConfiguration().GfeVersion.c_str();
 
-inline const char* PlatformStringToCString(String^ string)
-{
-	std::wstring wString(string->Begin());
-	std::string stdString(wString.begin(), wString.end());
-	return stdString.c_str();
+	STREAM_CONFIGURATION interopStreamConfiguration = session->GetStreamConfiguration();
+
+	DECODER_RENDERER_CALLBACKS interopVideoRendererCallbacks;
+	AUDIO_RENDERER_CALLBACKS interopAudioRendererCallbacks;
+	CONNECTION_LISTENER_CALLBACKS interopConnectionListenerCallbacks;
+	InitializeStreamingSessionCallbacks(
+		session,
+		&interopVideoRendererCallbacks,
+		&interopAudioRendererCallbacks,
+		&interopConnectionListenerCallbacks);
+
+	return
+		LiStartConnection(
+			&interopServerInformation,
+			&interopStreamConfiguration,
+			&interopConnectionListenerCallbacks,
+			&interopVideoRendererCallbacks,
+			&interopAudioRendererCallbacks,
+			session,
+			0,
+			session,
+			0);
 }
 
-int DrSetup(
-	int videoFormat,
-	int width,
-	int height,
-	int redrawRate,
-	void* context,
-	int drFlags)
+MoonlightCommonInterop::MoonlightCommonInterop()
 {
-	return s_VideoRenderer->Initialize(videoFormat, width, height, redrawRate);
 }
 
-void DrStart()
+MoonlightCommonInterop::~MoonlightCommonInterop()
 {
-	s_VideoRenderer->Start();
+	StopConnection();
 }
 
-void DrStop()
+std::shared_ptr<StreamingSession> MoonlightCommonInterop::GetSession()
 {
-	s_VideoRenderer->Stop();
+	std::lock_guard<std::mutex> lock(m_SessionLock);
+	return m_Session;
 }
 
-void DrCleanup()
+int MoonlightCommonInterop::StartConnection(
+	String^ address,
+	String^ appVersion,
+	String^ gfeVersion,
+	StreamConfiguration^ streamConfiguration,
+	IVideoRenderer^ videoRenderer,
+	IAudioRenderer^ audioRenderer,
+	IConnectionListener^ connectionListener)
 {
-	if (s_VideoFrameBuffer != NULL)
+	StopConnection();
+
+	StreamingSessionConfiguration sessionConfiguration;
+	sessionConfiguration.Address = PlatformStringToUtf8(address);
+	sessionConfiguration.AppVersion = PlatformStringToUtf8(appVersion);
+	sessionConfiguration.GfeVersion = PlatformStringToUtf8(gfeVersion);
+	sessionConfiguration.Width = streamConfiguration->Width;
+	sessionConfiguration.Height = streamConfiguration->Height;
+	sessionConfiguration.Fps = streamConfiguration->Fps;
+	sessionConfiguration.Bitrate = streamConfiguration->Bitrate;
+	sessionConfiguration.VideoDecodeQueueDepth = streamConfiguration->VideoDecodeQueueDepth;
+	sessionConfiguration.FramePacing = (int)streamConfiguration->FramePacing;
+	sessionConfiguration.AudioJitterBufferTargetMs = streamConfiguration->AudioJitterBufferTargetMs;
+	sessionConfiguration.AudioDownmixToStereo = streamConfiguration->AudioDownmixToStereo;
+	sessionConfiguration.MinimumLogSeverity = (int)streamConfiguration->MinimumLogLevel;
+	sessionConfiguration.AdaptiveBitrate = streamConfiguration->AdaptiveBitrate != nullptr;
+	sessionConfiguration.AdaptiveBitratePolicy = BitratePolicyConfiguration();
+	if (streamConfiguration->AdaptiveBitrate != nullptr)
 	{
-		free(s_VideoFrameBuffer);
-		s_VideoFrameBuffer = NULL;
-		s_VideoFrameBufferSize = 0;
+		AdaptiveBitratePolicy^ policy = streamConfiguration->AdaptiveBitrate;
+		sessionConfiguration.AdaptiveBitratePolicy.MinimumBitrate = policy->MinimumBitrate;
+		sessionConfiguration.AdaptiveBitratePolicy.MaximumBitrate = policy->MaximumBitrate;
+		sessionConfiguration.AdaptiveBitratePolicy.StepUpPercent = policy->StepUpPercent;
+		sessionConfiguration.AdaptiveBitratePolicy.StepDownPercent = policy->StepDownPercent;
+		sessionConfiguration.AdaptiveBitratePolicy.LossPercentThreshold = policy->LossPercentThreshold;
+		sessionConfiguration.AdaptiveBitratePolicy.JitterThresholdUs = policy->JitterThresholdUs;
+		sessionConfiguration.AdaptiveBitratePolicy.DecodeTimePercentThreshold = policy->DecodeTimePercentThreshold;
+		sessionConfiguration.AdaptiveBitratePolicy.WindowMs = policy->WindowMs;
+		sessionConfiguration.AdaptiveBitratePolicy.StepUpWindows = policy->StepUpWindows;
+		sessionConfiguration.AdaptiveBitratePolicy.StepDownWindows = policy->StepDownWindows;
 	}
 
-	s_VideoRenderer->Cleanup();
-}
+	if (streamConfiguration->AudioDownmixMatrix != nullptr)
+	{
+		sessionConfiguration.AudioDownmixMatrix.assign(
+			streamConfiguration->AudioDownmixMatrix->Data,
+			streamConfiguration->AudioDownmixMatrix->Data + streamConfiguration->AudioDownmixMatrix->Length);
+	}
 
-int DrSubmitDecodeUnit(PDECODE_UNIT decodeUnit)
-{
-	// Resize the frame buffer if the current frame is too big.
-	// This is safe without locking because this function is
-	// called only from a single thread.
-	if (s_VideoFrameBufferSize < decodeUnit->fullLength)
+	std::shared_ptr<StreamingSession> session =
+		std::make_shared<StreamingSession>(
+			sessionConfiguration,
+			new WinRtVideoRenderer(videoRenderer),
+			new WinRtAudioRenderer(audioRenderer),
+			new WinRtConnectionListener(connectionListener));
+
+	STREAM_CONFIGURATION interopStreamConfiguration;
+	LiInitializeStreamConfiguration(&interopStreamConfiguration);
+	interopStreamConfiguration.width = streamConfiguration->Width;
+	interopStreamConfiguration.height = streamConfiguration->Height;
+	interopStreamConfiguration.fps = streamConfiguration->Fps;
+	interopStreamConfiguration.bitrate = streamConfiguration->Bitrate;
+	interopStreamConfiguration.packetSize = streamConfiguration->PacketSize;
+	interopStreamConfiguration.streamingRemotely = streamConfiguration->StreamingRemotely;
+	interopStreamConfiguration.audioConfiguration = streamConfiguration->AudioConfiguration;
+	interopStreamConfiguration.supportsHevc = streamConfiguration->SupportsHevc;
+	interopStreamConfiguration.enableHdr = streamConfiguration->EnableHdr;
+	interopStreamConfiguration.hevcBitratePercentageMultiplier = streamConfiguration->HevcBitratePercentageMultiplier;
+	interopStreamConfiguration.clientRefreshRateX100 = streamConfiguration->ClientRefreshRateX100;
+	memcpy_s(
+		interopStreamConfiguration.remoteInputAesKey,
+		sizeof(interopStreamConfiguration.remoteInputAesKey),
+		streamConfiguration->RemoteInputAesKey->Data,
+		streamConfiguration->RemoteInputAesKey->Length);
+	memcpy_s(
+		interopStreamConfiguration.remoteInputAesKey,
+		sizeof(interopStreamConfiguration.remoteInputAesKey),
+		streamConfiguration->RemoteInputAesKey->Data,
+		streamConfiguration->RemoteInputAesKey->Length);
+	session->SetStreamConfiguration(interopStreamConfiguration);
+
+	// Another instance is connected. moonlight-common-c's state is global, so
+	// starting a second connection would take over its callbacks.
+	if (!ActivateStreamingSession(session.get()))
 	{
-		s_VideoFrameBufferSize = decodeUnit->fullLength;
-		s_VideoFrameBuffer = (char*)malloc(s_VideoFrameBufferSize);
+		return -1;
 	}
 
-	if (s_VideoFrameBuffer == NULL)
 	{
-		s_VideoFrameBufferSize = 0;
-		return DR_NEED_IDR;
+		// The previous session is freed once the last snapshot of it is dropped
+		std::lock_guard<std::mutex> lock(m_SessionLock);
+		m_Session = session;
 	}
 
-	PLENTRY currentEntry = decodeUnit->bufferList;
-	int offset = 0;
-	while (currentEntry != NULL)
+	int err = StartSessionConnection(session.get());
+	if (err != 0)
 	{
-		// Submit parameter set NALUs separately from picture data
-		if (currentEntry->bufferType != BUFFER_TYPE_PICDATA)
-		{
-			// Use the beginning of the buffer each time since this is a separate
-			// invocation of the decoder each time.
-			memcpy(&s_VideoFrameBuffer[0], currentEntry->data, currentEntry->length);
-
-			int ret =
-				s_VideoRenderer->HandleFrame(
-					ArrayReference<unsigned char>((unsigned char*)s_VideoFrameBuffer, currentEntry->length),
-					currentEntry->bufferType,
-					decodeUnit->frameNumber,
-					decodeUnit->receiveTimeMs);
-			if (ret != DR_OK)
-			{
-				return ret;
-			}
-		}
-		else
-		{
-			memcpy(&s_VideoFrameBuffer[offset], currentEntry->data, currentEntry->length);
-			offset += currentEntry->length;
-			currentEntry = currentEntry->next;
-		}
+		// moonlight-common-c has already torn everything down
+		SetActiveStreamingSession(NULL);
 	}
 
-	return
-		s_VideoRenderer->HandleFrame(
-			ArrayReference<unsigned char>((unsigned char*)s_VideoFrameBuffer, offset),
-			BUFFER_TYPE_PICDATA,
-			decodeUnit->frameNumber,
-			decodeUnit->receiveTimeMs);
+	return err;
 }
 
-int ArInit(
-	int audioConfiguration,
-	const POPUS_MULTISTREAM_CONFIGURATION opusConfig,
-	void* context,
-	int arFlags)
+int MoonlightCommonInterop::Reconnect()
 {
-	int err = s_AudioRenderer->Initialize(audioConfiguration);
-	if (err != 0)
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session == NULL)
 	{
-		return err;
+		return -1;
 	}
 
-	s_OpusDecoder =
-		opus_multistream_decoder_create(
-			opusConfig->sampleRate,
-			opusConfig->channelCount,
-			opusConfig->streams,
-			opusConfig->coupledStreams,
-			opusConfig->mapping,
-			&err);
-	if (s_OpusDecoder == NULL)
+	bool connected = GetActiveStreamingSession() == session.get();
+	if (!connected && !ActivateStreamingSession(session.get()))
 	{
-		ArCleanup();
 		return -1;
 	}
 
-	// We know ahead of time what the buffer size will be for decoded audio, so pre-allocate it
-	s_AudioFrameBufferSize = opusConfig->channelCount * PCM_FRAME_SIZE * sizeof(opus_int16);
-	s_AudioFrameBuffer = (char *)malloc(s_AudioFrameBufferSize);
+	// Keep the renderers and decoders through the teardown of the old transport
+	// so the new connection's setup callbacks can pick them straight back up.
+	session->SetRetainResources(true);
+	if (connected)
+	{
+		LiStopConnection();
+	}
+
+	session->BeginReconnect();
+	int err = StartSessionConnection(session.get());
+	session->SetRetainResources(false);
+	if (err != 0)
+	{
+		SetActiveStreamingSession(NULL);
+		session->ReleaseResources();
+	}
 
 	return err;
 }
 
-void ArStart()
+int MoonlightCommonInterop::AdjustBitrate()
 {
-	s_AudioRenderer->Start();
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session == NULL)
+	{
+		return -1;
+	}
+
+	STREAM_CONFIGURATION streamConfiguration = session->GetStreamConfiguration();
+	int targetBitrate = session->GetBitrateController().GetTargetBitrate();
+	if (targetBitrate == streamConfiguration.bitrate)
+	{
+		return 0;
+	}
+
+	// The host only takes a bitrate during the handshake. If the reconnect fails
+	// the previous configuration is put back, so GetVideoStatistics and a later
+	// Reconnect don't use a bitrate the host never agreed to.
+	STREAM_CONFIGURATION previousConfiguration = streamConfiguration;
+	streamConfiguration.bitrate = targetBitrate;
+	session->SetStreamConfiguration(streamConfiguration);
+
+	int err = Reconnect();
+	if (err != 0)
+	{
+		session->SetStreamConfiguration(previousConfiguration);
+	}
+
+	return err;
 }
 
-void ArStop()
+IAsyncOperation<int>^ MoonlightCommonInterop::StartConnectionAsync(
+	String^ address,
+	String^ appVersion,
+	String^ gfeVersion,
+	StreamConfiguration^ streamConfiguration,
+	IVideoRenderer^ videoRenderer,
+	IAudioRenderer^ audioRenderer,
+	IConnectionListener^ connectionListener)
 {
-	s_AudioRenderer->Stop();
+	MoonlightCommonInterop^ self = this;
+	return concurrency::create_async(
+		[self, address, appVersion, gfeVersion, streamConfiguration, videoRenderer, audioRenderer, connectionListener](
+			concurrency::cancellation_token cancellationToken) -> int
+	{
+		// LiInterruptConnection would also tear down a connection that has already
+		// started, so only let the cancellation callback call it during the handshake.
+		struct HandshakeState
+		{
+			std::mutex Lock;
+			bool Connecting;
+		};
+		auto state = std::make_shared<HandshakeState>();
+		state->Connecting = true;
+
+		concurrency::cancellation_token_registration registration;
+		if (cancellationToken.is_cancelable())
+		{
+			registration = cancellationToken.register_callback([state]()
+			{
+				std::lock_guard<std::mutex> lock(state->Lock);
+				if (state->Connecting)
+				{
+					LiInterruptConnection();
+				}
+			});
+		}
+
+		int err =
+			self->StartConnection(
+				address,
+				appVersion,
+				gfeVersion,
+				streamConfiguration,
+				videoRenderer,
+				audioRenderer,
+				connectionListener);
+
+		{
+			std::lock_guard<std::mutex> lock(state->Lock);
+			state->Connecting = false;
+		}
+
+		if (cancellationToken.is_cancelable())
+		{
+			cancellationToken.deregister_callback(registration);
+		}
+
+		if (cancellationToken.is_canceled())
+		{
+			if (err == 0)
+			{
+				self->StopConnection();
+			}
+
+			concurrency::cancel_current_task();
+		}
+
+		return err;
+	});
 }
 
-void ArCleanup()
+void MoonlightCommonInterop::StopConnection()
 {
-	if (s_OpusDecoder != NULL)
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session == NULL || GetActiveStreamingSession() != session.get())
 	{
-		opus_multistream_decoder_destroy(s_OpusDecoder);
-		s_OpusDecoder = NULL;
+		return;
 	}
 
-	if (s_AudioFrameBuffer != NULL)
+	// Tears down the renderers through the callbacks above before returning
+	LiStopConnection();
+	SetActiveStreamingSession(NULL);
+}
+
+VideoStatistics^ MoonlightCommonInterop::GetVideoStatistics()
+{
+	std::shared_ptr<StreamingSession> session = GetSession();
+	VideoStatistics^ statistics = ref new VideoStatistics();
+	if (session == NULL)
 	{
-		free(s_AudioFrameBuffer);
-		s_AudioFrameBuffer = NULL;
-		s_AudioFrameBufferSize = 0;
+		return statistics;
 	}
 
-	s_AudioRenderer->Cleanup();
+	statistics->DecodeUnitsSubmitted = session->GetDecodeUnitsSubmitted();
+	statistics->BytesCopied = session->GetVideoBytesCopied();
+
+	const FrameBufferPool& frameBufferPool = session->GetFrameBufferPool();
+	statistics->FrameBufferSize = frameBufferPool.GetBufferSize();
+	statistics->FrameBufferPoolHits = frameBufferPool.GetHitCount();
+	statistics->FrameBufferPoolMisses = frameBufferPool.GetMissCount();
+
+	const VideoDecodeQueue& videoDecodeQueue = session->GetVideoDecodeQueue();
+	statistics->DecodeQueueDepth = videoDecodeQueue.GetDepth();
+	statistics->DecodeQueueOccupancy = videoDecodeQueue.GetOccupancy();
+	statistics->DecodeQueuePeakOccupancy = videoDecodeQueue.GetPeakOccupancy();
+	statistics->DecodeQueueFramesSubmitted = videoDecodeQueue.GetFramesSubmitted();
+	statistics->DecodeQueueFramesDropped = videoDecodeQueue.GetFramesDropped();
+	statistics->DecodeQueueOverflows = videoDecodeQueue.GetOverflowCount();
+	statistics->DecodeQueueNonReferenceFramesDropped = videoDecodeQueue.GetNonReferenceFramesDropped();
+	statistics->DecodeQueueSupersededFramesDropped = videoDecodeQueue.GetSupersededFramesDropped();
+	statistics->DecodeQueueAwaitingIdrFramesDropped = videoDecodeQueue.GetAwaitingIdrFramesDropped();
+	statistics->DecodeQueueIdrRequests = videoDecodeQueue.GetIdrRequests();
+	statistics->DecodeQueueAverageWaitTimeUs = videoDecodeQueue.GetAverageWaitTimeUs();
+	statistics->DecodeQueueMaxWaitTimeUs = videoDecodeQueue.GetMaxWaitTimeUs();
+
+	const ParameterSetCache& parameterSetCache = session->GetParameterSetCache();
+	statistics->ParameterSetsForwarded = parameterSetCache.GetForwardedCount();
+	statistics->ParameterSetsSuppressed = parameterSetCache.GetSuppressedCount();
+
+	const ReferenceFrameTracker& referenceFrameTracker = session->GetReferenceFrameTracker();
+	statistics->FramesLost = referenceFrameTracker.GetFramesLost();
+	statistics->ReferenceFrameInvalidations = referenceFrameTracker.GetInvalidationRequests();
+	statistics->FrameLossIdrRequests = referenceFrameTracker.GetIdrRequests();
+	statistics->InvalidatedFramesSkipped = referenceFrameTracker.GetFramesSkipped();
+
+	const BitrateController& bitrateController = session->GetBitrateController();
+	statistics->Bitrate = session->GetStreamConfiguration().bitrate;
+	statistics->TargetBitrate = bitrateController.GetTargetBitrate();
+	statistics->BitrateIncreases = bitrateController.GetIncreases();
+	statistics->BitrateDecreases = bitrateController.GetDecreases();
+
+	const FramePacer& framePacer = session->GetFramePacer();
+	statistics->FramePacing = (FramePacingPolicy)framePacer.GetMode();
+	statistics->PacedFramesDisplayed = framePacer.GetFramesDisplayed();
+	statistics->PacedFramesDropped = framePacer.GetFramesDropped();
+	statistics->PacedFramesLate = framePacer.GetFramesLate();
+	statistics->VsyncPeriodUs = framePacer.GetVsyncPeriodUs();
+	return statistics;
 }
 
-void ArDecodeAndPlaySample(char *sampleData, int sampleLength)
+AudioStatistics^ MoonlightCommonInterop::GetAudioStatistics()
 {
-	int decodeLen =
-		opus_multistream_decode(
-			s_OpusDecoder,
-			(const unsigned char*)sampleData,
-			sampleLength,
-			(opus_int16*)s_AudioFrameBuffer,
-			PCM_FRAME_SIZE,
-			0);
-	if (decodeLen > 0)
+	std::shared_ptr<StreamingSession> session = GetSession();
+	AudioStatistics^ statistics = ref new AudioStatistics();
+	if (session == NULL)
 	{
-		s_AudioRenderer->HandleFrame(ArrayReference<unsigned char>((unsigned char *)s_AudioFrameBuffer, s_AudioFrameBufferSize));
+		return statistics;
 	}
-}
 
-void ClStageStarting(int stage)
-{
-	String^ stageName = CStringToPlatformString(LiGetStageName(stage));
-	s_ConnectionListener->StageStarting(stageName);
+	const AudioPipeline& audioPipeline = session->GetAudioPipeline();
+	statistics->FramesDecoded = audioPipeline.GetFramesDecoded();
+	statistics->PacketsLost = audioPipeline.GetPacketsLost();
+	statistics->FramesConcealed = audioPipeline.GetFramesConcealed();
+	statistics->FramesRecovered = audioPipeline.GetFramesRecovered();
+	statistics->OutputSampleRate = audioPipeline.GetOutputSampleRate();
+	statistics->ResamplerLatencySamples = audioPipeline.GetResamplerLatencySamples();
+	statistics->FramesPerSubmission = audioPipeline.GetFramesPerSubmission();
+	statistics->RendererCalls = audioPipeline.GetRendererCalls();
+	statistics->AverageRendererCallUs = audioPipeline.GetAverageRendererCallUs();
+	statistics->MaxRendererCallUs = audioPipeline.GetMaxRendererCallUs();
+
+	const AudioJitterBuffer& jitterBuffer = audioPipeline.GetJitterBuffer();
+	statistics->JitterBufferDepthMs = jitterBuffer.GetDepthMs();
+	statistics->JitterBufferTargetDepthMs = jitterBuffer.GetTargetDepthMs();
+	statistics->JitterUs = jitterBuffer.GetJitterUs();
+	statistics->JitterBufferUnderruns = jitterBuffer.GetUnderruns();
+	statistics->JitterBufferOverruns = jitterBuffer.GetOverruns();
+	statistics->SamplesDropped = jitterBuffer.GetSamplesDropped();
+	statistics->SamplesInserted = jitterBuffer.GetSamplesInserted();
+	return statistics;
 }
 
-void ClStageComplete(int stage)
+static LatencyPercentiles^ ToLatencyPercentiles(const LatencyPercentileResult& result)
 {
-	String^ stageName = CStringToPlatformString(LiGetStageName(stage));
-	s_ConnectionListener->StageComplete(stageName);
+	LatencyPercentiles^ percentiles = ref new LatencyPercentiles();
+	percentiles->SampleCount = result.SampleCount;
+	percentiles->P50Us = result.P50Us;
+	percentiles->P95Us = result.P95Us;
+	percentiles->P99Us = result.P99Us;
+	return percentiles;
 }
 
-void ClStageFailed(int stage, long errorCode)
+LatencyPercentiles^ MoonlightCommonInterop::GetFrameLatency(FrameLatencyStage stage)
 {
-	String^ stageName = CStringToPlatformString(LiGetStageName(stage));
-	s_ConnectionListener->StageFailed(stageName, errorCode);
+	std::shared_ptr<StreamingSession> session = GetSession();
+	LatencyPercentiles^ percentiles = ref new LatencyPercentiles();
+	if (session == NULL)
+	{
+		return percentiles;
+	}
+
+	FrameTracePoint from;
+	FrameTracePoint to;
+	switch (stage)
+	{
+	case FrameLatencyStage::Reassembly:
+		from = FrameTraceFirstPacketReceived;
+		to = FrameTraceReassembled;
+		break;
+	case FrameLatencyStage::BufferCopy:
+		from = FrameTraceReassembled;
+		to = FrameTraceBufferCopied;
+		break;
+	case FrameLatencyStage::QueueWait:
+		from = FrameTraceBufferCopied;
+		to = FrameTraceRenderStart;
+		break;
+	case FrameLatencyStage::Render:
+		from = FrameTraceRenderStart;
+		to = FrameTraceRenderEnd;
+		break;
+	case FrameLatencyStage::Present:
+		from = FrameTraceRenderEnd;
+		to = FrameTracePresented;
+		break;
+	case FrameLatencyStage::ReceiveToRender:
+		from = FrameTraceFirstPacketReceived;
+		to = FrameTraceRenderEnd;
+		break;
+	case FrameLatencyStage::ReceiveToPresent:
+	default:
+		from = FrameTraceFirstPacketReceived;
+		to = FrameTracePresented;
+		break;
+	}
+
+	return ToLatencyPercentiles(session->GetFrameLatencyTracker().GetPercentiles(from, to));
 }
 
-void ClConnectionStarted()
+void MoonlightCommonInterop::ReportFramePresented(int frameNumber)
 {
-	s_ConnectionListener->ConnectionStarted();
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session != NULL)
+	{
+		session->FramePresented(frameNumber);
+	}
 }
 
-void ClConnectionTerminated(long errorCode)
+void MoonlightCommonInterop::NotifyVsync()
 {
-	s_ConnectionListener->ConnectionTerminated(errorCode);
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session != NULL)
+	{
+		session->NotifyVsync();
+	}
 }
 
-void ClDisplayMessage(const char* message)
+StartupTimeline^ MoonlightCommonInterop::GetStartupTimeline()
 {
-	s_ConnectionListener->DisplayMessage(CStringToPlatformString(message));
+	std::shared_ptr<StreamingSession> session = GetSession();
+	StartupTimeline^ timeline = ref new StartupTimeline();
+	if (session == NULL)
+	{
+		timeline->Stages = ref new Array<StartupStageTiming^>(0);
+		return timeline;
+	}
+
+	StartupTimelineData data = session->GetStartupProfiler().GetTimeline();
+	timeline->Stages = ref new Array<StartupStageTiming^>(data.StageCount);
+	for (int i = 0; i < data.StageCount; i++)
+	{
+		const StartupStageRecord& record = data.Stages[i];
+
+		StartupStageTiming^ stage = ref new StartupStageTiming();
+		stage->Name = Utf8ToPlatformString(LiGetStageName(record.Stage));
+		stage->StartUs = record.StartUs - data.OriginUs;
+		stage->DurationUs = record.EndUs != 0 ? record.EndUs - record.StartUs : 0;
+		stage->Complete = record.EndUs != 0;
+		stage->Failed = record.Failed;
+		stage->ErrorCode = (int)record.ErrorCode;
+		timeline->Stages[i] = stage;
+	}
+
+	timeline->Reconnect = data.Reconnect;
+	timeline->ConnectionStartedUs = data.ConnectionStartedUs != 0 ? data.ConnectionStartedUs - data.OriginUs : 0;
+	timeline->TimeToFirstFrameUs = data.FirstFrameUs != 0 ? data.FirstFrameUs - data.OriginUs : 0;
+	return timeline;
 }
 
-void ClDisplayTransientMessage(const char* message)
+String^ MoonlightCommonInterop::ExportStartupTrace()
 {
-	s_ConnectionListener->DisplayTransientMessage(CStringToPlatformString(message));
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session == NULL)
+	{
+		return Utf8ToPlatformString("{\"traceEvents\":[]}");
+	}
+
+	return Utf8ToPlatformString(session->GetStartupProfiler().ExportTrace().c_str());
 }
 
-void ClLogMessage(const char* format, ...)
+String^ MoonlightCommonInterop::ExportBitrateDecisions()
 {
-	char message[1024];
-	va_list va;
-	va_start(va, format);
-	vsnprintf(message, 1024, format, va);
-	va_end(va);
+	std::shared_ptr<StreamingSession> session = GetSession();
+	if (session == NULL)
+	{
+		return Utf8ToPlatformString("{\"decisions\":[]}");
+	}
 
-	s_ConnectionListener->LogMessage(CStringToPlatformString(message));
+	return Utf8ToPlatformString(session->GetBitrateController().ExportDecisions().c_str());
 }
 
-int MoonlightCommonInterop::StartConnection(
-	String^ address,
-	String^ appVersion,
-	String^ gfeVersion,
-	StreamConfiguration^ streamConfiguration,
-	IVideoRenderer^ videoRenderer,
-	IAudioRenderer^ audioRenderer,
-	IConnectionListener^ connectionListener)
+LatencyPercentiles^ MoonlightCommonInterop::GetStartupStagePercentiles(String^ stageName)
 {
-	s_VideoRenderer = videoRenderer;
-	s_AudioRenderer = audioRenderer;
-	s_ConnectionListener = connectionListener;
-
-	SERVER_INFORMATION interopServerInformation;
-	LiInitializeServerInformation(&interopServerInformation);
-	interopServerInformation.address = PlatformStringToCString(address);
-	interopServerInformation.serverInfoAppVersion = PlatformStringToCString(appVersion);
-	interopServerInformation.serverInfoGfeVersion = PlatformStringToCString(gfeVersion);
-	
-	STREAM_CONFIGURATION interopStreamConfiguration;
-	LiInitializeStreamConfiguration(&interopStreamConfiguration);
-	interopStreamConfiguration.width = streamConfiguration->Width;
-	interopStreamConfiguration.height = streamConfiguration->Height;
-	interopStreamConfiguration.fps = streamConfiguration->Fps;
-	interopStreamConfiguration.bitrate = streamConfiguration->Bitrate;
-	interopStreamConfiguration.packetSize = streamConfiguration->PacketSize;
-	interopStreamConfiguration.streamingRemotely = streamConfiguration->StreamingRemotely;
-	interopStreamConfiguration.audioConfiguration = streamConfiguration->AudioConfiguration;
-	interopStreamConfiguration.supportsHevc = streamConfiguration->SupportsHevc;
-	interopStreamConfiguration.enableHdr = streamConfiguration->EnableHdr;
-	interopStreamConfiguration.hevcBitratePercentageMultiplier = streamConfiguration->HevcBitratePercentageMultiplier;
-	interopStreamConfiguration.clientRefreshRateX100 = streamConfiguration->ClientRefreshRateX100;
-	memcpy_s(
-		interopStreamConfiguration.remoteInputAesKey,
-		sizeof(interopStreamConfiguration.remoteInputAesKey),
-		streamConfiguration->RemoteInputAesKey->Data,
-		streamConfiguration->RemoteInputAesKey->Length);
-	memcpy_s(
-		interopStreamConfiguration.remoteInputAesKey,
-		sizeof(interopStreamConfiguration.remoteInputAesKey),
-		streamConfiguration->RemoteInputAesKey->Data,
-		streamConfiguration->RemoteInputAesKey->Length);
+	std::string name = PlatformStringToUtf8(stageName);
+	for (int stage = 0; stage < STAGE_MAX; stage++)
+	{
+		if (name == LiGetStageName(stage))
+		{
+			return ToLatencyPercentiles(StartupProfiler::GetStagePercentiles(stage));
+		}
+	}
 
-	DECODER_RENDERER_CALLBACKS interopVideoRendererCallbacks;
-	LiInitializeVideoCallbacks(&interopVideoRendererCallbacks);
-	interopVideoRendererCallbacks.setup = DrSetup;
-	interopVideoRendererCallbacks.start = DrStart;
-	interopVideoRendererCallbacks.stop = DrStop;
-	interopVideoRendererCallbacks.cleanup = DrCleanup;
-	interopVideoRendererCallbacks.submitDecodeUnit = DrSubmitDecodeUnit;
-	interopVideoRendererCallbacks.capabilities = s_VideoRenderer->Capabilities;
+	return ref new LatencyPercentiles();
+}
 
-	AUDIO_RENDERER_CALLBACKS interopAudioRendererCallbacks;
-	LiInitializeAudioCallbacks(&interopAudioRendererCallbacks);
-	interopAudioRendererCallbacks.init = ArInit;
-	interopAudioRendererCallbacks.start = ArStart;
-	interopAudioRendererCallbacks.stop = ArStop;
-	interopAudioRendererCallbacks.cleanup = ArCleanup;
-	interopAudioRendererCallbacks.decodeAndPlaySample = ArDecodeAndPlaySample;
-	interopAudioRendererCallbacks.capabilities = s_AudioRenderer->Capabilities;
+LatencyPercentiles^ MoonlightCommonInterop::GetTimeToFirstFramePercentiles()
+{
+	return ToLatencyPercentiles(StartupProfiler::GetTimeToFirstFramePercentiles());
+}
 
-	CONNECTION_LISTENER_CALLBACKS interopConnectionListenerCallbacks;
-	LiInitializeConnectionCallbacks(&interopConnectionListenerCallbacks);
-	interopConnectionListenerCallbacks.stageStarting = ClStageStarting;
-	interopConnectionListenerCallbacks.stageComplete = ClStageComplete;
-	interopConnectionListenerCallbacks.stageFailed = ClStageFailed;
-	interopConnectionListenerCallbacks.connectionStarted = ClConnectionStarted;
-	interopConnectionListenerCallbacks.connectionTerminated = ClConnectionTerminated;
-	interopConnectionListenerCallbacks.displayMessage = ClDisplayMessage;
-	interopConnectionListenerCallbacks.displayTransientMessage = ClDisplayTransientMessage;
-	interopConnectionListenerCallbacks.logMessage = ClLogMessage;
-
-	return LiStartConnection(
-		&interopServerInformation,
-		&interopStreamConfiguration,
-		&interopConnectionListenerCallbacks,
-		&interopVideoRendererCallbacks,
-		&interopAudioRendererCallbacks,
-		NULL,
-		0,
-		NULL,
-		0);
-}
\ No newline at end of file
+LatencyPercentiles^ MoonlightCommonInterop::GetReconnectTimePercentiles()
+{
+	return ToLatencyPercentiles(StartupProfiler::GetReconnectTimePercentiles());
+}
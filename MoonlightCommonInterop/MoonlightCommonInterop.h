@@ -1,9 +1,16 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include "IVideoRenderer.h"
 #include "IAudioRenderer.h"
 #include "IConnectionListener.h"
+#include "AudioStatistics.h"
+#include "FrameLatencyStage.h"
+#include "LatencyPercentiles.h"
+#include "StartupTimeline.h"
 #include "StreamConfiguration.h"
+#include "VideoStatistics.h"
 
 namespace Moonlight
 {
@@ -11,9 +18,19 @@ namespace Moonlight
 	{
 		namespace Interop
 		{
+			using namespace Windows::Foundation;
+
+			class StreamingSession;
+
 			public ref class MoonlightCommonInterop sealed
 			{
 			public:
+				MoonlightCommonInterop();
+
+				virtual ~MoonlightCommonInterop();
+
+				// Returns -1 without connecting while another instance is connected, since
+				// moonlight-common-c supports a single connection per process
 				int StartConnection(
 					String^ address,
 					String^ appVersion,
@@ -22,6 +39,73 @@ namespace Moonlight
 					IVideoRenderer^ videoRenderer,
 					IAudioRenderer^ audioRenderer,
 					IConnectionListener^ connectionListener);
+
+				// Runs StartConnection on a worker thread. Stage callbacks are delivered as
+				// usual while it runs. Cancelling the operation interrupts the handshake
+				// with LiInterruptConnection and tears down the connection if it managed
+				// to start anyway. A cancel that lands before LiStartConnection has reset
+				// its interrupt flag is lost to the handshake, so only that teardown
+				// after it returns catches it.
+				IAsyncOperation<int>^ StartConnectionAsync(
+					String^ address,
+					String^ appVersion,
+					String^ gfeVersion,
+					StreamConfiguration^ streamConfiguration,
+					IVideoRenderer^ videoRenderer,
+					IAudioRenderer^ audioRenderer,
+					IConnectionListener^ connectionListener);
+
+				// Re-establishes the transport of the last connection with the same
+				// parameters. The renderers, frame pool and Opus decoder are kept alive
+				// and reused if the host negotiates the same stream, so only the network
+				// handshake is repeated. The time to the first frame is recorded in the
+				// startup timeline and GetReconnectTimePercentiles.
+				int Reconnect();
+
+				// Applies the adaptive bitrate controller's target by reconnecting at it,
+				// since the host only takes a bitrate during the handshake. Returns 0
+				// without reconnecting if the target matches the current bitrate, and
+				// keeps the current bitrate if the reconnect fails. Meant to be polled
+				// from the app, not called from a renderer callback.
+				int AdjustBitrate();
+
+				void StopConnection();
+
+				VideoStatistics^ GetVideoStatistics();
+
+				AudioStatistics^ GetAudioStatistics();
+
+				LatencyPercentiles^ GetFrameLatency(FrameLatencyStage stage);
+
+				void ReportFramePresented(int frameNumber);
+
+				// Called by the renderer on each vsync, as close to it as possible, when
+				// StreamConfiguration::FramePacing is set
+				void NotifyVsync();
+
+				StartupTimeline^ GetStartupTimeline();
+
+				// The startup timeline in Chrome trace event JSON, for chrome://tracing or Perfetto
+				String^ ExportStartupTrace();
+
+				// Every adaptive bitrate window with its inputs, and the policy that judged
+				// them, as JSON for replaying policies offline
+				String^ ExportBitrateDecisions();
+
+				// Across every connection made by this process
+				LatencyPercentiles^ GetStartupStagePercentiles(String^ stageName);
+
+				LatencyPercentiles^ GetTimeToFirstFramePercentiles();
+
+				LatencyPercentiles^ GetReconnectTimePercentiles();
+
+			private:
+				// Callers on other threads work on a snapshot, so StartConnection can
+				// replace the session without freeing it from under them
+				std::shared_ptr<StreamingSession> GetSession();
+
+				std::mutex m_SessionLock;
+				std::shared_ptr<StreamingSession> m_Session;
 			};
 		}
 	}
@@ -0,0 +1,526 @@
+#include <string.h>
+#include "Limelight.h"
+#include "NalIndexer.h"
+#include "StartCodeScanner.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define NAL_FLAG_SLICE 0x1
+#define NAL_FLAG_IDR 0x2
+#define NAL_FLAG_SEI 0x4
+
+// HEVC sub-layer non-reference pictures, which nothing else predicts from
+#define NAL_FLAG_NON_REFERENCE 0x8
+
+#define HEVC_NAL_BLA_W_LP 16
+#define HEVC_NAL_RSV_IRAP_VCL23 23
+#define HEVC_NAL_PPS 34
+
+#define SEI_MASTERING_DISPLAY_COLOUR_VOLUME 137
+#define SEI_CONTENT_LIGHT_LEVEL_INFO 144
+
+// Bounds the work spent on a malformed SEI NAL unit
+#define MAX_SEI_MESSAGES 16
+
+static constexpr unsigned char s_H264NalFlags[32] =
+{
+	0, NAL_FLAG_SLICE, NAL_FLAG_SLICE, 0, 0, NAL_FLAG_SLICE | NAL_FLAG_IDR, NAL_FLAG_SEI, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static constexpr unsigned char s_HevcNalFlags[64] =
+{
+	// TRAIL, TSA, STSA, RADL and RASL pictures. The even types are sub-layer non-reference.
+	NAL_FLAG_SLICE | NAL_FLAG_NON_REFERENCE, NAL_FLAG_SLICE,
+	NAL_FLAG_SLICE | NAL_FLAG_NON_REFERENCE, NAL_FLAG_SLICE,
+	NAL_FLAG_SLICE | NAL_FLAG_NON_REFERENCE, NAL_FLAG_SLICE,
+	NAL_FLAG_SLICE | NAL_FLAG_NON_REFERENCE, NAL_FLAG_SLICE,
+	NAL_FLAG_SLICE | NAL_FLAG_NON_REFERENCE, NAL_FLAG_SLICE,
+	0, 0, 0, 0, 0, 0,
+
+	// BLA, IDR and CRA pictures
+	NAL_FLAG_SLICE, NAL_FLAG_SLICE, NAL_FLAG_SLICE,
+	NAL_FLAG_SLICE | NAL_FLAG_IDR, NAL_FLAG_SLICE | NAL_FLAG_IDR,
+	NAL_FLAG_SLICE,
+	0, 0,
+
+	0, 0, 0, 0, 0, 0, 0, 0,
+
+	// Parameter sets, access unit delimiter, end of sequence and bitstream, filler,
+	// then prefix and suffix SEI
+	0, 0, 0, 0, 0, 0, 0, NAL_FLAG_SEI,
+	NAL_FLAG_SEI, 0, 0, 0, 0, 0, 0, 0,
+
+	0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+namespace
+{
+	// Reads the RBSP of a NAL unit bit by bit, stepping over emulation prevention bytes.
+	// Reads past the end return zeros and set the overrun flag.
+	class RbspReader
+	{
+	public:
+		RbspReader(const unsigned char* data, int length)
+			: m_Data(data),
+			m_Length(length),
+			m_Position(0),
+			m_Bit(0),
+			m_Zeros(0),
+			m_Overrun(false)
+		{
+		}
+
+		unsigned int ReadBit()
+		{
+			if (m_Bit == 0)
+			{
+				if (m_Zeros >= 2 && m_Position < m_Length && m_Data[m_Position] == 3)
+				{
+					m_Position++;
+					m_Zeros = 0;
+				}
+
+				if (m_Position >= m_Length)
+				{
+					m_Overrun = true;
+					return 0;
+				}
+			}
+
+			unsigned int bit = (m_Data[m_Position] >> (7 - m_Bit)) & 1;
+			if (++m_Bit == 8)
+			{
+				m_Zeros = m_Data[m_Position] == 0 ? m_Zeros + 1 : 0;
+				m_Bit = 0;
+				m_Position++;
+			}
+
+			return bit;
+		}
+
+		unsigned int ReadBits(int count)
+		{
+			unsigned int value = 0;
+			for (int i = 0; i < count; i++)
+			{
+				value = (value << 1) | ReadBit();
+			}
+
+			return value;
+		}
+
+		unsigned int ReadExpGolomb()
+		{
+			int leadingZeros = 0;
+			while (ReadBit() == 0)
+			{
+				if (m_Overrun || ++leadingZeros > 31)
+				{
+					m_Overrun = true;
+					return 0;
+				}
+			}
+
+			return (1u << leadingZeros) - 1 + ReadBits(leadingZeros);
+		}
+
+		// False once only the RBSP stop bit and any padding are left
+		bool HasMoreData() const
+		{
+			return m_Position + 1 < m_Length || (m_Position < m_Length && m_Data[m_Position] != 0x80);
+		}
+
+		bool IsOverrun() const
+		{
+			return m_Overrun;
+		}
+
+	private:
+		const unsigned char* m_Data;
+		int m_Length;
+		int m_Position;
+		int m_Bit;
+		int m_Zeros;
+		bool m_Overrun;
+	};
+}
+
+NalIndexer::NalIndexer()
+	: m_Hevc(false)
+{
+	memset(m_HevcExtraSliceHeaderBits, 0, sizeof(m_HevcExtraSliceHeaderBits));
+	Begin(0, 0);
+}
+
+void NalIndexer::Initialize(int videoFormat)
+{
+	m_Hevc = (videoFormat & VIDEO_FORMAT_MASK_H265) != 0;
+	memset(m_HevcExtraSliceHeaderBits, 0, sizeof(m_HevcExtraSliceHeaderBits));
+	Begin(0, 0);
+}
+
+void NalIndexer::Begin(int frameNumber, int frameType)
+{
+	m_Descriptor.FrameNumber = frameNumber;
+	m_Descriptor.FrameType = frameType;
+	m_Descriptor.Idr = false;
+	m_Descriptor.Reference = false;
+	m_Descriptor.HdrMetadata = false;
+	m_Descriptor.SliceTypes = 0;
+	m_Descriptor.NalUnitCount = 0;
+
+	m_BufferIndex = 0;
+	m_StreamOffset = 0;
+
+	m_NalOpen = false;
+	m_NalOffset = 0;
+	m_NalEnd = 0;
+	m_NalBuffer = 0;
+	m_NalBufferOffset = 0;
+	m_NalHeadLength = 0;
+	m_TrailingZeros = 0;
+}
+
+void NalIndexer::OpenNalUnit(int offset)
+{
+	m_NalOpen = true;
+	m_NalOffset = offset;
+	m_NalEnd = offset;
+	m_NalHeadLength = 0;
+}
+
+void NalIndexer::AppendToNalUnit(const unsigned char* data, int length, int offset)
+{
+	// Data before the first start code isn't part of any NAL unit
+	if (!m_NalOpen || length == 0)
+	{
+		return;
+	}
+
+	// A start code that ends its buffer opens a NAL unit that starts in the next
+	if (m_NalHeadLength == 0)
+	{
+		m_NalBuffer = m_BufferIndex;
+		m_NalBufferOffset = offset - m_StreamOffset;
+	}
+
+	if (m_NalHeadLength < NAL_HEAD_SIZE)
+	{
+		int headBytes = length < NAL_HEAD_SIZE - m_NalHeadLength ? length : NAL_HEAD_SIZE - m_NalHeadLength;
+		memcpy(&m_NalHead[m_NalHeadLength], data, headBytes);
+		m_NalHeadLength += headBytes;
+	}
+
+	int end = length;
+	while (end > 0 && data[end - 1] == 0)
+	{
+		end--;
+	}
+	if (end > 0)
+	{
+		m_NalEnd = offset + end;
+	}
+}
+
+void NalIndexer::CloseNalUnit()
+{
+	if (!m_NalOpen)
+	{
+		return;
+	}
+
+	m_NalOpen = false;
+
+	int nalLength = m_NalEnd - m_NalOffset;
+	if (nalLength > 0)
+	{
+		IndexNalUnit(
+			m_NalHead,
+			m_NalHeadLength < nalLength ? m_NalHeadLength : nalLength,
+			nalLength,
+			m_NalBuffer,
+			m_NalBufferOffset);
+	}
+}
+
+void NalIndexer::IndexBuffer(const char* data, int length)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	int baseOffset = m_StreamOffset;
+
+	int position = 0;
+	if (m_TrailingZeros > 0)
+	{
+		// A start code may straddle the previous buffer and this one
+		int leadingZeros = 0;
+		while (leadingZeros < length && leadingZeros < 2 && bytes[leadingZeros] == 0)
+		{
+			leadingZeros++;
+		}
+
+		if (leadingZeros < length && bytes[leadingZeros] == 1 && m_TrailingZeros + leadingZeros >= 2)
+		{
+			CloseNalUnit();
+			position = leadingZeros + 1;
+			OpenNalUnit(baseOffset + position);
+		}
+	}
+
+	while (position < length)
+	{
+		int startCode = FindStartCode(&bytes[position], length - position);
+		int end = startCode >= 0 ? position + startCode : length;
+		AppendToNalUnit(&bytes[position], end - position, baseOffset + position);
+		if (startCode < 0)
+		{
+			break;
+		}
+
+		CloseNalUnit();
+		position = end + 3;
+		OpenNalUnit(baseOffset + position);
+	}
+
+	int trailingZeros = 0;
+	while (trailingZeros < length && trailingZeros < 2 && bytes[length - 1 - trailingZeros] == 0)
+	{
+		trailingZeros++;
+	}
+	if (trailingZeros == length)
+	{
+		trailingZeros += m_TrailingZeros;
+	}
+	m_TrailingZeros = trailingZeros < 2 ? trailingZeros : 2;
+
+	m_BufferIndex++;
+	m_StreamOffset += length;
+}
+
+void NalIndexer::End()
+{
+	CloseNalUnit();
+	m_TrailingZeros = 0;
+}
+
+void NalIndexer::IndexLengthPrefixedBuffer(const char* data, int length, int lengthSize)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+
+	int position = 0;
+	while (position + lengthSize <= length)
+	{
+		int nalLength = 0;
+		for (int i = 0; i < lengthSize; i++)
+		{
+			nalLength = (nalLength << 8) | bytes[position + i];
+		}
+
+		int nalStart = position + lengthSize;
+		if (nalLength <= 0 || nalLength > length - nalStart)
+		{
+			break;
+		}
+
+		IndexNalUnit(&bytes[nalStart], nalLength, nalLength, m_BufferIndex, nalStart);
+		position = nalStart + nalLength;
+	}
+
+	m_BufferIndex++;
+	m_StreamOffset += length;
+}
+
+void NalIndexer::IndexNalUnit(const unsigned char* data, int length, int nalLength, int buffer, int offset)
+{
+	int type;
+	int flags;
+	int headerLength;
+	if (m_Hevc)
+	{
+		if (length < 2)
+		{
+			return;
+		}
+
+		type = (data[0] >> 1) & 0x3F;
+		flags = s_HevcNalFlags[type];
+		headerLength = 2;
+	}
+	else
+	{
+		type = data[0] & 0x1F;
+		flags = s_H264NalFlags[type];
+		headerLength = 1;
+	}
+
+	int sliceType = 0;
+	if (flags & NAL_FLAG_SLICE)
+	{
+		sliceType = m_Hevc ? ParseHevcSlice(data, length, type) : ParseH264Slice(data, length);
+		m_Descriptor.SliceTypes |= sliceType;
+
+		if (flags & NAL_FLAG_IDR)
+		{
+			m_Descriptor.Idr = true;
+		}
+
+		// nal_ref_idc for H.264
+		if (m_Hevc ? (flags & NAL_FLAG_NON_REFERENCE) == 0 : (data[0] & 0x60) != 0)
+		{
+			m_Descriptor.Reference = true;
+		}
+	}
+	else if (flags & NAL_FLAG_SEI)
+	{
+		if (!m_Descriptor.HdrMetadata && HasHdrMetadata(data, length, headerLength))
+		{
+			m_Descriptor.HdrMetadata = true;
+		}
+	}
+	else if (m_Hevc && type == HEVC_NAL_PPS)
+	{
+		ParseHevcPictureParameterSet(&data[headerLength], length - headerLength);
+	}
+
+	if (m_Descriptor.NalUnitCount < MAX_FRAME_DESCRIPTOR_NAL_UNITS)
+	{
+		NativeNalUnit& nalUnit = m_Descriptor.NalUnits[m_Descriptor.NalUnitCount++];
+		nalUnit.Buffer = buffer;
+		nalUnit.Offset = offset;
+		nalUnit.Length = nalLength;
+		nalUnit.Type = type;
+		nalUnit.SliceType = sliceType;
+	}
+}
+
+int NalIndexer::ParseH264Slice(const unsigned char* data, int length)
+{
+	RbspReader reader(&data[1], length - 1);
+
+	// first_mb_in_slice, then slice_type
+	reader.ReadExpGolomb();
+	unsigned int sliceType = reader.ReadExpGolomb();
+	if (reader.IsOverrun())
+	{
+		return 0;
+	}
+
+	switch (sliceType % 5)
+	{
+	case 0:
+	case 3:
+		return NAL_SLICE_TYPE_P;
+	case 1:
+		return NAL_SLICE_TYPE_B;
+	default:
+		return NAL_SLICE_TYPE_I;
+	}
+}
+
+int NalIndexer::ParseHevcSlice(const unsigned char* data, int length, int nalType)
+{
+	RbspReader reader(&data[2], length - 2);
+
+	// Later slice segments need the SPS to skip slice_segment_address, but the first
+	// segment of each picture is enough to classify it.
+	if (reader.ReadBit() == 0)
+	{
+		return 0;
+	}
+
+	if (nalType >= HEVC_NAL_BLA_W_LP && nalType <= HEVC_NAL_RSV_IRAP_VCL23)
+	{
+		// no_output_of_prior_pics_flag
+		reader.ReadBit();
+	}
+
+	unsigned int ppsId = reader.ReadExpGolomb();
+	if (ppsId >= NAL_MAX_HEVC_PPS_COUNT)
+	{
+		return 0;
+	}
+
+	reader.ReadBits(m_HevcExtraSliceHeaderBits[ppsId]);
+	unsigned int sliceType = reader.ReadExpGolomb();
+	if (reader.IsOverrun())
+	{
+		return 0;
+	}
+
+	switch (sliceType)
+	{
+	case 0:
+		return NAL_SLICE_TYPE_B;
+	case 1:
+		return NAL_SLICE_TYPE_P;
+	case 2:
+		return NAL_SLICE_TYPE_I;
+	default:
+		return 0;
+	}
+}
+
+void NalIndexer::ParseHevcPictureParameterSet(const unsigned char* data, int length)
+{
+	RbspReader reader(data, length);
+
+	unsigned int ppsId = reader.ReadExpGolomb();
+
+	// pps_seq_parameter_set_id, dependent_slice_segments_enabled_flag and
+	// output_flag_present_flag come before num_extra_slice_header_bits
+	reader.ReadExpGolomb();
+	reader.ReadBits(2);
+	int extraSliceHeaderBits = (int)reader.ReadBits(3);
+	if (!reader.IsOverrun() && ppsId < NAL_MAX_HEVC_PPS_COUNT)
+	{
+		m_HevcExtraSliceHeaderBits[ppsId] = extraSliceHeaderBits;
+	}
+}
+
+bool NalIndexer::HasHdrMetadata(const unsigned char* data, int length, int headerLength)
+{
+	RbspReader reader(&data[headerLength], length - headerLength);
+
+	for (int message = 0; message < MAX_SEI_MESSAGES && reader.HasMoreData(); message++)
+	{
+		unsigned int payloadType = 0;
+		unsigned int value;
+		do
+		{
+			value = reader.ReadBits(8);
+			payloadType += value;
+		} while (value == 0xFF && !reader.IsOverrun());
+
+		unsigned int payloadSize = 0;
+		do
+		{
+			value = reader.ReadBits(8);
+			payloadSize += value;
+		} while (value == 0xFF && !reader.IsOverrun());
+
+		if (reader.IsOverrun())
+		{
+			return false;
+		}
+
+		if (payloadType == SEI_MASTERING_DISPLAY_COLOUR_VOLUME || payloadType == SEI_CONTENT_LIGHT_LEVEL_INFO)
+		{
+			return true;
+		}
+
+		for (unsigned int i = 0; i < payloadSize && !reader.IsOverrun(); i++)
+		{
+			reader.ReadBits(8);
+		}
+	}
+
+	return false;
+}
+
+const NativeFrameDescriptor& NalIndexer::GetDescriptor() const
+{
+	return m_Descriptor;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "SessionInterfaces.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Values of NativeNalUnit::SliceType and bits of NativeFrameDescriptor::SliceTypes,
+			// shared by H.264 and HEVC. SP and SI slices count as P and I.
+			#define NAL_SLICE_TYPE_I 0x1
+			#define NAL_SLICE_TYPE_P 0x2
+			#define NAL_SLICE_TYPE_B 0x4
+
+			// HEVC picture parameter set ids range from 0 to 63
+			#define NAL_MAX_HEVC_PPS_COUNT 64
+
+			// Bytes kept from the start of each NAL unit split across buffers, enough for
+			// slice headers and HDR metadata SEI
+			#define NAL_HEAD_SIZE 256
+
+			// Splits Annex B or length-prefixed video into NAL units in a single pass and summarises the frame
+			// for the renderer: where each NAL unit is, the slice types it carries, whether
+			// it's an IDR or reference picture, and whether HDR metadata SEI is present.
+			// Only the first few bytes after each start code are parsed.
+			class NalIndexer
+			{
+			public:
+				NalIndexer();
+
+				void Initialize(int videoFormat);
+
+				void Begin(int frameNumber, int frameType);
+
+				// Indexes the next buffer of Annex B data, in the order the renderer
+				// receives them. Each NAL unit records the buffer it starts in and its
+				// offset within it. The buffers of a frame form one stream, so a NAL unit
+				// runs on into later buffers until the next start code, even one split
+				// between two.
+				void IndexBuffer(const char* data, int length);
+
+				// Closes the NAL unit still open after the last IndexBuffer call
+				void End();
+
+				// Same as IndexBuffer for data already converted to big-endian length
+				// prefixes of lengthSize bytes. These NAL units never span buffers.
+				void IndexLengthPrefixedBuffer(const char* data, int length, int lengthSize);
+
+				const NativeFrameDescriptor& GetDescriptor() const;
+
+			private:
+				// data holds the first length bytes of a NAL unit of nalLength bytes
+				void IndexNalUnit(const unsigned char* data, int length, int nalLength, int buffer, int offset);
+
+				void OpenNalUnit(int offset);
+
+				void AppendToNalUnit(const unsigned char* data, int length, int offset);
+
+				void CloseNalUnit();
+
+				int ParseH264Slice(const unsigned char* data, int length);
+
+				int ParseHevcSlice(const unsigned char* data, int length, int nalType);
+
+				void ParseHevcPictureParameterSet(const unsigned char* data, int length);
+
+				bool HasHdrMetadata(const unsigned char* data, int length, int headerLength);
+
+				bool m_Hevc;
+				NativeFrameDescriptor m_Descriptor;
+
+				// Index of the next buffer and where it starts in the frame's stream
+				int m_BufferIndex;
+				int m_StreamOffset;
+
+				// The Annex B NAL unit IndexBuffer is in the middle of. Offsets are in the
+				// frame's stream. It ends at the last non-zero byte, leaving out trailing
+				// zeros and 4 byte start codes.
+				bool m_NalOpen;
+				int m_NalOffset;
+				int m_NalEnd;
+
+				// Where the NAL unit's first byte is, as reported to the renderer
+				int m_NalBuffer;
+				int m_NalBufferOffset;
+				int m_NalHeadLength;
+				unsigned char m_NalHead[NAL_HEAD_SIZE];
+
+				// Zeros at the end of the last buffer, up to the two a start code begins with
+				int m_TrailingZeros;
+
+				// num_extra_slice_header_bits of each HEVC PPS, needed to reach slice_type
+				int m_HevcExtraSliceHeaderBits[NAL_MAX_HEVC_PPS_COUNT];
+			};
+		}
+	}
+}
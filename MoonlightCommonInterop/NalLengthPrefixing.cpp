@@ -0,0 +1,200 @@
+#include <string.h>
+#include "StartCodeScanner.h"
+#include "NalLengthPrefixing.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define ANNEX_B_START_CODE_LENGTH 3
+
+int Moonlight::Xbox::Interop::GetMaxLengthPrefixedSize(int annexBLength, int lengthSize)
+{
+	if (lengthSize <= ANNEX_B_START_CODE_LENGTH)
+	{
+		// Leading data without a start code still gains a length field
+		return annexBLength + lengthSize;
+	}
+
+	return annexBLength + annexBLength / 4 + lengthSize;
+}
+
+LengthPrefixedNalWriter::LengthPrefixedNalWriter()
+	: m_LengthSize(0),
+	m_Output(NULL),
+	m_Capacity(0),
+	m_Written(0),
+	m_Failed(false),
+	m_LengthOffset(-1),
+	m_PendingZeros(0)
+{
+}
+
+void LengthPrefixedNalWriter::Begin(int lengthSize, char* output, int capacity)
+{
+	m_LengthSize = lengthSize;
+	m_Output = output;
+	m_Capacity = capacity;
+	m_Written = 0;
+	m_Failed = false;
+	m_LengthOffset = -1;
+	m_PendingZeros = 0;
+}
+
+bool LengthPrefixedNalWriter::Write(const unsigned char* data, int length)
+{
+	if (length == 0)
+	{
+		return true;
+	}
+
+	if (m_LengthOffset < 0)
+	{
+		// The length field is filled in when the NAL unit is closed
+		if (m_LengthSize > m_Capacity - m_Written)
+		{
+			m_Failed = true;
+			return false;
+		}
+
+		m_LengthOffset = m_Written;
+		m_Written += m_LengthSize;
+	}
+
+	if (length > m_Capacity - m_Written)
+	{
+		m_Failed = true;
+		return false;
+	}
+
+	memcpy(&m_Output[m_Written], data, length);
+	m_Written += length;
+	return true;
+}
+
+bool LengthPrefixedNalWriter::WriteZeros(int count)
+{
+	static const unsigned char zeros[16] = { 0 };
+	while (count > 0)
+	{
+		int chunk = count < (int)sizeof(zeros) ? count : (int)sizeof(zeros);
+		if (!Write(zeros, chunk))
+		{
+			return false;
+		}
+		count -= chunk;
+	}
+
+	return true;
+}
+
+bool LengthPrefixedNalWriter::CloseNalUnit()
+{
+	if (m_LengthOffset < 0)
+	{
+		return true;
+	}
+
+	int nalLength = m_Written - m_LengthOffset - m_LengthSize;
+	if (m_LengthSize == 2 && nalLength > 0xFFFF)
+	{
+		m_Failed = true;
+		return false;
+	}
+
+	for (int i = 0; i < m_LengthSize; i++)
+	{
+		m_Output[m_LengthOffset + i] = (char)(nalLength >> (8 * (m_LengthSize - 1 - i)));
+	}
+
+	m_LengthOffset = -1;
+	return true;
+}
+
+bool LengthPrefixedNalWriter::Append(const char* input, int length)
+{
+	const unsigned char* bytes = (const unsigned char*)input;
+	if (m_Failed)
+	{
+		return false;
+	}
+
+	int position = 0;
+	if (m_PendingZeros > 0)
+	{
+		// A start code may straddle the previous piece and this one
+		int leadingZeros = 0;
+		while (leadingZeros < length && bytes[leadingZeros] == 0)
+		{
+			leadingZeros++;
+		}
+
+		if (leadingZeros == length)
+		{
+			m_PendingZeros += length;
+			return true;
+		}
+
+		if (bytes[leadingZeros] == 1 && m_PendingZeros + leadingZeros >= 2)
+		{
+			m_PendingZeros = 0;
+			if (!CloseNalUnit())
+			{
+				return false;
+			}
+			position = leadingZeros + 1;
+		}
+		else
+		{
+			// Just zeros inside the NAL unit after all
+			if (!WriteZeros(m_PendingZeros))
+			{
+				return false;
+			}
+			m_PendingZeros = 0;
+		}
+	}
+
+	while (position < length)
+	{
+		int startCode = FindStartCode(&bytes[position], length - position);
+		if (startCode < 0)
+		{
+			// Hold back trailing zeros, which may begin a start code in the next piece
+			int end = length;
+			while (end > position && bytes[end - 1] == 0)
+			{
+				end--;
+			}
+
+			m_PendingZeros = length - end;
+			return Write(&bytes[position], end - position);
+		}
+
+		// The leading zero of a 4 byte start code belongs to neither NAL unit
+		int nalEnd = position + startCode;
+		while (nalEnd > position && bytes[nalEnd - 1] == 0)
+		{
+			nalEnd--;
+		}
+
+		if (!Write(&bytes[position], nalEnd - position) || !CloseNalUnit())
+		{
+			return false;
+		}
+
+		position += startCode + ANNEX_B_START_CODE_LENGTH;
+	}
+
+	return true;
+}
+
+int LengthPrefixedNalWriter::Finish()
+{
+	// Zeros at the very end are trailing padding rather than NAL unit data
+	m_PendingZeros = 0;
+	if (m_Failed || !CloseNalUnit())
+	{
+		return -1;
+	}
+
+	return m_Written;
+}
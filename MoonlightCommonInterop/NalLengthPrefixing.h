@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Largest output LengthPrefixedNalWriter can produce from annexBLength bytes
+			// of input. Every NAL unit takes at least 4 bytes with its start code, so
+			// 4 byte lengths can grow the data by at most a quarter.
+			int GetMaxLengthPrefixedSize(int annexBLength, int lengthSize);
+
+			// Copies Annex B data to an output buffer with each start code replaced by the
+			// big-endian length of the NAL unit that follows, as AVCC and HVCC decoders
+			// expect. The input may arrive in any number of pieces, such as one RTP payload
+			// at a time: a NAL unit runs on across pieces until the next start code, even
+			// one split between two pieces, and its length is only written once its end is
+			// known. Bytes before the first start code are treated as a NAL unit of their own.
+			class LengthPrefixedNalWriter
+			{
+			public:
+				LengthPrefixedNalWriter();
+
+				// lengthSize is 2 or 4
+				void Begin(int lengthSize, char* output, int capacity);
+
+				// Returns false if the output is too small
+				bool Append(const char* input, int length);
+
+				// Returns the number of bytes written, or -1 if the output was too small
+				// or a NAL unit doesn't fit in a 2 byte length
+				int Finish();
+
+			private:
+				bool Write(const unsigned char* data, int length);
+
+				bool WriteZeros(int count);
+
+				bool CloseNalUnit();
+
+				int m_LengthSize;
+				char* m_Output;
+				int m_Capacity;
+				int m_Written;
+				bool m_Failed;
+
+				// Where the open NAL unit's length field is, or -1 if none is open
+				int m_LengthOffset;
+
+				// Zero bytes at the end of the input so far. They're held back until it's
+				// clear whether they begin a start code or belong to the NAL unit.
+				int m_PendingZeros;
+			};
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// One NAL unit of a frame. Buffer is the one it starts in: the frame's nth
+			// HandleFrame call, or the nth entry passed to HandleFrameBufferList. Offset
+			// is from the start of that buffer, and Offset and Length exclude the start
+			// code or length prefix. Annex B NAL units in a buffer list can run on into
+			// the following entries. SliceType is a single FrameSliceTypes value for the
+			// first slice segment of a picture, else 0.
+			public value struct NalUnitDescriptor
+			{
+				int Buffer;
+				int Offset;
+				int Length;
+				int Type;
+				int SliceType;
+			};
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#include <string.h>
+#include "ParameterSetCache.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// 64-bit FNV-1a
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static unsigned long long HashBytes(const char* data, int length)
+{
+	unsigned long long hash = FNV_OFFSET_BASIS;
+	for (int i = 0; i < length; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+ParameterSetCache::ParameterSetCache()
+	: m_InvalidatePending(false),
+	m_Forwarded(0),
+	m_Suppressed(0)
+{
+	memset(m_Entries, 0, sizeof(m_Entries));
+}
+
+bool ParameterSetCache::IsUnchanged(int bufferType, const char* data, int length)
+{
+	if (m_InvalidatePending.exchange(false))
+	{
+		memset(m_Entries, 0, sizeof(m_Entries));
+	}
+
+	if (bufferType <= 0 || bufferType >= PARAMETER_SET_TYPE_COUNT)
+	{
+		m_Forwarded++;
+		return false;
+	}
+
+	unsigned long long hash = HashBytes(data, length);
+	Entry& entry = m_Entries[bufferType];
+	if (entry.Valid && entry.Length == length && entry.Hash == hash)
+	{
+		m_Suppressed++;
+		return true;
+	}
+
+	entry.Valid = true;
+	entry.Length = length;
+	entry.Hash = hash;
+	m_Forwarded++;
+	return false;
+}
+
+void ParameterSetCache::Invalidate()
+{
+	m_InvalidatePending = true;
+}
+
+long long ParameterSetCache::GetForwardedCount() const
+{
+	return m_Forwarded;
+}
+
+long long ParameterSetCache::GetSuppressedCount() const
+{
+	return m_Suppressed;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// One slot per parameter set buffer type (SPS, PPS and VPS)
+			#define PARAMETER_SET_TYPE_COUNT 4
+
+			// Remembers a hash of the last SPS, PPS and VPS handed to the decoder, so that
+			// the copies the host repeats in front of every IDR frame can be recognised.
+			// A parameter set is only reported as unchanged when it's byte for byte the
+			// same as the last one of its type, so the decoder already holds it.
+			class ParameterSetCache
+			{
+			public:
+				ParameterSetCache();
+
+				// Called on the thread submitting frames. Returns true if the parameter
+				// set can be skipped, and otherwise records it as the active one.
+				bool IsUnchanged(int bufferType, const char* data, int length);
+
+				// Forgets the active parameter sets, e.g. because the decoder was reset.
+				// Safe to call from any thread.
+				void Invalidate();
+
+				long long GetForwardedCount() const;
+
+				long long GetSuppressedCount() const;
+
+			private:
+				ParameterSetCache(const ParameterSetCache&) = delete;
+				ParameterSetCache& operator=(const ParameterSetCache&) = delete;
+
+				struct Entry
+				{
+					bool Valid;
+					int Length;
+					unsigned long long Hash;
+				};
+
+				Entry m_Entries[PARAMETER_SET_TYPE_COUNT];
+				std::atomic<bool> m_InvalidatePending;
+				std::atomic<long long> m_Forwarded;
+				std::atomic<long long> m_Suppressed;
+			};
+		}
+	}
+}
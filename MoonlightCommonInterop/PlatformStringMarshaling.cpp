@@ -0,0 +1,80 @@
+#include <string.h>
+#include <memory>
+#include "StringConversion.h"
+#include "PlatformStringMarshaling.h"
+
+using namespace Platform;
+using namespace Moonlight::Xbox::Interop;
+
+// Enough for any message moonlight-common-c formats
+#define SMALL_STRING_CAPACITY 1024
+
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "Platform::String must hold UTF-16");
+
+String^ Moonlight::Xbox::Interop::Utf8ToPlatformString(const char* string)
+{
+	if (string == NULL)
+	{
+		return ref new String();
+	}
+
+	int length = (int)strlen(string);
+	char16_t stackBuffer[SMALL_STRING_CAPACITY];
+	int required = ConvertUtf8ToUtf16(string, length, stackBuffer, SMALL_STRING_CAPACITY);
+	if (required <= SMALL_STRING_CAPACITY)
+	{
+		return ref new String((const wchar_t*)stackBuffer, required);
+	}
+
+	std::unique_ptr<char16_t[]> heapBuffer(new char16_t[required]);
+	ConvertUtf8ToUtf16(string, length, heapBuffer.get(), required);
+	return ref new String((const wchar_t*)heapBuffer.get(), required);
+}
+
+std::string Moonlight::Xbox::Interop::PlatformStringToUtf8(String^ string)
+{
+	if (string == nullptr || string->Length() == 0)
+	{
+		return std::string();
+	}
+
+	const char16_t* data = (const char16_t*)string->Data();
+	int length = (int)string->Length();
+
+	std::string result;
+	result.resize(ConvertUtf16ToUtf8(data, length, NULL, 0));
+	ConvertUtf16ToUtf8(data, length, &result[0], (int)result.size());
+	return result;
+}
+
+InternedPlatformStrings::InternedPlatformStrings()
+	: m_Count(0)
+{
+	for (int i = 0; i < INTERNED_STRING_CAPACITY; i++)
+	{
+		m_Entries[i].Key = NULL;
+	}
+}
+
+String^ InternedPlatformStrings::Get(const char* string)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	for (int i = 0; i < m_Count; i++)
+	{
+		if (m_Entries[i].Key == string)
+		{
+			return m_Entries[i].Value;
+		}
+	}
+
+	String^ value = Utf8ToPlatformString(string);
+	if (m_Count < INTERNED_STRING_CAPACITY)
+	{
+		m_Entries[m_Count].Key = string;
+		m_Entries[m_Count].Value = value;
+		m_Count++;
+	}
+
+	return value;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			using namespace Platform;
+
+			// Converts a UTF-8 string from moonlight-common-c. Strings that fit in a stack
+			// buffer only allocate for the resulting Platform::String.
+			String^ Utf8ToPlatformString(const char* string);
+
+			std::string PlatformStringToUtf8(String^ string);
+
+			#define INTERNED_STRING_CAPACITY 32
+
+			// Caches the Platform::String for strings with static storage, such as the
+			// names returned by LiGetStageName, keyed by their address so a repeat
+			// lookup is a pointer comparison. Strings past the capacity are converted
+			// on every call.
+			class InternedPlatformStrings
+			{
+			public:
+				InternedPlatformStrings();
+
+				String^ Get(const char* string);
+
+			private:
+				struct Entry
+				{
+					const char* Key;
+					String^ Value;
+				};
+
+				std::mutex m_Lock;
+				Entry m_Entries[INTERNED_STRING_CAPACITY];
+				int m_Count;
+			};
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include "Limelight.h"
+#include "ReferenceFrameTracker.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Beyond this many frames the host is unlikely to still hold the last good
+// reference, so an IDR frame is requested instead
+#define MAX_INVALIDATED_FRAMES 16
+
+// Frames assumed to be in flight before the host reacts to an invalidation
+#define RECOVERY_FRAMES 8
+
+ReferenceFrameTracker::ReferenceFrameTracker()
+	: m_InvalidationSupported(false),
+	m_WaitingForIdr(false),
+	m_HaveReference(false),
+	m_LastGoodFrame(0),
+	m_Recovering(false),
+	m_RecoveryEndFrame(0),
+	m_FramesLost(0),
+	m_InvalidationRequests(0),
+	m_IdrRequests(0),
+	m_FramesSkipped(0)
+{
+}
+
+void ReferenceFrameTracker::Initialize(bool invalidationSupported)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	// Every connection starts with an IDR frame
+	m_InvalidationSupported = invalidationSupported;
+	m_WaitingForIdr = false;
+	m_HaveReference = false;
+	m_LastGoodFrame = 0;
+	m_Recovering = false;
+	m_RecoveryEndFrame = 0;
+}
+
+void ReferenceFrameTracker::FrameDecoded(int frameNumber, int frameType)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (frameType == FRAME_TYPE_IDR)
+	{
+		m_WaitingForIdr = false;
+		m_Recovering = false;
+	}
+	else if (m_WaitingForIdr || !m_HaveReference)
+	{
+		return;
+	}
+	else if (m_Recovering)
+	{
+		if (frameNumber <= m_RecoveryEndFrame)
+		{
+			return;
+		}
+
+		m_Recovering = false;
+	}
+
+	m_HaveReference = true;
+	m_LastGoodFrame = frameNumber;
+}
+
+FrameLossAction ReferenceFrameTracker::RequestIdrFrame()
+{
+	// Frames lost while the IDR frame is on its way don't need another one
+	if (!m_WaitingForIdr)
+	{
+		m_WaitingForIdr = true;
+		m_HaveReference = false;
+		m_Recovering = false;
+		m_IdrRequests++;
+	}
+
+	return FrameLossRequestIdr;
+}
+
+FrameLossAction ReferenceFrameTracker::FrameLost(int frameNumber, int frameType, int* startFrame, int* endFrame)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_FramesLost++;
+
+	// Skipped frames never fail, but a renderer that decodes asynchronously can
+	// still report one that was submitted before the invalidation was sent
+	if (m_Recovering && frameType != FRAME_TYPE_IDR && frameNumber <= m_RecoveryEndFrame)
+	{
+		return FrameLossCovered;
+	}
+
+	if (!m_InvalidationSupported ||
+		m_WaitingForIdr ||
+		!m_HaveReference ||
+		frameType == FRAME_TYPE_IDR)
+	{
+		return RequestIdrFrame();
+	}
+
+	// Everything after the last good frame may reference the lost one, so the
+	// range always starts there
+	int firstLostFrame = m_LastGoodFrame + 1;
+	if (frameNumber < firstLostFrame || frameNumber - firstLostFrame >= MAX_INVALIDATED_FRAMES)
+	{
+		return RequestIdrFrame();
+	}
+
+	*startFrame = firstLostFrame;
+	*endFrame = frameNumber;
+
+	m_Recovering = true;
+	m_RecoveryEndFrame = frameNumber + RECOVERY_FRAMES;
+	m_InvalidationRequests++;
+	return FrameLossInvalidate;
+}
+
+bool ReferenceFrameTracker::ShouldSkipFrame(int frameNumber, int frameType)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (!m_Recovering || frameType == FRAME_TYPE_IDR || frameNumber > m_RecoveryEndFrame)
+	{
+		return false;
+	}
+
+	m_FramesSkipped++;
+	return true;
+}
+
+long long ReferenceFrameTracker::GetFramesLost() const
+{
+	return m_FramesLost;
+}
+
+long long ReferenceFrameTracker::GetInvalidationRequests() const
+{
+	return m_InvalidationRequests;
+}
+
+long long ReferenceFrameTracker::GetIdrRequests() const
+{
+	return m_IdrRequests;
+}
+
+long long ReferenceFrameTracker::GetFramesSkipped() const
+{
+	return m_FramesSkipped;
+}
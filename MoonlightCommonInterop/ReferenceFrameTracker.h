@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			enum FrameLossAction
+			{
+				// An invalidation already in flight covers the frame
+				FrameLossCovered,
+				FrameLossInvalidate,
+				FrameLossRequestIdr,
+			};
+
+			// Decides how the decoder recovers when a frame never reaches it or fails to
+			// decode. With reference frame invalidation the host is told which frames were
+			// lost and encodes the next frame from one the decoder still holds, which is far
+			// smaller than an IDR frame. An IDR frame is still needed when the renderer or
+			// host lacks support, or when too many frames are lost for the host to still
+			// hold a good reference.
+			class ReferenceFrameTracker
+			{
+			public:
+				ReferenceFrameTracker();
+
+				void Initialize(bool invalidationSupported);
+
+				void FrameDecoded(int frameNumber, int frameType);
+
+				// Sets the inclusive range of frames to invalidate when it returns
+				// FrameLossInvalidate
+				FrameLossAction FrameLost(int frameNumber, int frameType, int* startFrame, int* endFrame);
+
+				// Returns true for frames encoded before the host could act on the last
+				// invalidation. They reference a lost frame, so they must not reach the
+				// decoder.
+				bool ShouldSkipFrame(int frameNumber, int frameType);
+
+				long long GetFramesLost() const;
+
+				long long GetInvalidationRequests() const;
+
+				long long GetIdrRequests() const;
+
+				long long GetFramesSkipped() const;
+
+			private:
+				ReferenceFrameTracker(const ReferenceFrameTracker&) = delete;
+				ReferenceFrameTracker& operator=(const ReferenceFrameTracker&) = delete;
+
+				FrameLossAction RequestIdrFrame();
+
+				std::mutex m_Lock;
+				bool m_InvalidationSupported;
+				bool m_WaitingForIdr;
+
+				// Newest frame decoded with all of its references intact
+				bool m_HaveReference;
+				int m_LastGoodFrame;
+
+				// Frames up to m_RecoveryEndFrame were probably encoded before the host saw
+				// the invalidation, so they are skipped rather than decoded
+				bool m_Recovering;
+				int m_RecoveryEndFrame;
+
+				std::atomic<long long> m_FramesLost;
+				std::atomic<long long> m_InvalidationRequests;
+				std::atomic<long long> m_IdrRequests;
+				std::atomic<long long> m_FramesSkipped;
+			};
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Flags for IVideoRenderer::Capabilities. The low bits are passed through to
+			// moonlight-common-c. Bits 16-23 are reserved for capabilities that only the
+			// interop layer acts on and are masked off before starting the connection.
+			[Platform::Metadata::Flags]
+			public enum class VideoRendererCapabilities : unsigned int
+			{
+				None = 0,
+				DirectSubmit = 0x1,
+
+				// Besides covering packet loss, frames that fail to render or can't be
+				// buffered are reported to the host as invalidated references rather
+				// than answered with an IDR frame, while the loss is small enough.
+				ReferenceFrameInvalidationAvc = 0x2,
+				ReferenceFrameInvalidationHevc = 0x4,
+
+				// The renderer consumes decode units through HandleFrameBufferList
+				// instead of receiving a contiguous copy through HandleFrame.
+				ScatterGather = 0x10000,
+
+				// SPS, PPS and VPS buffers identical to the ones last delivered are left
+				// out of the decode unit, since the decoder already holds them.
+				SuppressRepeatedParameterSets = 0x20000,
+
+				// The renderer receives a FrameDescriptor indexing each frame's NAL units
+				FrameDescriptors = 0x40000,
+
+				// Frames arrive with each start code replaced by a 4 or 2 byte big-endian
+				// NAL unit length, as AVCC and HVCC decoders expect. Only applies to
+				// frames the interop layer copies, so ScatterGather renderers setting
+				// either flag receive views over the converted copy.
+				NalLengthPrefix4 = 0x80000,
+				NalLengthPrefix2 = 0x100000,
+			};
+
+			// Flags for IAudioRenderer::Capabilities, split the same way as the video flags
+			[Platform::Metadata::Flags]
+			public enum class AudioRendererCapabilities : unsigned int
+			{
+				None = 0,
+				DirectSubmit = 0x1,
+
+				// HandleFrame receives interleaved float32 samples instead of int16
+				FloatOutput = 0x10000,
+
+				// Size batches from the measured HandleFrame cost, see MaxFramesPerSubmission
+				AdaptiveBatching = 0x20000,
+			};
+		}
+	}
+}
@@ -0,0 +1,181 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <atomic>
+#include "SessionCallbacks.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// C callback declarations
+static int DrSetup(int videoFormat, int width, int height, int redrawRate, void* context, int drFlags);
+static void DrStart();
+static void DrStop();
+static void DrCleanup();
+static int DrSubmitDecodeUnit(PDECODE_UNIT decodeUnit);
+static int ArInit(int audioConfiguration, const POPUS_MULTISTREAM_CONFIGURATION opusConfig, void* context, int arFlags);
+static void ArStart();
+static void ArStop();
+static void ArCleanup();
+static void ArDecodeAndPlaySample(char *sampleData, int sampleLength);
+static void ClStageStarting(int stage);
+static void ClStageComplete(int stage);
+static void ClStageFailed(int stage, long errorCode);
+static void ClConnectionStarted();
+static void ClConnectionTerminated(long errorCode);
+static void ClDisplayMessage(const char* message);
+static void ClDisplayTransientMessage(const char* message);
+static void ClLogMessage(const char* format, ...);
+
+// Written by the app's thread, read by moonlight-common-c's
+static std::atomic<StreamingSession*> s_ActiveSession(NULL);
+
+int DrSetup(
+	int videoFormat,
+	int width,
+	int height,
+	int redrawRate,
+	void* context,
+	int drFlags)
+{
+	return ((StreamingSession*)context)->SetupVideo(videoFormat, width, height, redrawRate);
+}
+
+void DrStart()
+{
+	s_ActiveSession.load()->StartVideo();
+}
+
+void DrStop()
+{
+	s_ActiveSession.load()->StopVideo();
+}
+
+void DrCleanup()
+{
+	s_ActiveSession.load()->CleanupVideo();
+}
+
+int DrSubmitDecodeUnit(PDECODE_UNIT decodeUnit)
+{
+	return s_ActiveSession.load()->SubmitDecodeUnit(decodeUnit);
+}
+
+int ArInit(
+	int audioConfiguration,
+	const POPUS_MULTISTREAM_CONFIGURATION opusConfig,
+	void* context,
+	int arFlags)
+{
+	return ((StreamingSession*)context)->InitializeAudio(audioConfiguration, opusConfig);
+}
+
+void ArStart()
+{
+	s_ActiveSession.load()->StartAudio();
+}
+
+void ArStop()
+{
+	s_ActiveSession.load()->StopAudio();
+}
+
+void ArCleanup()
+{
+	s_ActiveSession.load()->CleanupAudio();
+}
+
+void ArDecodeAndPlaySample(char *sampleData, int sampleLength)
+{
+	s_ActiveSession.load()->DecodeAndPlayAudioSample(sampleData, sampleLength);
+}
+
+void ClStageStarting(int stage)
+{
+	s_ActiveSession.load()->StageStarting(stage);
+}
+
+void ClStageComplete(int stage)
+{
+	s_ActiveSession.load()->StageComplete(stage);
+}
+
+void ClStageFailed(int stage, long errorCode)
+{
+	s_ActiveSession.load()->StageFailed(stage, errorCode);
+}
+
+void ClConnectionStarted()
+{
+	s_ActiveSession.load()->ConnectionStarted();
+}
+
+void ClConnectionTerminated(long errorCode)
+{
+	s_ActiveSession.load()->ConnectionTerminated(errorCode);
+}
+
+void ClDisplayMessage(const char* message)
+{
+	s_ActiveSession.load()->DisplayMessage(message);
+}
+
+void ClDisplayTransientMessage(const char* message)
+{
+	s_ActiveSession.load()->DisplayTransientMessage(message);
+}
+
+void ClLogMessage(const char* format, ...)
+{
+	va_list va;
+	va_start(va, format);
+	s_ActiveSession.load()->LogMessage(format, va);
+	va_end(va);
+}
+
+void Moonlight::Xbox::Interop::InitializeStreamingSessionCallbacks(
+	StreamingSession* session,
+	PDECODER_RENDERER_CALLBACKS videoRendererCallbacks,
+	PAUDIO_RENDERER_CALLBACKS audioRendererCallbacks,
+	PCONNECTION_LISTENER_CALLBACKS connectionListenerCallbacks)
+{
+	LiInitializeVideoCallbacks(videoRendererCallbacks);
+	videoRendererCallbacks->setup = DrSetup;
+	videoRendererCallbacks->start = DrStart;
+	videoRendererCallbacks->stop = DrStop;
+	videoRendererCallbacks->cleanup = DrCleanup;
+	videoRendererCallbacks->submitDecodeUnit = DrSubmitDecodeUnit;
+	videoRendererCallbacks->capabilities = session->GetVideoCapabilities();
+
+	LiInitializeAudioCallbacks(audioRendererCallbacks);
+	audioRendererCallbacks->init = ArInit;
+	audioRendererCallbacks->start = ArStart;
+	audioRendererCallbacks->stop = ArStop;
+	audioRendererCallbacks->cleanup = ArCleanup;
+	audioRendererCallbacks->decodeAndPlaySample = ArDecodeAndPlaySample;
+	audioRendererCallbacks->capabilities = session->GetAudioCapabilities();
+
+	LiInitializeConnectionCallbacks(connectionListenerCallbacks);
+	connectionListenerCallbacks->stageStarting = ClStageStarting;
+	connectionListenerCallbacks->stageComplete = ClStageComplete;
+	connectionListenerCallbacks->stageFailed = ClStageFailed;
+	connectionListenerCallbacks->connectionStarted = ClConnectionStarted;
+	connectionListenerCallbacks->connectionTerminated = ClConnectionTerminated;
+	connectionListenerCallbacks->displayMessage = ClDisplayMessage;
+	connectionListenerCallbacks->displayTransientMessage = ClDisplayTransientMessage;
+	connectionListenerCallbacks->logMessage = ClLogMessage;
+}
+
+void Moonlight::Xbox::Interop::SetActiveStreamingSession(StreamingSession* session)
+{
+	s_ActiveSession = session;
+}
+
+bool Moonlight::Xbox::Interop::ActivateStreamingSession(StreamingSession* session)
+{
+	StreamingSession* activeSession = NULL;
+	return s_ActiveSession.compare_exchange_strong(activeSession, session) || activeSession == session;
+}
+
+StreamingSession* Moonlight::Xbox::Interop::GetActiveStreamingSession()
+{
+	return s_ActiveSession;
+}
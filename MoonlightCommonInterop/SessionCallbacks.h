@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Limelight.h"
+#include "StreamingSession.h"
+
+// Not part of Limelight.h. This is a deliberate dependency on moonlight-common-c's
+// internal API (Limelight-internal.h), so check the signature when updating the
+// submodule. It queues a reference frame invalidation for the inclusive range, or
+// requests an IDR frame if the host can't do one.
+extern "C" void connectionDetectedFrameLoss(int startFrame, int endFrame);
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Fills in moonlight-common-c's callback tables with trampolines into a
+			// StreamingSession. The session must also be passed as the render and audio
+			// context to LiStartConnection.
+			void InitializeStreamingSessionCallbacks(
+				StreamingSession* session,
+				PDECODER_RENDERER_CALLBACKS videoRendererCallbacks,
+				PAUDIO_RENDERER_CALLBACKS audioRendererCallbacks,
+				PCONNECTION_LISTENER_CALLBACKS connectionListenerCallbacks);
+
+			// moonlight-common-c supports a single connection at a time and most of its
+			// callbacks carry no context pointer, so they are routed to the active session.
+			void SetActiveStreamingSession(StreamingSession* session);
+
+			// Makes the session active unless a different one already is, in which
+			// case it returns false and the caller mustn't start a connection.
+			bool ActivateStreamingSession(StreamingSession* session);
+
+			StreamingSession* GetActiveStreamingSession();
+		}
+	}
+}
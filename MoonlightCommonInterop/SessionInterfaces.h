@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Native counterparts of the WinRT renderer and listener interfaces. The
+			// streaming core only talks to these, which keeps it free of C++/CX so it can
+			// be hosted and profiled outside of a UWP process.
+
+			// Same layout as the WinRT BufferView value struct
+			struct NativeBufferView
+			{
+				long long Data;
+				int Length;
+				int BufferType;
+			};
+
+			// Same layout as the WinRT NalUnitDescriptor value struct
+			struct NativeNalUnit
+			{
+				int Buffer;
+				int Offset;
+				int Length;
+				int Type;
+				int SliceType;
+			};
+
+			#define MAX_FRAME_DESCRIPTOR_NAL_UNITS 32
+
+			// Per-frame summary produced by NalIndexer. NalUnitCount stops at the
+			// capacity of NalUnits, but the flags cover every NAL unit in the frame.
+			struct NativeFrameDescriptor
+			{
+				int FrameNumber;
+				int FrameType;
+				bool Idr;
+				bool Reference;
+				bool HdrMetadata;
+				int SliceTypes;
+				int NalUnitCount;
+				NativeNalUnit NalUnits[MAX_FRAME_DESCRIPTOR_NAL_UNITS];
+			};
+
+			class INativeVideoRenderer
+			{
+			public:
+				virtual ~INativeVideoRenderer() {}
+
+				virtual int GetCapabilities() = 0;
+
+				virtual int Initialize(int videoFormat, int width, int height, int redrawRate) = 0;
+
+				virtual void Start() = 0;
+
+				virtual void Stop() = 0;
+
+				virtual void Cleanup() = 0;
+
+				virtual int HandleFrame(const char* frameData, int length, int frameType, int frameNumber, long long receiveTimeMs) = 0;
+
+				virtual int HandleFrameBufferList(const NativeBufferView* buffers, int count, int frameType, int frameNumber, long long receiveTimeMs) = 0;
+
+				virtual void HandleFrameDescriptor(const NativeFrameDescriptor& descriptor) = 0;
+			};
+
+			class INativeAudioRenderer
+			{
+			public:
+				virtual ~INativeAudioRenderer() {}
+
+				virtual int GetCapabilities() = 0;
+
+				virtual int GetOutputSampleRate() = 0;
+
+				virtual int GetMaxFramesPerSubmission() = 0;
+
+				virtual int Initialize(int audioFormat) = 0;
+
+				virtual void Start() = 0;
+
+				virtual void Stop() = 0;
+
+				virtual void Cleanup() = 0;
+
+				virtual void HandleFrame(const char* frameData, int length) = 0;
+			};
+
+			class INativeConnectionListener
+			{
+			public:
+				virtual ~INativeConnectionListener() {}
+
+				virtual void StageStarting(const char* stage) = 0;
+
+				virtual void StageComplete(const char* stage) = 0;
+
+				virtual void StageFailed(const char* stage, long errorCode) = 0;
+
+				virtual void ConnectionStarted() = 0;
+
+				virtual void ConnectionTerminated(long errorCode) = 0;
+
+				virtual void DisplayMessage(const char* message) = 0;
+
+				virtual void DisplayTransientMessage(const char* message) = 0;
+
+				virtual void LogMessage(const char* message) = 0;
+			};
+
+			// Adaptive bitrate tuning in Kbps, where zero leaves a setting at its default
+			struct BitratePolicyConfiguration
+			{
+				int MinimumBitrate;
+				int MaximumBitrate;
+				int StepUpPercent;
+				int StepDownPercent;
+				double LossPercentThreshold;
+				int JitterThresholdUs;
+				int DecodeTimePercentThreshold;
+				int WindowMs;
+				int StepUpWindows;
+				int StepDownWindows;
+			};
+
+			// The subset of StreamConfiguration that the streaming core acts on. The server
+			// strings are kept here so they outlive the connection that points at them.
+			struct StreamingSessionConfiguration
+			{
+				std::string Address;
+				std::string AppVersion;
+				std::string GfeVersion;
+				int Width;
+				int Height;
+				int Fps;
+				int Bitrate;
+				int VideoDecodeQueueDepth;
+				int FramePacing;
+				int AudioJitterBufferTargetMs;
+				bool AudioDownmixToStereo;
+				std::vector<float> AudioDownmixMatrix;
+				int MinimumLogSeverity;
+				bool AdaptiveBitrate;
+				BitratePolicyConfiguration AdaptiveBitratePolicy;
+			};
+		}
+	}
+}
@@ -0,0 +1,173 @@
+#include "CpuFeatures.h"
+#include "StartCodeScanner.h"
+
+#if defined(INTEROP_ARCH_X86)
+#include <immintrin.h>
+#elif defined(INTEROP_ARCH_ARM)
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace Moonlight::Xbox::Interop;
+
+typedef int (*StartCodeKernel)(const unsigned char* data, int length);
+
+static inline int CountTrailingZeros(unsigned int value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (int)index;
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+static int FindStartCodeScalar(const unsigned char* data, int length, int start)
+{
+	int i = start;
+	while (i + 2 < length)
+	{
+		// No start code can begin at i, i + 1 or i + 2 if this byte is above 1
+		if (data[i + 2] > 1)
+		{
+			i += 3;
+		}
+		else if (data[i + 2] == 1 && data[i + 1] == 0 && data[i] == 0)
+		{
+			return i;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	return -1;
+}
+
+static int FindStartCodeScalar(const unsigned char* data, int length)
+{
+	return FindStartCodeScalar(data, length, 0);
+}
+
+#if defined(INTEROP_ARCH_X86)
+
+static int FindStartCodeSse2(const unsigned char* data, int length)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	int i = 0;
+	for (; i + 18 <= length; i += 16)
+	{
+		// Bit k is set when bytes k and k + 1 are both zero
+		__m128i current = _mm_loadu_si128((const __m128i*)&data[i]);
+		__m128i next = _mm_loadu_si128((const __m128i*)&data[i + 1]);
+		unsigned int candidates =
+			(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(current, zero)) &
+			(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(next, zero));
+		while (candidates != 0)
+		{
+			int k = CountTrailingZeros(candidates);
+			if (data[i + k + 2] == 1)
+			{
+				return i + k;
+			}
+			candidates &= candidates - 1;
+		}
+	}
+
+	return FindStartCodeScalar(data, length, i);
+}
+
+INTEROP_TARGET_AVX2
+static int FindStartCodeAvx2(const unsigned char* data, int length)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	int i = 0;
+	for (; i + 34 <= length; i += 32)
+	{
+		__m256i current = _mm256_loadu_si256((const __m256i*)&data[i]);
+		__m256i next = _mm256_loadu_si256((const __m256i*)&data[i + 1]);
+		unsigned int candidates =
+			(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(current, zero)) &
+			(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(next, zero));
+		while (candidates != 0)
+		{
+			int k = CountTrailingZeros(candidates);
+			if (data[i + k + 2] == 1)
+			{
+				return i + k;
+			}
+			candidates &= candidates - 1;
+		}
+	}
+
+	return FindStartCodeScalar(data, length, i);
+}
+
+#elif defined(INTEROP_ARCH_ARM)
+
+static int FindStartCodeNeon(const unsigned char* data, int length)
+{
+	const uint8x16_t zero = vdupq_n_u8(0);
+
+	int i = 0;
+	for (; i + 18 <= length; i += 16)
+	{
+		uint8x16_t pairs =
+			vandq_u8(
+				vceqq_u8(vld1q_u8(&data[i]), zero),
+				vceqq_u8(vld1q_u8(&data[i + 1]), zero));
+		uint64x2_t wide = vreinterpretq_u64_u8(pairs);
+		if ((vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) == 0)
+		{
+			continue;
+		}
+
+		int found = FindStartCodeScalar(data, i + 18, i);
+		if (found >= 0)
+		{
+			return found;
+		}
+	}
+
+	return FindStartCodeScalar(data, length, i);
+}
+
+#endif
+
+static StartCodeKernel SelectStartCodeKernel()
+{
+	const CpuFeatures& features = GetCpuFeatures();
+
+#if defined(INTEROP_ARCH_X86)
+	if (features.Avx2)
+	{
+		return FindStartCodeAvx2;
+	}
+	else if (features.Sse2)
+	{
+		return FindStartCodeSse2;
+	}
+#elif defined(INTEROP_ARCH_ARM)
+	if (features.Neon)
+	{
+		return FindStartCodeNeon;
+	}
+#else
+	(void)features;
+#endif
+
+	return FindStartCodeScalar;
+}
+
+int Moonlight::Xbox::Interop::FindStartCode(const unsigned char* data, int length)
+{
+	static const StartCodeKernel s_Kernel = SelectStartCodeKernel();
+	return s_Kernel(data, length);
+}
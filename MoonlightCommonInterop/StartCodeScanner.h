@@ -0,0 +1,16 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Returns the offset of the first Annex B start code prefix (00 00 01) in
+			// data, or -1 if there is none. A 4 byte start code is found at its second
+			// byte. The fastest kernel the CPU supports (SSE2, AVX2 or NEON) is
+			// selected on first use.
+			int FindStartCode(const unsigned char* data, int length);
+		}
+	}
+}
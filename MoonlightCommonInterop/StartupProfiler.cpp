@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <vector>
+#include "Limelight.h"
+#include "Clock.h"
+#include "StartupProfiler.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Connections remembered for the cross-connection percentiles
+#define STARTUP_HISTORY_SIZE 256
+
+// Stage identifiers are small integers, so index the history by them directly
+#define STARTUP_HISTORY_STAGE_COUNT 32
+
+namespace
+{
+	struct StartupHistory
+	{
+		std::vector<long long> Samples;
+		size_t Next;
+
+		void Add(long long sample)
+		{
+			if (Samples.size() < STARTUP_HISTORY_SIZE)
+			{
+				Samples.push_back(sample);
+			}
+			else
+			{
+				Samples[Next] = sample;
+				Next = (Next + 1) % STARTUP_HISTORY_SIZE;
+			}
+		}
+	};
+}
+
+static std::mutex s_HistoryLock;
+static StartupHistory s_StageHistory[STARTUP_HISTORY_STAGE_COUNT];
+static StartupHistory s_TimeToFirstFrameHistory;
+static StartupHistory s_ReconnectHistory;
+
+static void AppendTraceEvent(std::string& trace, const char* name, const char* phase, long long timestampUs, long long durationUs, const char* args)
+{
+	char event[512];
+	if (durationUs >= 0)
+	{
+		snprintf(event, sizeof(event),
+			"%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"%s\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1%s}",
+			trace.back() == '[' ? "" : ",", name, phase, timestampUs, durationUs, args);
+	}
+	else
+	{
+		snprintf(event, sizeof(event),
+			"%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"%s\",\"s\":\"g\",\"ts\":%lld,\"pid\":1,\"tid\":1%s}",
+			trace.back() == '[' ? "" : ",", name, phase, timestampUs, args);
+	}
+	trace += event;
+}
+
+StartupProfiler::StartupProfiler()
+	: m_FirstFrameReceived(false)
+{
+	Begin(false);
+}
+
+void StartupProfiler::Begin(bool reconnect)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	m_Timeline = StartupTimelineData();
+	m_Timeline.OriginUs = GetTimeMicroseconds();
+	m_Timeline.Reconnect = reconnect;
+	m_FirstFrameReceived = false;
+}
+
+StartupStageRecord* StartupProfiler::FindOpenStage(int stage)
+{
+	for (int i = m_Timeline.StageCount - 1; i >= 0; i--)
+	{
+		if (m_Timeline.Stages[i].Stage == stage && m_Timeline.Stages[i].EndUs == 0)
+		{
+			return &m_Timeline.Stages[i];
+		}
+	}
+
+	return NULL;
+}
+
+void StartupProfiler::StageStarting(int stage)
+{
+	long long nowUs = GetTimeMicroseconds();
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (m_Timeline.StageCount < STARTUP_MAX_STAGE_RECORDS)
+	{
+		StartupStageRecord& record = m_Timeline.Stages[m_Timeline.StageCount++];
+		record.Stage = stage;
+		record.StartUs = nowUs;
+		record.EndUs = 0;
+		record.Failed = false;
+		record.ErrorCode = 0;
+	}
+}
+
+void StartupProfiler::EndStage(int stage, bool failed, long errorCode)
+{
+	long long nowUs = GetTimeMicroseconds();
+	long long durationUs;
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		StartupStageRecord* record = FindOpenStage(stage);
+		if (record == NULL)
+		{
+			return;
+		}
+
+		record->EndUs = nowUs;
+		record->Failed = failed;
+		record->ErrorCode = errorCode;
+		durationUs = nowUs - record->StartUs;
+	}
+
+	if (!failed && stage >= 0 && stage < STARTUP_HISTORY_STAGE_COUNT)
+	{
+		std::lock_guard<std::mutex> lock(s_HistoryLock);
+		s_StageHistory[stage].Add(durationUs);
+	}
+}
+
+void StartupProfiler::StageComplete(int stage)
+{
+	EndStage(stage, false, 0);
+}
+
+void StartupProfiler::StageFailed(int stage, long errorCode)
+{
+	EndStage(stage, true, errorCode);
+}
+
+void StartupProfiler::ConnectionStarted()
+{
+	long long nowUs = GetTimeMicroseconds();
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Timeline.ConnectionStartedUs = nowUs;
+}
+
+void StartupProfiler::FrameReceived()
+{
+	// Keep the per-frame cost to one relaxed load once the first frame is in
+	if (m_FirstFrameReceived.load(std::memory_order_relaxed) || m_FirstFrameReceived.exchange(true))
+	{
+		return;
+	}
+
+	long long nowUs = GetTimeMicroseconds();
+	long long timeToFirstFrameUs;
+	bool reconnect;
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Timeline.FirstFrameUs = nowUs;
+		timeToFirstFrameUs = nowUs - m_Timeline.OriginUs;
+		reconnect = m_Timeline.Reconnect;
+	}
+
+	std::lock_guard<std::mutex> lock(s_HistoryLock);
+	if (reconnect)
+	{
+		s_ReconnectHistory.Add(timeToFirstFrameUs);
+	}
+	else
+	{
+		s_TimeToFirstFrameHistory.Add(timeToFirstFrameUs);
+	}
+}
+
+StartupTimelineData StartupProfiler::GetTimeline() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_Timeline;
+}
+
+std::string StartupProfiler::ExportTrace() const
+{
+	StartupTimelineData timeline = GetTimeline();
+	long long nowUs = GetTimeMicroseconds();
+
+	std::string trace = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (int i = 0; i < timeline.StageCount; i++)
+	{
+		const StartupStageRecord& record = timeline.Stages[i];
+
+		// Stages still running are drawn up to now
+		long long endUs = record.EndUs != 0 ? record.EndUs : nowUs;
+
+		char args[128];
+		snprintf(args, sizeof(args),
+			",\"args\":{\"stage\":%d,\"complete\":%s,\"failed\":%s,\"errorCode\":%ld}",
+			record.Stage,
+			record.EndUs != 0 ? "true" : "false",
+			record.Failed ? "true" : "false",
+			record.ErrorCode);
+
+		AppendTraceEvent(trace, LiGetStageName(record.Stage), "X", record.StartUs - timeline.OriginUs, endUs - record.StartUs, args);
+	}
+
+	if (timeline.ConnectionStartedUs != 0)
+	{
+		AppendTraceEvent(trace, "Connection started", "i", timeline.ConnectionStartedUs - timeline.OriginUs, -1, "");
+	}
+
+	if (timeline.FirstFrameUs != 0)
+	{
+		AppendTraceEvent(trace, "First frame received", "i", timeline.FirstFrameUs - timeline.OriginUs, -1, "");
+	}
+
+	trace += "]}";
+	return trace;
+}
+
+LatencyPercentileResult StartupProfiler::GetStagePercentiles(int stage)
+{
+	std::vector<long long> samples;
+	if (stage >= 0 && stage < STARTUP_HISTORY_STAGE_COUNT)
+	{
+		std::lock_guard<std::mutex> lock(s_HistoryLock);
+		samples = s_StageHistory[stage].Samples;
+	}
+
+	return ComputeLatencyPercentiles(samples);
+}
+
+LatencyPercentileResult StartupProfiler::GetTimeToFirstFramePercentiles()
+{
+	std::vector<long long> samples;
+	{
+		std::lock_guard<std::mutex> lock(s_HistoryLock);
+		samples = s_TimeToFirstFrameHistory.Samples;
+	}
+
+	return ComputeLatencyPercentiles(samples);
+}
+
+LatencyPercentileResult StartupProfiler::GetReconnectTimePercentiles()
+{
+	std::vector<long long> samples;
+	{
+		std::lock_guard<std::mutex> lock(s_HistoryLock);
+		samples = s_ReconnectHistory.Samples;
+	}
+
+	return ComputeLatencyPercentiles(samples);
+}
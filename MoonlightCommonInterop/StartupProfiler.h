@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "FrameLatencyTracker.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			#define STARTUP_MAX_STAGE_RECORDS 32
+
+			struct StartupStageRecord
+			{
+				int Stage;
+				long long StartUs;
+				long long EndUs;
+				bool Failed;
+				long ErrorCode;
+			};
+
+			// All timestamps are on the GetTimeMicroseconds clock. Events that haven't
+			// happened yet are 0.
+			struct StartupTimelineData
+			{
+				long long OriginUs;
+
+				// Set when the attempt re-established transport for an existing session
+				bool Reconnect;
+				int StageCount;
+				StartupStageRecord Stages[STARTUP_MAX_STAGE_RECORDS];
+				long long ConnectionStartedUs;
+				long long FirstFrameUs;
+			};
+
+			// Timestamps each moonlight-common-c startup stage of one connection, from the
+			// moment the session is created until the first frame arrives. Completed stage
+			// durations and time to first frame are also added to a process-wide history,
+			// so percentiles can be taken across connections.
+			class StartupProfiler
+			{
+			public:
+				StartupProfiler();
+
+				// Marks the start of a connection attempt and clears the timeline
+				void Begin(bool reconnect);
+
+				void StageStarting(int stage);
+
+				void StageComplete(int stage);
+
+				void StageFailed(int stage, long errorCode);
+
+				void ConnectionStarted();
+
+				// Called for every decode unit. Only the first after Begin is recorded.
+				void FrameReceived();
+
+				StartupTimelineData GetTimeline() const;
+
+				// The timeline in Chrome trace event format, relative to the origin
+				std::string ExportTrace() const;
+
+				static LatencyPercentileResult GetStagePercentiles(int stage);
+
+				static LatencyPercentileResult GetTimeToFirstFramePercentiles();
+
+				// Time from the start of a reconnect to its first frame
+				static LatencyPercentileResult GetReconnectTimePercentiles();
+
+			private:
+				StartupProfiler(const StartupProfiler&) = delete;
+				StartupProfiler& operator=(const StartupProfiler&) = delete;
+
+				StartupStageRecord* FindOpenStage(int stage);
+
+				void EndStage(int stage, bool failed, long errorCode);
+
+				mutable std::mutex m_Lock;
+				StartupTimelineData m_Timeline;
+				std::atomic<bool> m_FirstFrameReceived;
+			};
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			using namespace Platform;
+
+			// One moonlight-common-c startup stage. Times are relative to the start of the connection attempt.
+			public ref class StartupStageTiming sealed
+			{
+			public:
+				property String^ Name;
+
+				property __int64 StartUs;
+
+				// 0 while the stage is still running
+				property __int64 DurationUs;
+
+				property bool Complete;
+
+				property bool Failed;
+
+				property int ErrorCode;
+			};
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "StartupStageTiming.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			using namespace Platform;
+
+			// Startup of the current connection. Times are relative to the start of the
+			// connection attempt, and 0 for events that haven't happened yet.
+			public ref class StartupTimeline sealed
+			{
+			public:
+				property Array<StartupStageTiming^>^ Stages;
+
+				// True when this timeline belongs to a Reconnect rather than StartConnection
+				property bool Reconnect;
+
+				property __int64 ConnectionStartedUs;
+
+				property __int64 TimeToFirstFrameUs;
+			};
+		}
+	}
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "AdaptiveBitratePolicy.h"
+#include "FramePacingPolicy.h"
+#include "LogLevel.h"
+
 namespace Moonlight
 {
 	namespace Xbox
@@ -19,6 +23,10 @@ namespace Moonlight
 
 				property int Bitrate;
 
+				// Enables the adaptive bitrate controller when set. The chosen bitrate
+				// takes effect through MoonlightCommonInterop::AdjustBitrate.
+				property AdaptiveBitratePolicy^ AdaptiveBitrate;
+
 				property int PacketSize;
 
 				property int StreamingRemotely;
@@ -36,6 +44,21 @@ namespace Moonlight
 				property Array<unsigned char>^ RemoteInputAesKey;
 
 				property Array<unsigned char>^ RemoteInputAesIv;
+
+				property int VideoDecodeQueueDepth;
+
+				// Paced against ClientRefreshRateX100 until the renderer reports vsync
+				// through MoonlightCommonInterop::NotifyVsync
+				property FramePacingPolicy FramePacing;
+
+				property int AudioJitterBufferTargetMs;
+
+				property bool AudioDownmixToStereo;
+
+				// Row-major 2xN matrix for an N channel stream, or null for the default
+				property Array<float>^ AudioDownmixMatrix;
+
+				property LogLevel MinimumLogLevel;
 			};
 		}
 	}
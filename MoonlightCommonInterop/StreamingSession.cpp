@@ -0,0 +1,890 @@
+#include <stdint.h>
+#include <string.h>
+#include "Clock.h"
+#include "NalLengthPrefixing.h"
+#include "SessionCallbacks.h"
+#include "StreamingSession.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// One buffer for the frame being assembled and one for the frame being rendered,
+// plus one for every frame waiting in the decode queue.
+#define FRAME_BUFFER_POOL_SIZE 2
+
+// Frames the frame pacer typically holds between vsyncs
+#define FRAME_PACER_POOL_SIZE 2
+
+#define INITIAL_BUFFER_VIEW_COUNT 256
+
+// Matches VideoRendererCapabilities::ScatterGather
+#define VIDEO_CAPABILITY_SCATTER_GATHER 0x10000
+
+// Matches VideoRendererCapabilities::SuppressRepeatedParameterSets
+#define VIDEO_CAPABILITY_PARAMETER_SET_CACHE 0x20000
+
+// Matches VideoRendererCapabilities::FrameDescriptors
+#define VIDEO_CAPABILITY_FRAME_DESCRIPTORS 0x40000
+
+// Match VideoRendererCapabilities::NalLengthPrefix4 and NalLengthPrefix2
+#define VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_4 0x80000
+#define VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_2 0x100000
+
+// Matches AudioRendererCapabilities::FloatOutput
+#define AUDIO_CAPABILITY_FLOAT_OUTPUT 0x10000
+
+// Matches AudioRendererCapabilities::AdaptiveBatching
+#define AUDIO_CAPABILITY_ADAPTIVE_BATCHING 0x20000
+
+StreamingSession::StreamingSession(
+	const StreamingSessionConfiguration& configuration,
+	INativeVideoRenderer* videoRenderer,
+	INativeAudioRenderer* audioRenderer,
+	INativeConnectionListener* connectionListener)
+	: m_Configuration(configuration),
+	m_VideoRenderer(videoRenderer),
+	m_AudioRenderer(audioRenderer),
+	m_ConnectionListener(connectionListener),
+	m_VideoCapabilities(videoRenderer->GetCapabilities()),
+	m_AudioCapabilities(audioRenderer->GetCapabilities()),
+	m_NalLengthSize(0),
+	m_RetainResources(false),
+	m_VideoInitialized(false),
+	m_VideoFormat(0),
+	m_VideoWidth(0),
+	m_VideoHeight(0),
+	m_VideoRedrawRate(0),
+	m_AudioInitialized(false),
+	m_AudioConfiguration(0),
+	m_DecodeUnitsSubmitted(0),
+	m_VideoBytesCopied(0),
+	m_AudioPipeline(audioRenderer),
+	m_Logger(connectionListener)
+{
+	if (m_VideoCapabilities & VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_4)
+	{
+		m_NalLengthSize = 4;
+	}
+	else if (m_VideoCapabilities & VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_2)
+	{
+		m_NalLengthSize = 2;
+	}
+
+	LiInitializeStreamConfiguration(&m_StreamConfiguration);
+	memset(&m_OpusConfig, 0, sizeof(m_OpusConfig));
+	m_BitrateController.Initialize(
+		configuration.AdaptiveBitrate,
+		configuration.AdaptiveBitratePolicy,
+		configuration.Fps,
+		configuration.Bitrate);
+	m_Logger.Start((LogSeverity)configuration.MinimumLogSeverity);
+}
+
+StreamingSession::~StreamingSession()
+{
+	ReleaseResources();
+	m_VideoDecodeQueue.Stop();
+	m_FramePacer.Stop();
+	m_FrameBufferPool.Cleanup();
+	m_AudioPipeline.Cleanup();
+	m_Logger.Stop();
+}
+
+int StreamingSession::GetVideoCapabilities() const
+{
+	return m_VideoCapabilities & ~INTEROP_VIDEO_CAPABILITIES_MASK;
+}
+
+int StreamingSession::GetAudioCapabilities() const
+{
+	return m_AudioCapabilities & ~INTEROP_AUDIO_CAPABILITIES_MASK;
+}
+
+void StreamingSession::SetStreamConfiguration(const STREAM_CONFIGURATION& streamConfiguration)
+{
+	m_StreamConfiguration = streamConfiguration;
+	m_BitrateController.SetBitrate(streamConfiguration.bitrate);
+}
+
+const STREAM_CONFIGURATION& StreamingSession::GetStreamConfiguration() const
+{
+	return m_StreamConfiguration;
+}
+
+void StreamingSession::SetRetainResources(bool retain)
+{
+	m_RetainResources = retain;
+}
+
+void StreamingSession::ReleaseResources()
+{
+	if (m_VideoInitialized)
+	{
+		ReleaseVideo();
+	}
+
+	if (m_AudioInitialized)
+	{
+		ReleaseAudio();
+	}
+}
+
+void StreamingSession::BeginReconnect()
+{
+	m_StartupProfiler.Begin(true);
+}
+
+void StreamingSession::InitializeReferenceFrameTracker(int videoFormat)
+{
+	int invalidationCapability =
+		(videoFormat & VIDEO_FORMAT_MASK_H265) ?
+			CAPABILITY_REFERENCE_FRAME_INVALIDATION_HEVC :
+			CAPABILITY_REFERENCE_FRAME_INVALIDATION_AVC;
+	m_ReferenceFrameTracker.Initialize((m_VideoCapabilities & invalidationCapability) != 0);
+}
+
+int StreamingSession::SetupVideo(int videoFormat, int width, int height, int redrawRate)
+{
+	if (m_VideoInitialized)
+	{
+		if (videoFormat == m_VideoFormat &&
+			width == m_VideoWidth &&
+			height == m_VideoHeight &&
+			redrawRate == m_VideoRedrawRate)
+		{
+			// Retained across a reconnect. The stream restarts with an IDR frame,
+			// so the renderer's decoder state needs no explicit reset.
+			m_FrameLatencyTracker.Reset();
+			m_ParameterSetCache.Invalidate();
+			m_NalIndexer.Initialize(videoFormat);
+			m_ReferenceIndexer.Initialize(videoFormat);
+			InitializeReferenceFrameTracker(videoFormat);
+			return 0;
+		}
+
+		ReleaseVideo();
+	}
+
+	int err = m_VideoRenderer->Initialize(videoFormat, width, height, redrawRate);
+	if (err != 0)
+	{
+		return err;
+	}
+
+	int poolSize = FRAME_BUFFER_POOL_SIZE;
+	if (m_Configuration.FramePacing != FramePacingOff)
+	{
+		poolSize += FRAME_PACER_POOL_SIZE;
+	}
+	else
+	{
+		poolSize += m_Configuration.VideoDecodeQueueDepth;
+	}
+
+	if (!m_FrameBufferPool.Initialize(
+			width,
+			height,
+			m_Configuration.Fps,
+			m_Configuration.Bitrate,
+			poolSize))
+	{
+		ReleaseVideo();
+		return -1;
+	}
+
+	m_BufferViews.reserve(INITIAL_BUFFER_VIEW_COUNT);
+	m_FrameLatencyTracker.Reset();
+	m_ParameterSetCache.Invalidate();
+	m_NalIndexer.Initialize(videoFormat);
+	m_ReferenceIndexer.Initialize(videoFormat);
+	InitializeReferenceFrameTracker(videoFormat);
+
+	m_VideoInitialized = true;
+	m_VideoFormat = videoFormat;
+	m_VideoWidth = width;
+	m_VideoHeight = height;
+	m_VideoRedrawRate = redrawRate;
+	return 0;
+}
+
+void StreamingSession::StartVideo()
+{
+	m_VideoRenderer->Start();
+
+	if (m_Configuration.FramePacing != FramePacingOff)
+	{
+		// The pacer has its own thread, so it takes the place of the decode queue
+		m_FramePacer.Start(
+			(FramePacingMode)m_Configuration.FramePacing,
+			m_Configuration.Fps,
+			m_StreamConfiguration.clientRefreshRateX100,
+			&m_FrameBufferPool,
+			HandleQueuedFrame,
+			this);
+	}
+	else if (m_Configuration.VideoDecodeQueueDepth > 0)
+	{
+		m_VideoDecodeQueue.Start(
+			m_Configuration.VideoDecodeQueueDepth,
+			&m_FrameBufferPool,
+			HandleQueuedFrame,
+			this);
+	}
+}
+
+void StreamingSession::StopVideo()
+{
+	m_VideoDecodeQueue.Stop();
+	m_FramePacer.Stop();
+
+	m_VideoRenderer->Stop();
+}
+
+void StreamingSession::CleanupVideo()
+{
+	if (!m_RetainResources)
+	{
+		ReleaseVideo();
+	}
+}
+
+void StreamingSession::ReleaseVideo()
+{
+	m_FrameBufferPool.Cleanup();
+	m_BufferViews.clear();
+
+	m_VideoRenderer->Cleanup();
+	m_VideoInitialized = false;
+}
+
+bool StreamingSession::IsRedundantParameterSet(PLENTRY entry)
+{
+	return (m_VideoCapabilities & VIDEO_CAPABILITY_PARAMETER_SET_CACHE) != 0 &&
+		entry->bufferType != BUFFER_TYPE_PICDATA &&
+		m_ParameterSetCache.IsUnchanged(entry->bufferType, entry->data, entry->length);
+}
+
+int StreamingSession::SubmitBufferList(PDECODE_UNIT decodeUnit)
+{
+	// Hand the renderer views directly over moonlight-common-c's buffers. They are
+	// only valid until this callback returns, so the renderer must consume them
+	// before returning from HandleFrameBufferList.
+	bool describeFrame = (m_VideoCapabilities & VIDEO_CAPABILITY_FRAME_DESCRIPTORS) != 0;
+	if (describeFrame)
+	{
+		m_NalIndexer.Begin(decodeUnit->frameNumber, decodeUnit->frameType);
+	}
+
+	m_BufferViews.clear();
+	PLENTRY currentEntry = decodeUnit->bufferList;
+	while (currentEntry != NULL)
+	{
+		if (IsRedundantParameterSet(currentEntry))
+		{
+			currentEntry = currentEntry->next;
+			continue;
+		}
+
+		NativeBufferView view;
+		view.Data = (long long)(intptr_t)currentEntry->data;
+		view.Length = currentEntry->length;
+		view.BufferType = currentEntry->bufferType;
+		m_BufferViews.push_back(view);
+
+		// Entries are packet payloads, so NAL units run on from one into the next
+		if (describeFrame)
+		{
+			m_NalIndexer.IndexBuffer(currentEntry->data, currentEntry->length);
+		}
+
+		currentEntry = currentEntry->next;
+	}
+
+	if (describeFrame)
+	{
+		m_NalIndexer.End();
+		m_VideoRenderer->HandleFrameDescriptor(m_NalIndexer.GetDescriptor());
+	}
+
+	// Nothing is copied on this path, so the copy and render start points coincide
+	long long renderStartUs = GetTimeMicroseconds();
+	m_FrameLatencyTracker.RecordPoint(decodeUnit->frameNumber, FrameTraceBufferCopied, renderStartUs);
+	m_FrameLatencyTracker.RecordPoint(decodeUnit->frameNumber, FrameTraceRenderStart, renderStartUs);
+
+	int ret =
+		m_VideoRenderer->HandleFrameBufferList(
+			m_BufferViews.data(),
+			(int)m_BufferViews.size(),
+			decodeUnit->frameType,
+			decodeUnit->frameNumber,
+			decodeUnit->receiveTimeMs);
+
+	long long renderEndUs = GetTimeMicroseconds();
+	m_FrameLatencyTracker.RecordPoint(decodeUnit->frameNumber, FrameTraceRenderEnd, renderEndUs);
+	m_BitrateController.FrameDecoded(renderEndUs - renderStartUs);
+	if (ret != DR_OK)
+	{
+		m_ParameterSetCache.Invalidate();
+		return HandleFrameLoss(decodeUnit->frameNumber, decodeUnit->frameType);
+	}
+
+	m_ReferenceFrameTracker.FrameDecoded(decodeUnit->frameNumber, decodeUnit->frameType);
+	return DR_OK;
+}
+
+int StreamingSession::DiscardFrame(VideoFrame* frame)
+{
+	m_FrameBufferPool.Release(frame->Buffer);
+	frame->Buffer = NULL;
+	m_ParameterSetCache.Invalidate();
+	return DR_NEED_IDR;
+}
+
+int StreamingSession::AssembleFrame(PDECODE_UNIT decodeUnit, VideoFrame* frame)
+{
+	int frameLength = decodeUnit->fullLength;
+	if (m_NalLengthSize != 0)
+	{
+		frameLength = GetMaxLengthPrefixedSize(frameLength, m_NalLengthSize);
+	}
+
+	frame->Buffer = m_FrameBufferPool.Acquire(frameLength);
+	if (frame->Buffer == NULL)
+	{
+		return DR_NEED_IDR;
+	}
+
+	frame->SegmentCount = 0;
+	frame->FrameType = decodeUnit->frameType;
+	frame->FrameNumber = decodeUnit->frameNumber;
+	frame->ReceiveTimeMs = decodeUnit->receiveTimeMs;
+	frame->EnqueueTimeUs = 0;
+
+	// Start codes are rewritten as length prefixes as part of the copy. Picture
+	// data arrives one packet per entry and NAL units span packets, so each
+	// segment is converted as a single stream.
+	LengthPrefixedNalWriter nalWriter;
+	VideoFrameSegment* segment = NULL;
+	PLENTRY currentEntry = decodeUnit->bufferList;
+	int offset = 0;
+	while (true)
+	{
+		if (currentEntry != NULL && IsRedundantParameterSet(currentEntry))
+		{
+			currentEntry = currentEntry->next;
+			continue;
+		}
+
+		// Parameter set NALUs each get their own segment so they can be submitted
+		// separately from picture data. Consecutive picture data is coalesced.
+		bool continuesSegment =
+			currentEntry != NULL &&
+			segment != NULL &&
+			currentEntry->bufferType == BUFFER_TYPE_PICDATA &&
+			segment->BufferType == BUFFER_TYPE_PICDATA;
+		if (!continuesSegment && segment != NULL && m_NalLengthSize != 0)
+		{
+			segment->Length = nalWriter.Finish();
+			if (segment->Length < 0)
+			{
+				return DiscardFrame(frame);
+			}
+			offset += segment->Length;
+		}
+
+		if (currentEntry == NULL)
+		{
+			break;
+		}
+
+		if (!continuesSegment)
+		{
+			if (frame->SegmentCount == MAX_VIDEO_FRAME_SEGMENTS)
+			{
+				return DiscardFrame(frame);
+			}
+
+			segment = &frame->Segments[frame->SegmentCount++];
+			segment->Offset = offset;
+			segment->Length = 0;
+			segment->BufferType = currentEntry->bufferType;
+			if (m_NalLengthSize != 0)
+			{
+				nalWriter.Begin(m_NalLengthSize, &frame->Buffer->Data[offset], frame->Buffer->Capacity - offset);
+			}
+		}
+
+		if (m_NalLengthSize != 0)
+		{
+			if (!nalWriter.Append(currentEntry->data, currentEntry->length))
+			{
+				return DiscardFrame(frame);
+			}
+		}
+		else
+		{
+			memcpy(&frame->Buffer->Data[offset], currentEntry->data, currentEntry->length);
+			segment->Length += currentEntry->length;
+			offset += currentEntry->length;
+		}
+
+		currentEntry = currentEntry->next;
+	}
+
+	m_VideoBytesCopied += offset;
+	m_FrameLatencyTracker.RecordPoint(frame->FrameNumber, FrameTraceBufferCopied, GetTimeMicroseconds());
+	return DR_OK;
+}
+
+int StreamingSession::RenderFrameSegments(VideoFrame* frame)
+{
+	if (m_VideoCapabilities & VIDEO_CAPABILITY_SCATTER_GATHER)
+	{
+		m_BufferViews.clear();
+		for (int i = 0; i < frame->SegmentCount; i++)
+		{
+			NativeBufferView view;
+			view.Data = (long long)(intptr_t)&frame->Buffer->Data[frame->Segments[i].Offset];
+			view.Length = frame->Segments[i].Length;
+			view.BufferType = frame->Segments[i].BufferType;
+			m_BufferViews.push_back(view);
+		}
+
+		return
+			m_VideoRenderer->HandleFrameBufferList(
+				m_BufferViews.data(),
+				(int)m_BufferViews.size(),
+				frame->FrameType,
+				frame->FrameNumber,
+				frame->ReceiveTimeMs);
+	}
+
+	for (int i = 0; i < frame->SegmentCount; i++)
+	{
+		VideoFrameSegment* segment = &frame->Segments[i];
+		int ret =
+			m_VideoRenderer->HandleFrame(
+				&frame->Buffer->Data[segment->Offset],
+				segment->Length,
+				segment->BufferType,
+				frame->FrameNumber,
+				frame->ReceiveTimeMs);
+		if (ret != DR_OK)
+		{
+			return ret;
+		}
+	}
+
+	return DR_OK;
+}
+
+void StreamingSession::IndexFrame(NalIndexer& indexer, const VideoFrame* frame)
+{
+	// Each segment reaches the renderer as a buffer of its own, so NAL units are
+	// located by segment
+	indexer.Begin(frame->FrameNumber, frame->FrameType);
+	for (int i = 0; i < frame->SegmentCount; i++)
+	{
+		const VideoFrameSegment& segment = frame->Segments[i];
+		if (m_NalLengthSize != 0)
+		{
+			indexer.IndexLengthPrefixedBuffer(&frame->Buffer->Data[segment.Offset], segment.Length, m_NalLengthSize);
+		}
+		else
+		{
+			indexer.IndexBuffer(&frame->Buffer->Data[segment.Offset], segment.Length);
+		}
+	}
+
+	indexer.End();
+}
+
+int StreamingSession::RenderFrame(VideoFrame* frame)
+{
+	// The frame may have been queued before an earlier one failed to decode
+	if (m_ReferenceFrameTracker.ShouldSkipFrame(frame->FrameNumber, frame->FrameType))
+	{
+		return DR_OK;
+	}
+
+	long long renderStartUs = GetTimeMicroseconds();
+	m_FrameLatencyTracker.RecordPoint(frame->FrameNumber, FrameTraceRenderStart, renderStartUs);
+
+	if ((m_VideoCapabilities & VIDEO_CAPABILITY_FRAME_DESCRIPTORS) && frame->SegmentCount > 0)
+	{
+		IndexFrame(m_NalIndexer, frame);
+		m_VideoRenderer->HandleFrameDescriptor(m_NalIndexer.GetDescriptor());
+	}
+
+	int ret = RenderFrameSegments(frame);
+	long long renderEndUs = GetTimeMicroseconds();
+	m_FrameLatencyTracker.RecordPoint(frame->FrameNumber, FrameTraceRenderEnd, renderEndUs);
+	m_BitrateController.FrameDecoded(renderEndUs - renderStartUs);
+
+	// The decoder may have lost its parameter sets along with the frame
+	if (ret != DR_OK)
+	{
+		m_ParameterSetCache.Invalidate();
+		return HandleFrameLoss(frame->FrameNumber, frame->FrameType);
+	}
+
+	m_ReferenceFrameTracker.FrameDecoded(frame->FrameNumber, frame->FrameType);
+	return DR_OK;
+}
+
+int StreamingSession::HandleFrameLoss(int frameNumber, int frameType)
+{
+	int startFrame;
+	int endFrame;
+	switch (m_ReferenceFrameTracker.FrameLost(frameNumber, frameType, &startFrame, &endFrame))
+	{
+	case FrameLossInvalidate:
+		// The host encodes its next frame from one before startFrame, so the decoder
+		// can carry on without an IDR frame
+		connectionDetectedFrameLoss(startFrame, endFrame);
+		return DR_OK;
+	case FrameLossCovered:
+		return DR_OK;
+	default:
+		return DR_NEED_IDR;
+	}
+}
+
+int StreamingSession::HandleQueuedFrame(VideoFrame* frame, void* context)
+{
+	return ((StreamingSession*)context)->RenderFrame(frame);
+}
+
+bool StreamingSession::IsReferenceFrame(const VideoFrame* frame)
+{
+	if (frame->FrameType == FRAME_TYPE_IDR)
+	{
+		return true;
+	}
+
+	// Frames carrying parameter sets are kept whatever their slices say
+	for (int i = 0; i < frame->SegmentCount; i++)
+	{
+		if (frame->Segments[i].BufferType != BUFFER_TYPE_PICDATA)
+		{
+			return true;
+		}
+	}
+
+	IndexFrame(m_ReferenceIndexer, frame);
+	return m_ReferenceIndexer.GetDescriptor().Reference;
+}
+
+int StreamingSession::SubmitQueuedFrame(PDECODE_UNIT decodeUnit)
+{
+	// Copy the decode unit and let the renderer thread pick it up, so a slow
+	// renderer doesn't stall moonlight-common-c's receive path.
+	VideoFrame frame;
+	int ret = AssembleFrame(decodeUnit, &frame);
+	if (ret != DR_OK)
+	{
+		return HandleFrameLoss(decodeUnit->frameNumber, decodeUnit->frameType);
+	}
+
+	// Parameter sets in a frame the queue drops never reach the decoder. Frames
+	// the renderer thread skips never carry any.
+	long long framesDropped = m_VideoDecodeQueue.GetAwaitingIdrFramesDropped();
+	ret = m_VideoDecodeQueue.Submit(&frame, IsReferenceFrame(&frame));
+	if (m_VideoDecodeQueue.GetAwaitingIdrFramesDropped() != framesDropped)
+	{
+		m_ParameterSetCache.Invalidate();
+	}
+	return ret;
+}
+
+int StreamingSession::SubmitPacedFrame(PDECODE_UNIT decodeUnit)
+{
+	VideoFrame frame;
+	int ret = AssembleFrame(decodeUnit, &frame);
+	if (ret != DR_OK)
+	{
+		return HandleFrameLoss(decodeUnit->frameNumber, decodeUnit->frameType);
+	}
+
+	long long framesDropped = m_FramePacer.GetFramesDropped();
+	ret = m_FramePacer.Submit(&frame, IsReferenceFrame(&frame));
+	if (m_FramePacer.GetFramesDropped() != framesDropped)
+	{
+		m_ParameterSetCache.Invalidate();
+	}
+	return ret;
+}
+
+int StreamingSession::SubmitDecodeUnit(PDECODE_UNIT decodeUnit)
+{
+	// receiveTimeMs is on moonlight-common-c's millisecond clock, so translate
+	// it onto ours using how long ago it was.
+	long long reassembledUs = GetTimeMicroseconds();
+	long long receiveAgeUs = (long long)(LiGetMillis() - decodeUnit->receiveTimeMs) * 1000;
+	m_FrameLatencyTracker.BeginFrame(decodeUnit->frameNumber, reassembledUs - receiveAgeUs, reassembledUs);
+	m_StartupProfiler.FrameReceived();
+	m_DecodeUnitsSubmitted++;
+
+	if (m_BitrateController.FrameReceived(decodeUnit->frameNumber, reassembledUs))
+	{
+		BitrateDecisionRecord decision = m_BitrateController.GetLastDecision();
+		Log("Adaptive bitrate: %d -> %d Kbps (%s: %d received, %d lost, %d us jitter, %d us decode)\n",
+			decision.Bitrate,
+			decision.TargetBitrate,
+			decision.Reason,
+			decision.FramesReceived,
+			decision.FramesLost,
+			decision.JitterUs,
+			decision.AverageDecodeTimeUs);
+	}
+
+	// Frames between a loss and the host's reaction to its invalidation can't be
+	// decoded, so they are dropped before anything is copied
+	if (m_ReferenceFrameTracker.ShouldSkipFrame(decodeUnit->frameNumber, decodeUnit->frameType))
+	{
+		return DR_OK;
+	}
+
+	// Chosen the same way as in StartVideo rather than by whether the thread is
+	// running. moonlight-common-c stops the renderer before joining its receive
+	// thread, and frames that race with that must be dropped by the pacer or
+	// queue, not handed to the stopped renderer directly.
+	if (m_Configuration.FramePacing != FramePacingOff)
+	{
+		return SubmitPacedFrame(decodeUnit);
+	}
+
+	if (m_Configuration.VideoDecodeQueueDepth > 0)
+	{
+		return SubmitQueuedFrame(decodeUnit);
+	}
+
+	// Length prefixing needs a copy, so it always goes through the frame buffers
+	if ((m_VideoCapabilities & VIDEO_CAPABILITY_SCATTER_GATHER) && m_NalLengthSize == 0)
+	{
+		return SubmitBufferList(decodeUnit);
+	}
+
+	// The buffer goes back to the pool once the renderer has consumed it.
+	VideoFrame frame;
+	int ret = AssembleFrame(decodeUnit, &frame);
+	if (ret != DR_OK)
+	{
+		return HandleFrameLoss(decodeUnit->frameNumber, decodeUnit->frameType);
+	}
+
+	ret = RenderFrame(&frame);
+	m_FrameBufferPool.Release(frame.Buffer);
+	return ret;
+}
+
+int StreamingSession::InitializeAudio(int audioConfiguration, const POPUS_MULTISTREAM_CONFIGURATION opusConfig)
+{
+	if (m_AudioInitialized)
+	{
+		if (audioConfiguration == m_AudioConfiguration &&
+			opusConfig->sampleRate == m_OpusConfig.sampleRate &&
+			opusConfig->channelCount == m_OpusConfig.channelCount &&
+			opusConfig->streams == m_OpusConfig.streams &&
+			opusConfig->coupledStreams == m_OpusConfig.coupledStreams &&
+			opusConfig->samplesPerFrame == m_OpusConfig.samplesPerFrame &&
+			memcmp(opusConfig->mapping, m_OpusConfig.mapping, sizeof(m_OpusConfig.mapping)) == 0)
+		{
+			// Retained across a reconnect, so just drop the old stream's decoder state
+			m_AudioPipeline.Reset();
+			return 0;
+		}
+
+		ReleaseAudio();
+	}
+
+	AudioPipelineConfiguration pipelineConfiguration;
+	pipelineConfiguration.JitterBufferTargetMs = m_Configuration.AudioJitterBufferTargetMs;
+	pipelineConfiguration.FloatOutput = (m_AudioCapabilities & AUDIO_CAPABILITY_FLOAT_OUTPUT) != 0;
+	pipelineConfiguration.DownmixToStereo = m_Configuration.AudioDownmixToStereo;
+	pipelineConfiguration.DownmixMatrix = m_Configuration.AudioDownmixMatrix.empty() ? NULL : m_Configuration.AudioDownmixMatrix.data();
+	pipelineConfiguration.DownmixMatrixLength = (int)m_Configuration.AudioDownmixMatrix.size();
+	pipelineConfiguration.OutputSampleRate = m_AudioRenderer->GetOutputSampleRate();
+	pipelineConfiguration.MaxFramesPerSubmission = m_AudioRenderer->GetMaxFramesPerSubmission();
+	pipelineConfiguration.AdaptiveBatching = (m_AudioCapabilities & AUDIO_CAPABILITY_ADAPTIVE_BATCHING) != 0;
+
+	// A downmixed stream reaches the renderer as plain stereo
+	int requestedAudioConfiguration = audioConfiguration;
+	if (AudioPipeline::GetOutputChannelCount(opusConfig, pipelineConfiguration) == DOWNMIX_OUTPUT_CHANNELS &&
+		opusConfig->channelCount != DOWNMIX_OUTPUT_CHANNELS)
+	{
+		audioConfiguration = AUDIO_CONFIGURATION_STEREO;
+	}
+
+	int err = m_AudioRenderer->Initialize(audioConfiguration);
+	if (err != 0)
+	{
+		return err;
+	}
+
+	err = m_AudioPipeline.Initialize(opusConfig, pipelineConfiguration);
+	if (err != 0)
+	{
+		m_AudioRenderer->Cleanup();
+		return err;
+	}
+
+	m_AudioInitialized = true;
+	m_AudioConfiguration = requestedAudioConfiguration;
+	m_OpusConfig = *opusConfig;
+	return 0;
+}
+
+void StreamingSession::StartAudio()
+{
+	m_AudioRenderer->Start();
+	m_AudioPipeline.Start();
+}
+
+void StreamingSession::StopAudio()
+{
+	m_AudioPipeline.Stop();
+	m_AudioRenderer->Stop();
+}
+
+void StreamingSession::CleanupAudio()
+{
+	if (!m_RetainResources)
+	{
+		ReleaseAudio();
+	}
+}
+
+void StreamingSession::ReleaseAudio()
+{
+	m_AudioPipeline.Cleanup();
+
+	m_AudioRenderer->Cleanup();
+	m_AudioInitialized = false;
+}
+
+void StreamingSession::DecodeAndPlayAudioSample(char* sampleData, int sampleLength)
+{
+	m_AudioPipeline.DecodeAndPlaySample(sampleData, sampleLength);
+}
+
+void StreamingSession::StageStarting(int stage)
+{
+	m_StartupProfiler.StageStarting(stage);
+	m_ConnectionListener->StageStarting(LiGetStageName(stage));
+}
+
+void StreamingSession::StageComplete(int stage)
+{
+	m_StartupProfiler.StageComplete(stage);
+	m_ConnectionListener->StageComplete(LiGetStageName(stage));
+}
+
+void StreamingSession::StageFailed(int stage, long errorCode)
+{
+	m_StartupProfiler.StageFailed(stage, errorCode);
+	m_ConnectionListener->StageFailed(LiGetStageName(stage), errorCode);
+}
+
+void StreamingSession::ConnectionStarted()
+{
+	m_StartupProfiler.ConnectionStarted();
+	m_ConnectionListener->ConnectionStarted();
+}
+
+void StreamingSession::ConnectionTerminated(long errorCode)
+{
+	m_ConnectionListener->ConnectionTerminated(errorCode);
+}
+
+void StreamingSession::DisplayMessage(const char* message)
+{
+	m_ConnectionListener->DisplayMessage(message);
+}
+
+void StreamingSession::DisplayTransientMessage(const char* message)
+{
+	m_ConnectionListener->DisplayTransientMessage(message);
+}
+
+void StreamingSession::LogMessage(const char* format, va_list args)
+{
+	m_Logger.Log(format, args);
+}
+
+void StreamingSession::Log(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	m_Logger.Log(format, args);
+	va_end(args);
+}
+
+void StreamingSession::FramePresented(int frameNumber)
+{
+	m_FrameLatencyTracker.RecordPoint(frameNumber, FrameTracePresented, GetTimeMicroseconds());
+}
+
+void StreamingSession::NotifyVsync()
+{
+	m_FramePacer.NotifyVsync(GetTimeMicroseconds());
+}
+
+const FrameBufferPool& StreamingSession::GetFrameBufferPool() const
+{
+	return m_FrameBufferPool;
+}
+
+const VideoDecodeQueue& StreamingSession::GetVideoDecodeQueue() const
+{
+	return m_VideoDecodeQueue;
+}
+
+const FramePacer& StreamingSession::GetFramePacer() const
+{
+	return m_FramePacer;
+}
+
+const ReferenceFrameTracker& StreamingSession::GetReferenceFrameTracker() const
+{
+	return m_ReferenceFrameTracker;
+}
+
+const BitrateController& StreamingSession::GetBitrateController() const
+{
+	return m_BitrateController;
+}
+
+const FrameLatencyTracker& StreamingSession::GetFrameLatencyTracker() const
+{
+	return m_FrameLatencyTracker;
+}
+
+const AudioPipeline& StreamingSession::GetAudioPipeline() const
+{
+	return m_AudioPipeline;
+}
+
+const StreamingSessionConfiguration& StreamingSession::GetConfiguration() const
+{
+	return m_Configuration;
+}
+
+const StartupProfiler& StreamingSession::GetStartupProfiler() const
+{
+	return m_StartupProfiler;
+}
+
+const ParameterSetCache& StreamingSession::GetParameterSetCache() const
+{
+	return m_ParameterSetCache;
+}
+
+long long StreamingSession::GetDecodeUnitsSubmitted() const
+{
+	return m_DecodeUnitsSubmitted;
+}
+
+long long StreamingSession::GetVideoBytesCopied() const
+{
+	return m_VideoBytesCopied;
+}
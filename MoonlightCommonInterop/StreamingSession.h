@@ -0,0 +1,220 @@
+#pragma once
+
+#include <stdarg.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Limelight.h"
+#include "AsyncLogger.h"
+#include "AudioPipeline.h"
+#include "BitrateController.h"
+#include "FrameBufferPool.h"
+#include "FramePacer.h"
+#include "FrameLatencyTracker.h"
+#include "NalIndexer.h"
+#include "ParameterSetCache.h"
+#include "ReferenceFrameTracker.h"
+#include "SessionInterfaces.h"
+#include "StartupProfiler.h"
+#include "VideoDecodeQueue.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Capability bits that are consumed by the interop layer rather than moonlight-common-c
+			#define INTEROP_VIDEO_CAPABILITIES_MASK 0x00FF0000
+			#define INTEROP_AUDIO_CAPABILITIES_MASK 0x00FF0000
+
+			// Owns everything that lives for the duration of one streaming connection:
+			// the renderers and listener, the decoders and every buffer handed to them.
+			// The moonlight-common-c callbacks are thin trampolines into the one active
+			// instance of this class. Only one session can be connected at a time, since
+			// every callback but DrSetup and ArInit finds it through the global active session.
+			// This class is plain C++ and takes ownership of the native renderers.
+			class StreamingSession
+			{
+			public:
+				StreamingSession(
+					const StreamingSessionConfiguration& configuration,
+					INativeVideoRenderer* videoRenderer,
+					INativeAudioRenderer* audioRenderer,
+					INativeConnectionListener* connectionListener);
+				~StreamingSession();
+
+				int GetVideoCapabilities() const;
+
+				int GetAudioCapabilities() const;
+
+				// The moonlight-common-c stream configuration used for every connection
+				// made with this session, kept so it can be reconnected.
+				void SetStreamConfiguration(const STREAM_CONFIGURATION& streamConfiguration);
+
+				const STREAM_CONFIGURATION& GetStreamConfiguration() const;
+
+				// While set, moonlight-common-c's cleanup callbacks leave the renderers,
+				// frame pool and Opus decoder initialized, and the setup callbacks of the
+				// next connection reuse them if the stream parameters haven't changed.
+				void SetRetainResources(bool retain);
+
+				// Tears down anything left initialized by SetRetainResources
+				void ReleaseResources();
+
+				// Restarts the startup timeline for a reconnect of this session
+				void BeginReconnect();
+
+				int SetupVideo(int videoFormat, int width, int height, int redrawRate);
+
+				void StartVideo();
+
+				void StopVideo();
+
+				void CleanupVideo();
+
+				int SubmitDecodeUnit(PDECODE_UNIT decodeUnit);
+
+				int InitializeAudio(int audioConfiguration, const POPUS_MULTISTREAM_CONFIGURATION opusConfig);
+
+				void StartAudio();
+
+				void StopAudio();
+
+				void CleanupAudio();
+
+				void DecodeAndPlayAudioSample(char* sampleData, int sampleLength);
+
+				void StageStarting(int stage);
+
+				void StageComplete(int stage);
+
+				void StageFailed(int stage, long errorCode);
+
+				void ConnectionStarted();
+
+				void ConnectionTerminated(long errorCode);
+
+				void DisplayMessage(const char* message);
+
+				void DisplayTransientMessage(const char* message);
+
+				void LogMessage(const char* format, va_list args);
+
+				void FramePresented(int frameNumber);
+
+				void NotifyVsync();
+
+				const FrameBufferPool& GetFrameBufferPool() const;
+
+				const VideoDecodeQueue& GetVideoDecodeQueue() const;
+
+				const FramePacer& GetFramePacer() const;
+
+				const FrameLatencyTracker& GetFrameLatencyTracker() const;
+
+				const AudioPipeline& GetAudioPipeline() const;
+
+				const StreamingSessionConfiguration& GetConfiguration() const;
+
+				const StartupProfiler& GetStartupProfiler() const;
+
+				const ParameterSetCache& GetParameterSetCache() const;
+
+				const ReferenceFrameTracker& GetReferenceFrameTracker() const;
+
+				const BitrateController& GetBitrateController() const;
+
+				long long GetDecodeUnitsSubmitted() const;
+
+				long long GetVideoBytesCopied() const;
+
+			private:
+				StreamingSession(const StreamingSession&) = delete;
+				StreamingSession& operator=(const StreamingSession&) = delete;
+
+				static int HandleQueuedFrame(VideoFrame* frame, void* context);
+
+				// Logs from the interop layer itself, through the same path as moonlight-common-c
+				void Log(const char* format, ...);
+
+				void InitializeReferenceFrameTracker(int videoFormat);
+
+				// Called when a frame never reached the decoder or failed to decode.
+				// Returns DR_OK if reference frame invalidation covers it, else DR_NEED_IDR.
+				int HandleFrameLoss(int frameNumber, int frameType);
+
+				bool IsRedundantParameterSet(PLENTRY entry);
+
+				int SubmitBufferList(PDECODE_UNIT decodeUnit);
+
+				int AssembleFrame(PDECODE_UNIT decodeUnit, VideoFrame* frame);
+
+				// Returns a partly assembled frame's buffer and asks for an IDR frame
+				int DiscardFrame(VideoFrame* frame);
+
+				int RenderFrameSegments(VideoFrame* frame);
+
+				void IndexFrame(NalIndexer& indexer, const VideoFrame* frame);
+
+				int RenderFrame(VideoFrame* frame);
+
+				// Whether a later frame may depend on this one, so it mustn't be dropped
+				bool IsReferenceFrame(const VideoFrame* frame);
+
+				int SubmitQueuedFrame(PDECODE_UNIT decodeUnit);
+
+				int SubmitPacedFrame(PDECODE_UNIT decodeUnit);
+
+				void ReleaseVideo();
+
+				void ReleaseAudio();
+
+				StreamingSessionConfiguration m_Configuration;
+				STREAM_CONFIGURATION m_StreamConfiguration;
+				std::unique_ptr<INativeVideoRenderer> m_VideoRenderer;
+				std::unique_ptr<INativeAudioRenderer> m_AudioRenderer;
+				std::unique_ptr<INativeConnectionListener> m_ConnectionListener;
+
+				int m_VideoCapabilities;
+				int m_AudioCapabilities;
+
+				// Bytes in each NAL unit length prefix, or 0 to deliver Annex B start codes
+				int m_NalLengthSize;
+
+				bool m_RetainResources;
+
+				// Parameters the renderers were last initialized with, for reuse on reconnect
+				bool m_VideoInitialized;
+				int m_VideoFormat;
+				int m_VideoWidth;
+				int m_VideoHeight;
+				int m_VideoRedrawRate;
+				bool m_AudioInitialized;
+				int m_AudioConfiguration;
+				OPUS_MULTISTREAM_CONFIGURATION m_OpusConfig;
+
+				FrameBufferPool m_FrameBufferPool;
+				VideoDecodeQueue m_VideoDecodeQueue;
+				FramePacer m_FramePacer;
+				FrameLatencyTracker m_FrameLatencyTracker;
+				StartupProfiler m_StartupProfiler;
+				ParameterSetCache m_ParameterSetCache;
+				ReferenceFrameTracker m_ReferenceFrameTracker;
+				BitrateController m_BitrateController;
+				NalIndexer m_NalIndexer;
+
+				// Finds the non-reference frames the pacer and decode queue may drop,
+				// on the receive thread
+				NalIndexer m_ReferenceIndexer;
+				std::vector<NativeBufferView> m_BufferViews;
+				std::atomic<long long> m_DecodeUnitsSubmitted;
+				std::atomic<long long> m_VideoBytesCopied;
+
+				AudioPipeline m_AudioPipeline;
+
+				AsyncLogger m_Logger;
+			};
+		}
+	}
+}
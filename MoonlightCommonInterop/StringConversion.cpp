@@ -0,0 +1,169 @@
+#include "StringConversion.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+// Decodes one code point and advances past it. Overlong forms, surrogates and
+// values past U+10FFFF are rejected, consuming only the leading byte.
+static unsigned int DecodeUtf8(const unsigned char*& input, const unsigned char* end)
+{
+	unsigned int lead = *input++;
+	if (lead < 0x80)
+	{
+		return lead;
+	}
+
+	int continuationBytes;
+	unsigned int codePoint;
+	unsigned int minimum;
+	if ((lead & 0xE0) == 0xC0)
+	{
+		continuationBytes = 1;
+		codePoint = lead & 0x1F;
+		minimum = 0x80;
+	}
+	else if ((lead & 0xF0) == 0xE0)
+	{
+		continuationBytes = 2;
+		codePoint = lead & 0x0F;
+		minimum = 0x800;
+	}
+	else if ((lead & 0xF8) == 0xF0)
+	{
+		continuationBytes = 3;
+		codePoint = lead & 0x07;
+		minimum = 0x10000;
+	}
+	else
+	{
+		return REPLACEMENT_CHARACTER;
+	}
+
+	if (end - input < continuationBytes)
+	{
+		return REPLACEMENT_CHARACTER;
+	}
+
+	for (int i = 0; i < continuationBytes; i++)
+	{
+		if ((input[i] & 0xC0) != 0x80)
+		{
+			return REPLACEMENT_CHARACTER;
+		}
+		codePoint = (codePoint << 6) | (input[i] & 0x3F);
+	}
+
+	if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+	{
+		return REPLACEMENT_CHARACTER;
+	}
+
+	input += continuationBytes;
+	return codePoint;
+}
+
+int Moonlight::Xbox::Interop::ConvertUtf8ToUtf16(const char* input, int inputLength, char16_t* output, int outputCapacity)
+{
+	const unsigned char* current = (const unsigned char*)input;
+	const unsigned char* end = current + inputLength;
+	int length = 0;
+
+	while (current < end)
+	{
+		// Most of what moonlight-common-c logs is ASCII, so take the short way for it
+		if (*current < 0x80)
+		{
+			if (length < outputCapacity)
+			{
+				output[length] = (char16_t)*current;
+			}
+			length++;
+			current++;
+			continue;
+		}
+
+		unsigned int codePoint = DecodeUtf8(current, end);
+		if (codePoint >= 0x10000)
+		{
+			codePoint -= 0x10000;
+			if (length + 1 < outputCapacity)
+			{
+				output[length] = (char16_t)(0xD800 + (codePoint >> 10));
+				output[length + 1] = (char16_t)(0xDC00 + (codePoint & 0x3FF));
+			}
+			length += 2;
+		}
+		else
+		{
+			if (length < outputCapacity)
+			{
+				output[length] = (char16_t)codePoint;
+			}
+			length++;
+		}
+	}
+
+	return length;
+}
+
+int Moonlight::Xbox::Interop::ConvertUtf16ToUtf8(const char16_t* input, int inputLength, char* output, int outputCapacity)
+{
+	int length = 0;
+
+	for (int i = 0; i < inputLength; i++)
+	{
+		unsigned int codePoint = input[i];
+		if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < inputLength &&
+			input[i + 1] >= 0xDC00 && input[i + 1] <= 0xDFFF)
+		{
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (input[i + 1] - 0xDC00);
+			i++;
+		}
+		else if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+		{
+			// Unpaired surrogate
+			codePoint = REPLACEMENT_CHARACTER;
+		}
+
+		unsigned char encoded[4];
+		int encodedLength;
+		if (codePoint < 0x80)
+		{
+			encoded[0] = (unsigned char)codePoint;
+			encodedLength = 1;
+		}
+		else if (codePoint < 0x800)
+		{
+			encoded[0] = (unsigned char)(0xC0 | (codePoint >> 6));
+			encoded[1] = (unsigned char)(0x80 | (codePoint & 0x3F));
+			encodedLength = 2;
+		}
+		else if (codePoint < 0x10000)
+		{
+			encoded[0] = (unsigned char)(0xE0 | (codePoint >> 12));
+			encoded[1] = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+			encoded[2] = (unsigned char)(0x80 | (codePoint & 0x3F));
+			encodedLength = 3;
+		}
+		else
+		{
+			encoded[0] = (unsigned char)(0xF0 | (codePoint >> 18));
+			encoded[1] = (unsigned char)(0x80 | ((codePoint >> 12) & 0x3F));
+			encoded[2] = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+			encoded[3] = (unsigned char)(0x80 | (codePoint & 0x3F));
+			encodedLength = 4;
+		}
+
+		if (length + encodedLength <= outputCapacity)
+		{
+			for (int j = 0; j < encodedLength; j++)
+			{
+				output[length + j] = (char)encoded[j];
+			}
+		}
+		length += encodedLength;
+	}
+
+	return length;
+}
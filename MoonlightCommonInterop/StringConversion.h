@@ -0,0 +1,19 @@
+#pragma once
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// UTF-8 <-> UTF-16 transcoding that doesn't allocate. Both functions write
+			// as much as fits in the output and return the number of code units the
+			// whole conversion needs, so callers can try a stack buffer first and only
+			// go to the heap when it comes back too small. Malformed input is replaced
+			// with U+FFFD rather than failing. Neither function null terminates.
+			int ConvertUtf8ToUtf16(const char* input, int inputLength, char16_t* output, int outputCapacity);
+
+			int ConvertUtf16ToUtf8(const char16_t* input, int inputLength, char* output, int outputCapacity);
+		}
+	}
+}
@@ -0,0 +1,343 @@
+#include "Limelight.h"
+#include "Clock.h"
+#include "VideoDecodeQueue.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+static bool HasParameterSets(const VideoFrame* frame)
+{
+	for (int i = 0; i < frame->SegmentCount; i++)
+	{
+		if (frame->Segments[i].BufferType != BUFFER_TYPE_PICDATA)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+VideoDecodeQueue::VideoDecodeQueue()
+	: m_Depth(0),
+	m_Head(0),
+	m_Tail(0),
+	m_IdrEnd(0),
+	m_FrameBufferPool(NULL),
+	m_Handler(NULL),
+	m_Context(NULL),
+	m_Stopping(true),
+	m_ConsumerWaiting(false),
+	m_Submitting(false),
+	m_WaitingForIdr(false),
+	m_RendererFailed(false),
+	m_PeakOccupancy(0),
+	m_FramesSubmitted(0),
+	m_FramesDropped(0),
+	m_Overflows(0),
+	m_NonReferenceFramesDropped(0),
+	m_SupersededFramesDropped(0),
+	m_AwaitingIdrFramesDropped(0),
+	m_IdrRequests(0),
+	m_FramesHandled(0),
+	m_TotalWaitTimeUs(0),
+	m_MaxWaitTimeUs(0)
+{
+}
+
+VideoDecodeQueue::~VideoDecodeQueue()
+{
+	Stop();
+}
+
+bool VideoDecodeQueue::Start(int depth, FrameBufferPool* frameBufferPool, VideoFrameHandler handler, void* context)
+{
+	Stop();
+
+	if (depth <= 0)
+	{
+		return false;
+	}
+
+	m_Frames.resize(depth);
+	m_Depth = depth;
+	m_Head = 0;
+	m_Tail = 0;
+	m_IdrEnd = 0;
+	m_FrameBufferPool = frameBufferPool;
+	m_Handler = handler;
+	m_Context = context;
+	m_ConsumerWaiting = false;
+	m_WaitingForIdr = false;
+	m_RendererFailed = false;
+	m_PeakOccupancy = 0;
+	m_FramesSubmitted = 0;
+	m_FramesDropped = 0;
+	m_Overflows = 0;
+	m_NonReferenceFramesDropped = 0;
+	m_SupersededFramesDropped = 0;
+	m_AwaitingIdrFramesDropped = 0;
+	m_IdrRequests = 0;
+	m_FramesHandled = 0;
+	m_TotalWaitTimeUs = 0;
+	m_MaxWaitTimeUs = 0;
+
+	m_Stopping = false;
+	m_Thread = std::thread(&VideoDecodeQueue::ThreadProc, this);
+	return true;
+}
+
+void VideoDecodeQueue::Stop()
+{
+	if (!m_Thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_WaitLock);
+		m_Stopping = true;
+	}
+	m_WaitCondition.notify_one();
+	m_Thread.join();
+
+	// A Submit that saw m_Stopping clear may still be publishing its frame.
+	// Any later one sees it set and drops its frame itself.
+	while (m_Submitting)
+	{
+		std::this_thread::yield();
+	}
+
+	// Return anything the renderer never got to back to the pool
+	while (m_Head != m_Tail)
+	{
+		m_FrameBufferPool->Release(m_Frames[m_Head % m_Depth].Frame.Buffer);
+		m_Head++;
+	}
+}
+
+void VideoDecodeQueue::DropFrame(const VideoFrame* frame, std::atomic<long long>& reasonCounter)
+{
+	m_FrameBufferPool->Release(frame->Buffer);
+	m_FramesDropped++;
+	reasonCounter++;
+}
+
+int VideoDecodeQueue::Submit(const VideoFrame* frame, bool reference)
+{
+	// Both flags are seq_cst, so either Stop sees this submission in progress or
+	// this call sees Stop's flag. The frame is never published after the drain.
+	m_Submitting = true;
+	int ret = DR_OK;
+	if (m_Stopping)
+	{
+		// The stream is ending, so there is nothing to request an IDR frame for
+		m_FrameBufferPool->Release(frame->Buffer);
+	}
+	else
+	{
+		ret = Enqueue(frame, reference);
+	}
+	m_Submitting = false;
+
+	return ret;
+}
+
+int VideoDecodeQueue::Enqueue(const VideoFrame* frame, bool reference)
+{
+	m_FramesSubmitted++;
+
+	bool idr = frame->FrameType == FRAME_TYPE_IDR;
+
+	// One IDR request covers every failure until the IDR frame arrives
+	if (m_RendererFailed.exchange(false) && !idr && !m_WaitingForIdr)
+	{
+		// The decoder state is no longer trustworthy, so resync on the next IDR frame
+		m_WaitingForIdr = true;
+		m_IdrRequests++;
+		DropFrame(frame, m_AwaitingIdrFramesDropped);
+		return DR_NEED_IDR;
+	}
+
+	if (m_WaitingForIdr)
+	{
+		if (!idr)
+		{
+			DropFrame(frame, m_AwaitingIdrFramesDropped);
+			return DR_OK;
+		}
+
+		m_WaitingForIdr = false;
+	}
+
+	unsigned long long tail = m_Tail.load(std::memory_order_relaxed);
+	int occupancy = (int)(tail - m_Head.load(std::memory_order_acquire));
+	if (occupancy >= m_Depth)
+	{
+		if (!reference)
+		{
+			// Nothing depends on this frame, so losing it costs just this frame
+			DropFrame(frame, m_NonReferenceFramesDropped);
+			return DR_OK;
+		}
+
+		// The renderer has fallen behind. Frames already queued are still decodable,
+		// but everything after them is dropped until the host sends a new IDR frame.
+		m_Overflows++;
+		m_WaitingForIdr = true;
+		m_IdrRequests++;
+		DropFrame(frame, m_AwaitingIdrFramesDropped);
+		return DR_NEED_IDR;
+	}
+
+	QueuedFrame* slot = &m_Frames[tail % m_Depth];
+	slot->Frame = *frame;
+	slot->Frame.EnqueueTimeUs = GetTimeMicroseconds();
+	slot->Reference = reference;
+	if (idr)
+	{
+		m_IdrEnd.store(tail + 1, std::memory_order_relaxed);
+	}
+	m_Tail.store(tail + 1, std::memory_order_release);
+
+	occupancy++;
+	if (occupancy > m_PeakOccupancy)
+	{
+		m_PeakOccupancy = occupancy;
+	}
+
+	// Without a full fence the flag could be read before the new tail is visible,
+	// missing a consumer that checked for frames just before going to sleep.
+	// WaitForFrame pairs with this by setting the flag before reading the tail.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_ConsumerWaiting.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> lock(m_WaitLock);
+		m_WaitCondition.notify_one();
+	}
+
+	return DR_OK;
+}
+
+void VideoDecodeQueue::WaitForFrame()
+{
+	std::unique_lock<std::mutex> lock(m_WaitLock);
+	m_ConsumerWaiting.store(true, std::memory_order_seq_cst);
+	m_WaitCondition.wait(
+		lock,
+		[this] { return m_Stopping || m_Head.load(std::memory_order_relaxed) != m_Tail.load(std::memory_order_seq_cst); });
+	m_ConsumerWaiting = false;
+}
+
+void VideoDecodeQueue::ThreadProc()
+{
+	while (!m_Stopping)
+	{
+		unsigned long long head = m_Head.load(std::memory_order_relaxed);
+		unsigned long long tail = m_Tail.load(std::memory_order_acquire);
+		if (head == tail)
+		{
+			WaitForFrame();
+			continue;
+		}
+
+		// Copy the frame out so the slot can be reused while the renderer works on it
+		QueuedFrame queuedFrame = m_Frames[head % m_Depth];
+		VideoFrame& frame = queuedFrame.Frame;
+		m_Head.store(head + 1, std::memory_order_release);
+
+		// The decoder starts over at a queued IDR frame, so nothing ahead of it is
+		// needed. Parameter sets are kept since later frames may have had them suppressed.
+		if (m_IdrEnd.load(std::memory_order_relaxed) > head + 1 && !HasParameterSets(&frame))
+		{
+			DropFrame(&frame, m_SupersededFramesDropped);
+			continue;
+		}
+
+		if (!queuedFrame.Reference && head + 1 != tail)
+		{
+			DropFrame(&frame, m_NonReferenceFramesDropped);
+			continue;
+		}
+
+		long long waitTimeUs = GetTimeMicroseconds() - frame.EnqueueTimeUs;
+		m_TotalWaitTimeUs += waitTimeUs;
+		if (waitTimeUs > m_MaxWaitTimeUs)
+		{
+			m_MaxWaitTimeUs = waitTimeUs;
+		}
+		m_FramesHandled++;
+
+		if (m_Handler(&frame, m_Context) != DR_OK)
+		{
+			m_RendererFailed = true;
+		}
+
+		m_FrameBufferPool->Release(frame.Buffer);
+	}
+}
+
+int VideoDecodeQueue::GetDepth() const
+{
+	return m_Depth;
+}
+
+int VideoDecodeQueue::GetOccupancy() const
+{
+	return (int)(m_Tail.load() - m_Head.load());
+}
+
+int VideoDecodeQueue::GetPeakOccupancy() const
+{
+	return m_PeakOccupancy;
+}
+
+long long VideoDecodeQueue::GetFramesSubmitted() const
+{
+	return m_FramesSubmitted;
+}
+
+long long VideoDecodeQueue::GetFramesDropped() const
+{
+	return m_FramesDropped;
+}
+
+long long VideoDecodeQueue::GetOverflowCount() const
+{
+	return m_Overflows;
+}
+
+long long VideoDecodeQueue::GetNonReferenceFramesDropped() const
+{
+	return m_NonReferenceFramesDropped;
+}
+
+long long VideoDecodeQueue::GetSupersededFramesDropped() const
+{
+	return m_SupersededFramesDropped;
+}
+
+long long VideoDecodeQueue::GetAwaitingIdrFramesDropped() const
+{
+	return m_AwaitingIdrFramesDropped;
+}
+
+long long VideoDecodeQueue::GetIdrRequests() const
+{
+	return m_IdrRequests;
+}
+
+long long VideoDecodeQueue::GetAverageWaitTimeUs() const
+{
+	long long framesHandled = m_FramesHandled;
+	if (framesHandled == 0)
+	{
+		return 0;
+	}
+
+	return m_TotalWaitTimeUs / framesHandled;
+}
+
+long long VideoDecodeQueue::GetMaxWaitTimeUs() const
+{
+	return m_MaxWaitTimeUs;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameBufferPool.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			#define MAX_VIDEO_FRAME_SEGMENTS 8
+
+			// A contiguous run of one buffer type within a VideoFrame's buffer
+			struct VideoFrameSegment
+			{
+				int Offset;
+				int Length;
+				int BufferType;
+			};
+
+			// A decode unit that has been copied out of moonlight-common-c's buffer list
+			// so that it can outlive the submitDecodeUnit callback.
+			struct VideoFrame
+			{
+				FrameBuffer* Buffer;
+				int SegmentCount;
+				VideoFrameSegment Segments[MAX_VIDEO_FRAME_SEGMENTS];
+				int FrameType;
+				int FrameNumber;
+				unsigned long long ReceiveTimeMs;
+				long long EnqueueTimeUs;
+			};
+
+			typedef int (*VideoFrameHandler)(VideoFrame* frame, void* context);
+
+			// Bounded single-producer/single-consumer queue between the moonlight-common-c
+			// decode unit callback and a dedicated renderer thread. The producer never blocks.
+			//
+			// When the renderer falls behind, the newest frame wins. A non-reference frame
+			// with a newer frame already queued behind it is dropped rather than rendered,
+			// and so is any frame queued ahead of an IDR frame. Only when the queue is full
+			// and the incoming frame is a reference frame is the reference chain broken:
+			// frames are then dropped until the next IDR frame and the producer is told,
+			// once, to request one from the host.
+			//
+			// GFE encodes every P-frame as a reference frame, so for its streams the
+			// non-reference stage never fires and each overflow costs one IDR request.
+			// Latency stays bounded because the frames that IDR frame supersedes are
+			// skipped rather than rendered.
+			class VideoDecodeQueue
+			{
+			public:
+				VideoDecodeQueue();
+				~VideoDecodeQueue();
+
+				bool Start(int depth, FrameBufferPool* frameBufferPool, VideoFrameHandler handler, void* context);
+
+				void Stop();
+
+				// Called on the producer thread. Takes ownership of the frame's buffer and
+				// returns DR_OK or DR_NEED_IDR. reference is false if no later frame
+				// depends on this one, so it can be dropped without breaking decoding.
+				// Frames submitted while the queue isn't running are dropped, since
+				// moonlight-common-c stops the renderer before it joins its own threads.
+				int Submit(const VideoFrame* frame, bool reference);
+
+				int GetDepth() const;
+
+				int GetOccupancy() const;
+
+				int GetPeakOccupancy() const;
+
+				long long GetFramesSubmitted() const;
+
+				long long GetFramesDropped() const;
+
+				// Overflows that had to drop a reference frame, each resolved by one IDR request
+				long long GetOverflowCount() const;
+
+				// Non-reference frames dropped because a newer frame was waiting
+				long long GetNonReferenceFramesDropped() const;
+
+				// Frames dropped because an IDR frame was queued behind them
+				long long GetSupersededFramesDropped() const;
+
+				// Frames dropped after an overflow or renderer failure broke the
+				// reference chain. Only these are dropped by Submit itself.
+				long long GetAwaitingIdrFramesDropped() const;
+
+				long long GetIdrRequests() const;
+
+				long long GetAverageWaitTimeUs() const;
+
+				long long GetMaxWaitTimeUs() const;
+
+			private:
+				VideoDecodeQueue(const VideoDecodeQueue&) = delete;
+				VideoDecodeQueue& operator=(const VideoDecodeQueue&) = delete;
+
+				struct QueuedFrame
+				{
+					VideoFrame Frame;
+					bool Reference;
+				};
+
+				void ThreadProc();
+
+				void WaitForFrame();
+
+				int Enqueue(const VideoFrame* frame, bool reference);
+
+				void DropFrame(const VideoFrame* frame, std::atomic<long long>& reasonCounter);
+
+				std::vector<QueuedFrame> m_Frames;
+				int m_Depth;
+				std::atomic<unsigned long long> m_Head;
+				std::atomic<unsigned long long> m_Tail;
+
+				// One past the position of the newest IDR frame queued, or 0
+				std::atomic<unsigned long long> m_IdrEnd;
+
+				FrameBufferPool* m_FrameBufferPool;
+				VideoFrameHandler m_Handler;
+				void* m_Context;
+
+				std::thread m_Thread;
+				std::atomic<bool> m_Stopping;
+				std::atomic<bool> m_ConsumerWaiting;
+
+				// Set by the producer for the duration of Submit, so Stop can wait out
+				// a frame that was being queued as it stopped
+				std::atomic<bool> m_Submitting;
+				std::mutex m_WaitLock;
+				std::condition_variable m_WaitCondition;
+
+				// Only touched by the producer
+				bool m_WaitingForIdr;
+
+				// Set by the consumer when the renderer fails, picked up by the producer
+				std::atomic<bool> m_RendererFailed;
+
+				std::atomic<int> m_PeakOccupancy;
+				std::atomic<long long> m_FramesSubmitted;
+				std::atomic<long long> m_FramesDropped;
+				std::atomic<long long> m_Overflows;
+				std::atomic<long long> m_NonReferenceFramesDropped;
+				std::atomic<long long> m_SupersededFramesDropped;
+				std::atomic<long long> m_AwaitingIdrFramesDropped;
+				std::atomic<long long> m_IdrRequests;
+				std::atomic<long long> m_FramesHandled;
+				std::atomic<long long> m_TotalWaitTimeUs;
+				std::atomic<long long> m_MaxWaitTimeUs;
+			};
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "FramePacingPolicy.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			using namespace Platform;
+
+			public ref class VideoStatistics sealed
+			{
+			public:
+				property __int64 DecodeUnitsSubmitted;
+
+				property __int64 BytesCopied;
+
+				property int FrameBufferSize;
+
+				property __int64 FrameBufferPoolHits;
+
+				property __int64 FrameBufferPoolMisses;
+
+				property int DecodeQueueDepth;
+
+				property int DecodeQueueOccupancy;
+
+				property int DecodeQueuePeakOccupancy;
+
+				property __int64 DecodeQueueFramesSubmitted;
+
+				property __int64 DecodeQueueFramesDropped;
+
+				// Overflows that had to drop a reference frame and request an IDR frame.
+				// Overflows absorbed by dropping a non-reference frame aren't counted, and
+				// for GFE streams there are none, since every P-frame is a reference frame.
+				property __int64 DecodeQueueOverflows;
+
+				// DecodeQueueFramesDropped broken down by reason
+				property __int64 DecodeQueueNonReferenceFramesDropped;
+
+				property __int64 DecodeQueueSupersededFramesDropped;
+
+				property __int64 DecodeQueueAwaitingIdrFramesDropped;
+
+				property __int64 DecodeQueueIdrRequests;
+
+				property __int64 DecodeQueueAverageWaitTimeUs;
+
+				property __int64 DecodeQueueMaxWaitTimeUs;
+
+				// Only counted when the renderer sets SuppressRepeatedParameterSets
+				property __int64 ParameterSetsForwarded;
+
+				property __int64 ParameterSetsSuppressed;
+
+				// In Kbps. TargetBitrate differs from Bitrate until AdjustBitrate applies it.
+				property int Bitrate;
+
+				property int TargetBitrate;
+
+				property __int64 BitrateIncreases;
+
+				property __int64 BitrateDecreases;
+
+				// Frames that never reached the decoder or failed to decode
+				property __int64 FramesLost;
+
+				// Only made when the renderer sets ReferenceFrameInvalidationAvc or
+				// ReferenceFrameInvalidationHevc for the stream's codec
+				property __int64 ReferenceFrameInvalidations;
+
+				property __int64 FrameLossIdrRequests;
+
+				// Frames dropped after an invalidation because they reference a lost frame
+				property __int64 InvalidatedFramesSkipped;
+
+				property FramePacingPolicy FramePacing;
+
+				property __int64 PacedFramesDisplayed;
+
+				property __int64 PacedFramesDropped;
+
+				// Frame intervals that came around with no frame ready to display
+				property __int64 PacedFramesLate;
+
+				// Measured from NotifyVsync, or derived from ClientRefreshRateX100
+				property int VsyncPeriodUs;
+			};
+		}
+	}
+}
@@ -0,0 +1,167 @@
+#include "WinRtRendererAdapters.h"
+
+using namespace Platform;
+using namespace Moonlight::Xbox::Interop;
+
+static_assert(
+	sizeof(NativeBufferView) == sizeof(BufferView),
+	"NativeBufferView must match the layout of the WinRT BufferView");
+
+static_assert(
+	sizeof(NativeNalUnit) == sizeof(NalUnitDescriptor),
+	"NativeNalUnit must match the layout of the WinRT NalUnitDescriptor");
+
+WinRtVideoRenderer::WinRtVideoRenderer(IVideoRenderer^ renderer)
+	: m_Renderer(renderer)
+{
+}
+
+int WinRtVideoRenderer::GetCapabilities()
+{
+	return m_Renderer->Capabilities;
+}
+
+int WinRtVideoRenderer::Initialize(int videoFormat, int width, int height, int redrawRate)
+{
+	return m_Renderer->Initialize(videoFormat, width, height, redrawRate);
+}
+
+void WinRtVideoRenderer::Start()
+{
+	m_Renderer->Start();
+}
+
+void WinRtVideoRenderer::Stop()
+{
+	m_Renderer->Stop();
+}
+
+void WinRtVideoRenderer::Cleanup()
+{
+	m_Renderer->Cleanup();
+}
+
+int WinRtVideoRenderer::HandleFrame(const char* frameData, int length, int frameType, int frameNumber, long long receiveTimeMs)
+{
+	return
+		m_Renderer->HandleFrame(
+			ArrayReference<unsigned char>((unsigned char*)frameData, length),
+			frameType,
+			frameNumber,
+			receiveTimeMs);
+}
+
+int WinRtVideoRenderer::HandleFrameBufferList(const NativeBufferView* buffers, int count, int frameType, int frameNumber, long long receiveTimeMs)
+{
+	return
+		m_Renderer->HandleFrameBufferList(
+			ArrayReference<BufferView>((BufferView*)buffers, count),
+			frameType,
+			frameNumber,
+			receiveTimeMs);
+}
+
+void WinRtVideoRenderer::HandleFrameDescriptor(const NativeFrameDescriptor& descriptor)
+{
+	FrameDescriptor frameDescriptor;
+	frameDescriptor.FrameNumber = descriptor.FrameNumber;
+	frameDescriptor.FrameType = descriptor.FrameType;
+	frameDescriptor.Idr = descriptor.Idr;
+	frameDescriptor.Reference = descriptor.Reference;
+	frameDescriptor.HdrMetadata = descriptor.HdrMetadata;
+	frameDescriptor.SliceTypes = (FrameSliceTypes)descriptor.SliceTypes;
+
+	m_Renderer->HandleFrameDescriptor(
+		frameDescriptor,
+		ArrayReference<NalUnitDescriptor>((NalUnitDescriptor*)descriptor.NalUnits, descriptor.NalUnitCount));
+}
+
+WinRtAudioRenderer::WinRtAudioRenderer(IAudioRenderer^ renderer)
+	: m_Renderer(renderer)
+{
+}
+
+int WinRtAudioRenderer::GetCapabilities()
+{
+	return m_Renderer->Capabilities;
+}
+
+int WinRtAudioRenderer::GetOutputSampleRate()
+{
+	return m_Renderer->OutputSampleRate;
+}
+
+int WinRtAudioRenderer::GetMaxFramesPerSubmission()
+{
+	return m_Renderer->MaxFramesPerSubmission;
+}
+
+int WinRtAudioRenderer::Initialize(int audioFormat)
+{
+	return m_Renderer->Initialize(audioFormat);
+}
+
+void WinRtAudioRenderer::Start()
+{
+	m_Renderer->Start();
+}
+
+void WinRtAudioRenderer::Stop()
+{
+	m_Renderer->Stop();
+}
+
+void WinRtAudioRenderer::Cleanup()
+{
+	m_Renderer->Cleanup();
+}
+
+void WinRtAudioRenderer::HandleFrame(const char* frameData, int length)
+{
+	m_Renderer->HandleFrame(ArrayReference<unsigned char>((unsigned char*)frameData, length));
+}
+
+WinRtConnectionListener::WinRtConnectionListener(IConnectionListener^ listener)
+	: m_Listener(listener)
+{
+}
+
+void WinRtConnectionListener::StageStarting(const char* stage)
+{
+	m_Listener->StageStarting(m_StageNames.Get(stage));
+}
+
+void WinRtConnectionListener::StageComplete(const char* stage)
+{
+	m_Listener->StageComplete(m_StageNames.Get(stage));
+}
+
+void WinRtConnectionListener::StageFailed(const char* stage, long errorCode)
+{
+	m_Listener->StageFailed(m_StageNames.Get(stage), errorCode);
+}
+
+void WinRtConnectionListener::ConnectionStarted()
+{
+	m_Listener->ConnectionStarted();
+}
+
+void WinRtConnectionListener::ConnectionTerminated(long errorCode)
+{
+	m_Listener->ConnectionTerminated(errorCode);
+}
+
+void WinRtConnectionListener::DisplayMessage(const char* message)
+{
+	m_Listener->DisplayMessage(Utf8ToPlatformString(message));
+}
+
+void WinRtConnectionListener::DisplayTransientMessage(const char* message)
+{
+	m_Listener->DisplayTransientMessage(Utf8ToPlatformString(message));
+}
+
+void WinRtConnectionListener::LogMessage(const char* message)
+{
+	m_Listener->LogMessage(Utf8ToPlatformString(message));
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "PlatformStringMarshaling.h"
+#include "SessionInterfaces.h"
+#include "IVideoRenderer.h"
+#include "IAudioRenderer.h"
+#include "IConnectionListener.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Forward the streaming core's native callbacks to the WinRT renderers and
+			// listener supplied by the app.
+
+			class WinRtVideoRenderer : public INativeVideoRenderer
+			{
+			public:
+				WinRtVideoRenderer(IVideoRenderer^ renderer);
+
+				virtual int GetCapabilities() override;
+
+				virtual int Initialize(int videoFormat, int width, int height, int redrawRate) override;
+
+				virtual void Start() override;
+
+				virtual void Stop() override;
+
+				virtual void Cleanup() override;
+
+				virtual int HandleFrame(const char* frameData, int length, int frameType, int frameNumber, long long receiveTimeMs) override;
+
+				virtual int HandleFrameBufferList(const NativeBufferView* buffers, int count, int frameType, int frameNumber, long long receiveTimeMs) override;
+
+				virtual void HandleFrameDescriptor(const NativeFrameDescriptor& descriptor) override;
+
+			private:
+				IVideoRenderer^ m_Renderer;
+			};
+
+			class WinRtAudioRenderer : public INativeAudioRenderer
+			{
+			public:
+				WinRtAudioRenderer(IAudioRenderer^ renderer);
+
+				virtual int GetCapabilities() override;
+
+				virtual int GetOutputSampleRate() override;
+
+				virtual int GetMaxFramesPerSubmission() override;
+
+				virtual int Initialize(int audioFormat) override;
+
+				virtual void Start() override;
+
+				virtual void Stop() override;
+
+				virtual void Cleanup() override;
+
+				virtual void HandleFrame(const char* frameData, int length) override;
+
+			private:
+				IAudioRenderer^ m_Renderer;
+			};
+
+			class WinRtConnectionListener : public INativeConnectionListener
+			{
+			public:
+				WinRtConnectionListener(IConnectionListener^ listener);
+
+				virtual void StageStarting(const char* stage) override;
+
+				virtual void StageComplete(const char* stage) override;
+
+				virtual void StageFailed(const char* stage, long errorCode) override;
+
+				virtual void ConnectionStarted() override;
+
+				virtual void ConnectionTerminated(long errorCode) override;
+
+				virtual void DisplayMessage(const char* message) override;
+
+				virtual void DisplayTransientMessage(const char* message) override;
+
+				virtual void LogMessage(const char* message) override;
+
+			private:
+				IConnectionListener^ m_Listener;
+
+				// Stage names come from LiGetStageName and live as long as the process
+				InternedPlatformStrings m_StageNames;
+			};
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "BenchmarkHarness.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Replaces the global operator new for the benchmark executables. With
+// INTEROP_BENCH_WRAP_MALLOC the build also links with --wrap for malloc, calloc and
+// realloc, which reroutes those calls from every object in the executable (but not
+// from shared libraries) through the __wrap_ functions below.
+
+static std::atomic<long long> s_Allocations(0);
+static std::atomic<long long> s_AllocatedBytes(0);
+
+#if defined(INTEROP_BENCH_WRAP_MALLOC)
+
+extern "C" void* __real_malloc(size_t size);
+extern "C" void* __real_calloc(size_t count, size_t size);
+extern "C" void* __real_realloc(void* pointer, size_t size);
+
+#define REAL_MALLOC __real_malloc
+
+#else
+
+#define REAL_MALLOC malloc
+
+#endif
+
+static void CountAllocation(size_t size)
+{
+	s_Allocations.fetch_add(1, std::memory_order_relaxed);
+	s_AllocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+}
+
+#if defined(INTEROP_BENCH_WRAP_MALLOC)
+
+extern "C" void* __wrap_malloc(size_t size)
+{
+	CountAllocation(size);
+	return __real_malloc(size);
+}
+
+extern "C" void* __wrap_calloc(size_t count, size_t size)
+{
+	CountAllocation(count * size);
+	return __real_calloc(count, size);
+}
+
+extern "C" void* __wrap_realloc(void* pointer, size_t size)
+{
+	CountAllocation(size);
+	return __real_realloc(pointer, size);
+}
+
+#endif
+
+static void* AllocateCounted(size_t size)
+{
+	CountAllocation(size);
+	return REAL_MALLOC(size != 0 ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+	void* pointer = AllocateCounted(size);
+	if (pointer == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return AllocateCounted(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return AllocateCounted(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	free(pointer);
+}
+
+AllocationCounts Moonlight::Xbox::Interop::GetAllocationCounts()
+{
+	AllocationCounts counts;
+	counts.Allocations = s_Allocations.load(std::memory_order_relaxed);
+	counts.Bytes = s_AllocatedBytes.load(std::memory_order_relaxed);
+	return counts;
+}
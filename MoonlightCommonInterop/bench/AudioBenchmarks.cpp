@@ -0,0 +1,141 @@
+#include "Benchmarks.h"
+#include "NullRenderers.h"
+#include "StreamingSession.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Same value as AudioRendererCapabilities::FloatOutput
+#define AUDIO_CAPABILITY_FLOAT_OUTPUT 0x10000
+
+// Packets encoded up front and replayed in a loop
+#define AUDIO_BENCHMARK_PACKETS 400
+
+// Roughly what handing a buffer to XAudio2 costs, so batching has something to save
+#define AUDIO_RENDERER_CALL_COST_NS 10000
+
+struct AudioBenchmark
+{
+	const char* Name;
+	int ChannelCount;
+	int SamplesPerFrame;
+	int Capabilities;
+	bool DownmixToStereo;
+
+	// What the renderer reports, and whether its calls cost AUDIO_RENDERER_CALL_COST_NS
+	int MaxFramesPerSubmission;
+	bool CallCost;
+};
+
+static const AudioBenchmark s_AudioBenchmarks[] =
+{
+	{ "audio/stereo/5ms/int16", 2, 240, 0, false, 1, false },
+	{ "audio/stereo/5ms/float", 2, 240, AUDIO_CAPABILITY_FLOAT_OUTPUT, false, 1, false },
+	{ "audio/stereo/20ms/int16", 2, 960, 0, false, 1, false },
+	{ "audio/5.1/5ms/int16", 6, 240, 0, false, 1, false },
+	{ "audio/7.1/5ms/int16", 8, 240, 0, false, 1, false },
+	{ "audio/7.1/5ms/downmix", 8, 240, 0, true, 1, false },
+	{ "audio/stereo/5ms/batch-1", 2, 240, 0, false, 1, true },
+	{ "audio/stereo/5ms/batch-2", 2, 240, 0, false, 2, true },
+	{ "audio/stereo/5ms/batch-4", 2, 240, 0, false, 4, true },
+};
+
+static bool RunAudioBenchmark(const BenchmarkOptions& options, const AudioBenchmark& benchmark)
+{
+	StreamingSessionConfiguration configuration = GetBenchmarkSessionConfiguration();
+	configuration.AudioDownmixToStereo = benchmark.DownmixToStereo;
+
+	OPUS_MULTISTREAM_CONFIGURATION opusConfig;
+	SyntheticAudioStream stream;
+	if (!GetOpusConfiguration(benchmark.ChannelCount, benchmark.SamplesPerFrame, &opusConfig) ||
+		!stream.Initialize(opusConfig, AUDIO_BENCHMARK_PACKETS))
+	{
+		fprintf(stderr, "%s: couldn't encode the test stream\n", benchmark.Name);
+		return false;
+	}
+
+	NullAudioRenderer* audioRenderer = new NullAudioRenderer(benchmark.Capabilities, 0, benchmark.MaxFramesPerSubmission);
+	if (benchmark.CallCost)
+	{
+		audioRenderer->SetCallCost(AUDIO_RENDERER_CALL_COST_NS);
+	}
+
+	StreamingSession session(
+		configuration,
+		new NullVideoRenderer(0),
+		audioRenderer,
+		new NullConnectionListener());
+	if (session.InitializeAudio(GetAudioConfiguration(benchmark.ChannelCount), &opusConfig) != 0)
+	{
+		fprintf(stderr, "%s: InitializeAudio failed\n", benchmark.Name);
+		return false;
+	}
+
+	session.StartAudio();
+	int packet = 0;
+	for (int i = 0; i < options.WarmupIterations; i++)
+	{
+		int length;
+		const char* data = stream.GetPacket(packet, &length);
+		session.DecodeAndPlayAudioSample((char*)data, length);
+		packet = (packet + 1) % stream.GetPacketCount();
+	}
+
+	LatencyHistogram latency;
+	BenchmarkTimer timer;
+	long long bytesSubmitted = audioRenderer->GetBytes();
+	long long rendererCalls = audioRenderer->GetCalls();
+	timer.Start();
+	for (int i = 0; i < options.Iterations; i++)
+	{
+		int length;
+		const char* data = stream.GetPacket(packet, &length);
+		packet = (packet + 1) % stream.GetPacketCount();
+
+		long long startNs = GetTimeNanoseconds();
+		session.DecodeAndPlayAudioSample((char*)data, length);
+		latency.Record(GetTimeNanoseconds() - startNs);
+	}
+	timer.Stop();
+
+	session.StopAudio();
+
+	// A packet waits for the rest of its batch before the renderer sees it, so
+	// the first packet of a batch is held for up to a batch less one packet
+	char notes[128];
+	snprintf(notes, sizeof(notes), "%.2f renderer calls per packet, packets held up to %.1f ms",
+		(double)(audioRenderer->GetCalls() - rendererCalls) / options.Iterations,
+		(benchmark.MaxFramesPerSubmission - 1) * benchmark.SamplesPerFrame / 48.0);
+
+	BenchmarkResult result;
+	result.ItemName = "packet";
+	result.Items = options.Iterations;
+	result.ElapsedNs = timer.GetElapsedNs();
+	result.BytesCopied = audioRenderer->GetBytes() - bytesSubmitted;
+	result.Allocations = timer.GetAllocations();
+	result.Notes = notes;
+	PrintBenchmarkResult(stdout, benchmark.Name, result, latency);
+
+	session.CleanupAudio();
+
+	if (audioRenderer->GetCalls() == 0)
+	{
+		fprintf(stderr, "%s: no audio reached the renderer\n", benchmark.Name);
+		return false;
+	}
+
+	return true;
+}
+
+bool Moonlight::Xbox::Interop::RunAudioBenchmarks(const BenchmarkOptions& options)
+{
+	bool succeeded = true;
+	for (const AudioBenchmark& benchmark : s_AudioBenchmarks)
+	{
+		if (IsBenchmarkSelected(options, benchmark.Name) && !RunAudioBenchmark(options, benchmark))
+		{
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}
@@ -0,0 +1,226 @@
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include "AudioDownmixer.h"
+#include "AudioSampleConversion.h"
+#include "Benchmarks.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Samples are drawn from a little past full scale so the clamping is exercised too
+#define KERNEL_INPUT_RANGE 1.1f
+
+// The kernels round differently on ARMv7, where halfway cases go away from zero
+#define CONVERSION_MAX_DIFFERENCE 1
+
+// The vector kernels sum each frame's products in a different order
+#define DOWNMIX_MAX_ERROR 1e-5f
+
+typedef void (*ConversionFunction)(const float* input, short* output, int sampleCount);
+
+struct ConversionBenchmark
+{
+	const char* Name;
+	int SampleCount;
+	bool Scalar;
+};
+
+static const ConversionBenchmark s_ConversionBenchmarks[] =
+{
+	{ "conversion/stereo/5ms/scalar", 240 * 2, true },
+	{ "conversion/stereo/5ms/vector", 240 * 2, false },
+	{ "conversion/7.1/20ms/scalar", 960 * 8, true },
+	{ "conversion/7.1/20ms/vector", 960 * 8, false },
+};
+
+struct DownmixBenchmark
+{
+	const char* Name;
+	int ChannelCount;
+	int SampleFrames;
+	bool Scalar;
+};
+
+static const DownmixBenchmark s_DownmixBenchmarks[] =
+{
+	{ "downmix/5.1/5ms/scalar", 6, 240, true },
+	{ "downmix/5.1/5ms/vector", 6, 240, false },
+	{ "downmix/7.1/5ms/scalar", 8, 240, true },
+	{ "downmix/7.1/5ms/vector", 8, 240, false },
+};
+
+static void FillRandomSamples(std::vector<float>& samples)
+{
+	unsigned int seed = 1;
+	for (float& sample : samples)
+	{
+		seed = seed * 1103515245 + 12345;
+		sample = ((seed >> 8) / (float)(1 << 24) * 2 - 1) * KERNEL_INPUT_RANGE;
+	}
+}
+
+static bool RunConversionBenchmark(const BenchmarkOptions& options, const ConversionBenchmark& benchmark)
+{
+	ConversionFunction convert = benchmark.Scalar ? ConvertFloatToInt16Scalar : ConvertFloatToInt16;
+
+	std::vector<float> input(benchmark.SampleCount);
+	std::vector<short> output(benchmark.SampleCount);
+	std::vector<short> reference(benchmark.SampleCount);
+	FillRandomSamples(input);
+
+	// Whichever kernel the CPU gets must agree with the portable one
+	ConvertFloatToInt16Scalar(input.data(), reference.data(), benchmark.SampleCount);
+	convert(input.data(), output.data(), benchmark.SampleCount);
+	int maxDifference = 0;
+	for (int i = 0; i < benchmark.SampleCount; i++)
+	{
+		int difference = abs(output[i] - reference[i]);
+		if (difference > maxDifference)
+		{
+			maxDifference = difference;
+		}
+	}
+
+	for (int i = 0; i < options.WarmupIterations; i++)
+	{
+		convert(input.data(), output.data(), benchmark.SampleCount);
+	}
+
+	LatencyHistogram latency;
+	BenchmarkTimer timer;
+	timer.Start();
+	for (int i = 0; i < options.Iterations; i++)
+	{
+		long long startNs = GetTimeNanoseconds();
+		convert(input.data(), output.data(), benchmark.SampleCount);
+		latency.Record(GetTimeNanoseconds() - startNs);
+	}
+	timer.Stop();
+
+	long long samples = (long long)options.Iterations * benchmark.SampleCount;
+	char notes[128];
+	int length = snprintf(notes, sizeof(notes), "%.3f ns/sample", (double)timer.GetElapsedNs() / samples);
+	if (!benchmark.Scalar)
+	{
+		snprintf(notes + length, sizeof(notes) - length, ", off by at most %d from the scalar kernel", maxDifference);
+	}
+
+	BenchmarkResult result;
+	result.ItemName = "sample";
+	result.Items = samples;
+	result.ElapsedNs = timer.GetElapsedNs();
+	result.BytesCopied = samples * sizeof(short);
+	result.Allocations = timer.GetAllocations();
+	result.Notes = notes;
+	PrintBenchmarkResult(stdout, benchmark.Name, result, latency);
+
+	if (maxDifference > CONVERSION_MAX_DIFFERENCE)
+	{
+		fprintf(stderr, "%s: output differs from the scalar kernel by %d\n", benchmark.Name, maxDifference);
+		return false;
+	}
+
+	return true;
+}
+
+static void Downmix(const AudioDownmixer& downmixer, const DownmixBenchmark& benchmark, const float* input, float* output)
+{
+	if (benchmark.Scalar)
+	{
+		downmixer.ProcessScalar(input, output, benchmark.SampleFrames);
+	}
+	else
+	{
+		downmixer.Process(input, output, benchmark.SampleFrames);
+	}
+}
+
+static bool RunDownmixBenchmark(const BenchmarkOptions& options, const DownmixBenchmark& benchmark)
+{
+	AudioDownmixer downmixer;
+	if (!downmixer.Initialize(benchmark.ChannelCount, NULL))
+	{
+		fprintf(stderr, "%s: couldn't initialize the downmixer\n", benchmark.Name);
+		return false;
+	}
+
+	std::vector<float> input((size_t)benchmark.SampleFrames * benchmark.ChannelCount);
+	std::vector<float> output((size_t)benchmark.SampleFrames * DOWNMIX_OUTPUT_CHANNELS);
+	std::vector<float> reference(output.size());
+	FillRandomSamples(input);
+
+	downmixer.ProcessScalar(input.data(), reference.data(), benchmark.SampleFrames);
+	Downmix(downmixer, benchmark, input.data(), output.data());
+	float maxError = 0;
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		float error = fabsf(output[i] - reference[i]);
+		if (error > maxError)
+		{
+			maxError = error;
+		}
+	}
+
+	for (int i = 0; i < options.WarmupIterations; i++)
+	{
+		Downmix(downmixer, benchmark, input.data(), output.data());
+	}
+
+	LatencyHistogram latency;
+	BenchmarkTimer timer;
+	timer.Start();
+	for (int i = 0; i < options.Iterations; i++)
+	{
+		long long startNs = GetTimeNanoseconds();
+		Downmix(downmixer, benchmark, input.data(), output.data());
+		latency.Record(GetTimeNanoseconds() - startNs);
+	}
+	timer.Stop();
+
+	long long frames = (long long)options.Iterations * benchmark.SampleFrames;
+	char notes[128];
+	int length = snprintf(notes, sizeof(notes), "%.3f ns/frame", (double)timer.GetElapsedNs() / frames);
+	if (!benchmark.Scalar)
+	{
+		snprintf(notes + length, sizeof(notes) - length, ", off by at most %g from the scalar kernel", maxError);
+	}
+
+	BenchmarkResult result;
+	result.ItemName = "frame";
+	result.Items = frames;
+	result.ElapsedNs = timer.GetElapsedNs();
+	result.BytesCopied = frames * DOWNMIX_OUTPUT_CHANNELS * sizeof(float);
+	result.Allocations = timer.GetAllocations();
+	result.Notes = notes;
+	PrintBenchmarkResult(stdout, benchmark.Name, result, latency);
+
+	if (maxError > DOWNMIX_MAX_ERROR)
+	{
+		fprintf(stderr, "%s: output differs from the scalar kernel by %g\n", benchmark.Name, maxError);
+		return false;
+	}
+
+	return true;
+}
+
+bool Moonlight::Xbox::Interop::RunAudioKernelBenchmarks(const BenchmarkOptions& options)
+{
+	bool succeeded = true;
+	for (const ConversionBenchmark& benchmark : s_ConversionBenchmarks)
+	{
+		if (IsBenchmarkSelected(options, benchmark.Name) && !RunConversionBenchmark(options, benchmark))
+		{
+			succeeded = false;
+		}
+	}
+
+	for (const DownmixBenchmark& benchmark : s_DownmixBenchmarks)
+	{
+		if (IsBenchmarkSelected(options, benchmark.Name) && !RunDownmixBenchmark(options, benchmark))
+		{
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}
@@ -0,0 +1,214 @@
+#include <math.h>
+#include <stdarg.h>
+#include <vector>
+#include "AudioPipeline.h"
+#include "BenchmarkHarness.h"
+#include "NullRenderers.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Audio decoded per test, enough to get past the codec's startup and still leave
+// a window long enough to tell the channels' tones apart
+#define ROUND_TRIP_SAMPLES 7200
+#define TONE_SKIP_SAMPLES 960
+#define TONE_WINDOW_SAMPLES 4800
+
+// How much stronger a channel's own tone must be than any other channel's
+#define TONE_ISOLATION_RATIO 10.0
+
+static const int s_ChannelCounts[] = { 2, 6, 8 };
+
+// Every Opus frame duration from 2.5 to 60 ms at 48 kHz
+static const int s_FrameSizes[] = { 120, 240, 480, 960, 1920, 2880 };
+
+static int s_Tests;
+static int s_Failures;
+
+static bool Expect(bool condition, const char* test, const char* format, ...)
+{
+	if (!condition)
+	{
+		va_list args;
+		va_start(args, format);
+		fprintf(stderr, "FAILED %s: ", test);
+		vfprintf(stderr, format, args);
+		fprintf(stderr, "\n");
+		va_end(args);
+		s_Failures++;
+	}
+
+	return condition;
+}
+
+static double GetTonePower(const std::vector<float>& samples, int channelCount, int channel, double frequency)
+{
+	// Goertzel filter over the analysis window
+	double coefficient = 2 * cos(2 * M_PI * frequency / 48000);
+	double previous = 0;
+	double beforePrevious = 0;
+	for (int i = TONE_SKIP_SAMPLES; i < TONE_SKIP_SAMPLES + TONE_WINDOW_SAMPLES; i++)
+	{
+		double current = samples[(size_t)i * channelCount + channel] + coefficient * previous - beforePrevious;
+		beforePrevious = previous;
+		previous = current;
+	}
+
+	return previous * previous + beforePrevious * beforePrevious - coefficient * previous * beforePrevious;
+}
+
+// Each synthetic channel carries a tone at its own pitch, so a channel that comes
+// out in the wrong position is dominated by another channel's tone
+static void ExpectChannelOrder(const char* test, const std::vector<float>& samples, int channelCount)
+{
+	for (int channel = 0; channel < channelCount; channel++)
+	{
+		double ownPower = GetTonePower(samples, channelCount, channel, 220.0 * (channel + 1));
+		for (int other = 0; other < channelCount; other++)
+		{
+			if (other == channel)
+			{
+				continue;
+			}
+
+			double otherPower = GetTonePower(samples, channelCount, channel, 220.0 * (other + 1));
+			if (!Expect(ownPower > otherPower * TONE_ISOLATION_RATIO, test,
+				"channel %d carries channel %d's tone (%g vs %g)", channel, other, otherPower, ownPower))
+			{
+				return;
+			}
+		}
+	}
+}
+
+static void TestRoundTrip(int channelCount, int samplesPerFrame, bool floatOutput)
+{
+	char test[64];
+	snprintf(test, sizeof(test), "%d channels, %.1f ms, %s",
+		channelCount,
+		samplesPerFrame / 48.0,
+		floatOutput ? "float" : "int16");
+	s_Tests++;
+
+	OPUS_MULTISTREAM_CONFIGURATION opusConfig;
+	SyntheticAudioStream stream;
+	int packetCount = (ROUND_TRIP_SAMPLES + samplesPerFrame - 1) / samplesPerFrame;
+	if (!Expect(GetOpusConfiguration(channelCount, samplesPerFrame, &opusConfig) &&
+		stream.Initialize(opusConfig, packetCount), test, "couldn't encode the stream"))
+	{
+		return;
+	}
+
+	int sampleSize = floatOutput ? sizeof(float) : sizeof(short);
+	int frameLength = samplesPerFrame * channelCount * sampleSize;
+	std::vector<char> capture((size_t)frameLength * packetCount);
+	NullAudioRenderer renderer(0, 0, 1);
+	renderer.SetCaptureBuffer(capture.data(), (int)capture.size());
+
+	AudioPipelineConfiguration configuration = {};
+	configuration.FloatOutput = floatOutput;
+	configuration.MaxFramesPerSubmission = 1;
+
+	AudioPipeline pipeline(&renderer);
+	if (!Expect(pipeline.Initialize(&opusConfig, configuration) == 0, test, "Initialize failed"))
+	{
+		return;
+	}
+
+	for (int i = 0; i < packetCount; i++)
+	{
+		int length;
+		const char* packet = stream.GetPacket(i, &length);
+		pipeline.DecodeAndPlaySample(packet, length);
+	}
+
+	pipeline.Cleanup();
+
+	Expect(renderer.GetCalls() == packetCount, test, "%lld renderer calls for %d packets", renderer.GetCalls(), packetCount);
+	Expect(renderer.GetMinLength() == frameLength && renderer.GetMaxLength() == frameLength, test,
+		"submitted %d to %d bytes per packet, expected %d",
+		renderer.GetMinLength(),
+		renderer.GetMaxLength(),
+		frameLength);
+	if (!Expect(renderer.GetBytes() == (long long)frameLength * packetCount, test,
+		"submitted %lld bytes in total, expected %lld", renderer.GetBytes(), (long long)frameLength * packetCount))
+	{
+		return;
+	}
+
+	std::vector<float> samples((size_t)samplesPerFrame * channelCount * packetCount);
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		samples[i] = floatOutput ? ((const float*)capture.data())[i] : ((const short*)capture.data())[i] / 32768.0f;
+	}
+
+	ExpectChannelOrder(test, samples, channelCount);
+}
+
+// The host can change packet durations mid-stream, so each packet must be
+// submitted at the length it decoded to rather than the configured one
+static void TestVariableFrameSizes(int channelCount)
+{
+	char test[64];
+	snprintf(test, sizeof(test), "%d channels, 5 and 20 ms packets", channelCount);
+	s_Tests++;
+
+	OPUS_MULTISTREAM_CONFIGURATION shortConfig;
+	OPUS_MULTISTREAM_CONFIGURATION longConfig;
+	SyntheticAudioStream shortStream;
+	SyntheticAudioStream longStream;
+	if (!Expect(GetOpusConfiguration(channelCount, 240, &shortConfig) &&
+		GetOpusConfiguration(channelCount, 960, &longConfig) &&
+		shortStream.Initialize(shortConfig, 8) &&
+		longStream.Initialize(longConfig, 8), test, "couldn't encode the streams"))
+	{
+		return;
+	}
+
+	NullAudioRenderer renderer(0, 0, 1);
+	AudioPipelineConfiguration configuration = {};
+	configuration.MaxFramesPerSubmission = 1;
+
+	AudioPipeline pipeline(&renderer);
+	if (!Expect(pipeline.Initialize(&shortConfig, configuration) == 0, test, "Initialize failed"))
+	{
+		return;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		int length;
+		const char* packet = (i % 2 == 0 ? shortStream : longStream).GetPacket(i, &length);
+		pipeline.DecodeAndPlaySample(packet, length);
+	}
+
+	pipeline.Cleanup();
+
+	int shortLength = 240 * channelCount * (int)sizeof(short);
+	int longLength = 960 * channelCount * (int)sizeof(short);
+	Expect(renderer.GetCalls() == 8, test, "%lld renderer calls for 8 packets", renderer.GetCalls());
+	Expect(renderer.GetMinLength() == shortLength && renderer.GetMaxLength() == longLength, test,
+		"submitted %d to %d bytes per packet, expected %d to %d",
+		renderer.GetMinLength(),
+		renderer.GetMaxLength(),
+		shortLength,
+		longLength);
+	Expect(renderer.GetBytes() == 4LL * (shortLength + longLength), test,
+		"submitted %lld bytes in total, expected %lld", renderer.GetBytes(), 4LL * (shortLength + longLength));
+}
+
+int main()
+{
+	for (int channelCount : s_ChannelCounts)
+	{
+		for (int samplesPerFrame : s_FrameSizes)
+		{
+			TestRoundTrip(channelCount, samplesPerFrame, false);
+			TestRoundTrip(channelCount, samplesPerFrame, true);
+		}
+
+		TestVariableFrameSizes(channelCount);
+	}
+
+	printf("%d tests, %d failures\n", s_Tests, s_Failures);
+	return s_Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,568 @@
+#include <math.h>
+#include <string.h>
+#include <opus_multistream.h>
+#include "AsyncLogger.h"
+#include "BenchmarkHarness.h"
+#include "FramePacer.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define HISTOGRAM_BAR_WIDTH 40
+
+// Bytes of made-up payload in each parameter set
+#define PARAMETER_SET_LENGTH 24
+
+// Per-channel bitrate of the synthetic audio, about what GFE uses for surround
+#define AUDIO_BITRATE_PER_CHANNEL 48000
+
+#define AUDIO_TONE_AMPLITUDE 0.25f
+#define AUDIO_TONE_BASE_HZ 220
+
+// Largest packet a single Opus stream can produce, times the frames in a 120 ms packet
+#define MAX_OPUS_STREAM_PACKET_SIZE (1275 * 6)
+
+bool Moonlight::Xbox::Interop::IsBenchmarkSelected(const BenchmarkOptions& options, const char* name)
+{
+	return options.Filter == NULL || strstr(name, options.Filter) != NULL;
+}
+
+StreamingSessionConfiguration Moonlight::Xbox::Interop::GetBenchmarkSessionConfiguration()
+{
+	StreamingSessionConfiguration configuration;
+	configuration.Address = "127.0.0.1";
+	configuration.Width = 1920;
+	configuration.Height = 1080;
+	configuration.Fps = 60;
+	configuration.Bitrate = 20000;
+	configuration.VideoDecodeQueueDepth = 0;
+	configuration.FramePacing = FramePacingOff;
+	configuration.AudioJitterBufferTargetMs = 0;
+	configuration.AudioDownmixToStereo = false;
+	configuration.MinimumLogSeverity = LogSeverityVerbose;
+	configuration.AdaptiveBitrate = false;
+	memset(&configuration.AdaptiveBitratePolicy, 0, sizeof(configuration.AdaptiveBitratePolicy));
+	return configuration;
+}
+
+static int FormatDuration(char* output, int capacity, long long durationNs)
+{
+	if (durationNs < 10000)
+	{
+		return snprintf(output, capacity, "%lld ns", durationNs);
+	}
+	else if (durationNs < 10000000)
+	{
+		return snprintf(output, capacity, "%.1f us", durationNs / 1000.0);
+	}
+	else
+	{
+		return snprintf(output, capacity, "%.2f ms", durationNs / 1000000.0);
+	}
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+	memset(m_Buckets, 0, sizeof(m_Buckets));
+	m_Count = 0;
+	m_Total = 0;
+	m_Max = 0;
+}
+
+int LatencyHistogram::GetBucket(long long durationNs)
+{
+	if (durationNs < LATENCY_HISTOGRAM_SUB_BUCKETS)
+	{
+		return durationNs > 0 ? (int)durationNs : 0;
+	}
+
+	// Octave n > 0 covers [8 << (n - 1), 16 << (n - 1)) in sub-buckets of 1 << (n - 1)
+	int highestBit = 63 - __builtin_clzll((unsigned long long)durationNs);
+	int octave = highestBit - 2;
+	if (octave >= LATENCY_HISTOGRAM_OCTAVES)
+	{
+		return LATENCY_HISTOGRAM_OCTAVES * LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+	}
+
+	int subBucket = (int)(durationNs >> (highestBit - 3)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+	return octave * LATENCY_HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+long long LatencyHistogram::GetBucketUpperBound(int bucket)
+{
+	int octave = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS;
+	int subBucket = bucket % LATENCY_HISTOGRAM_SUB_BUCKETS;
+	if (octave == 0)
+	{
+		return subBucket + 1;
+	}
+
+	return (long long)(LATENCY_HISTOGRAM_SUB_BUCKETS + subBucket + 1) << (octave - 1);
+}
+
+void LatencyHistogram::Record(long long durationNs)
+{
+	m_Buckets[GetBucket(durationNs)]++;
+	m_Count++;
+	m_Total += durationNs;
+	if (durationNs > m_Max)
+	{
+		m_Max = durationNs;
+	}
+}
+
+long long LatencyHistogram::GetCount() const
+{
+	return m_Count;
+}
+
+long long LatencyHistogram::GetMean() const
+{
+	return m_Count > 0 ? m_Total / m_Count : 0;
+}
+
+long long LatencyHistogram::GetMax() const
+{
+	return m_Max;
+}
+
+long long LatencyHistogram::GetPercentile(double percentile) const
+{
+	long long rank = (long long)ceil(m_Count * percentile / 100.0);
+	long long seen = 0;
+	for (int i = 0; i < LATENCY_HISTOGRAM_OCTAVES * LATENCY_HISTOGRAM_SUB_BUCKETS; i++)
+	{
+		seen += m_Buckets[i];
+		if (seen >= rank && seen > 0)
+		{
+			long long upperBound = GetBucketUpperBound(i);
+			return upperBound < m_Max ? upperBound : m_Max;
+		}
+	}
+
+	return m_Max;
+}
+
+void LatencyHistogram::Print(FILE* output) const
+{
+	long long octaveCounts[LATENCY_HISTOGRAM_OCTAVES];
+	long long largestCount = 0;
+	for (int octave = 0; octave < LATENCY_HISTOGRAM_OCTAVES; octave++)
+	{
+		octaveCounts[octave] = 0;
+		for (int i = 0; i < LATENCY_HISTOGRAM_SUB_BUCKETS; i++)
+		{
+			octaveCounts[octave] += m_Buckets[octave * LATENCY_HISTOGRAM_SUB_BUCKETS + i];
+		}
+
+		if (octaveCounts[octave] > largestCount)
+		{
+			largestCount = octaveCounts[octave];
+		}
+	}
+
+	for (int octave = 0; octave < LATENCY_HISTOGRAM_OCTAVES; octave++)
+	{
+		if (octaveCounts[octave] == 0)
+		{
+			continue;
+		}
+
+		char lower[32];
+		char upper[32];
+		FormatDuration(lower, sizeof(lower), octave == 0 ? 0 : (long long)LATENCY_HISTOGRAM_SUB_BUCKETS << (octave - 1));
+		FormatDuration(upper, sizeof(upper), GetBucketUpperBound((octave + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS - 1));
+
+		char bar[HISTOGRAM_BAR_WIDTH + 1];
+		int barLength = (int)((octaveCounts[octave] * HISTOGRAM_BAR_WIDTH + largestCount - 1) / largestCount);
+		memset(bar, '#', barLength);
+		bar[barLength] = '\0';
+
+		fprintf(output, "    %10s - %-10s %10lld %6.2f%% %s\n",
+			lower,
+			upper,
+			octaveCounts[octave],
+			octaveCounts[octave] * 100.0 / m_Count,
+			bar);
+	}
+}
+
+void BenchmarkTimer::Start()
+{
+	m_StartAllocations = GetAllocationCounts();
+	m_StartNs = GetTimeNanoseconds();
+}
+
+void BenchmarkTimer::Stop()
+{
+	m_StopNs = GetTimeNanoseconds();
+	m_StopAllocations = GetAllocationCounts();
+}
+
+long long BenchmarkTimer::GetElapsedNs() const
+{
+	return m_StopNs - m_StartNs;
+}
+
+AllocationCounts BenchmarkTimer::GetAllocations() const
+{
+	AllocationCounts allocations;
+	allocations.Allocations = m_StopAllocations.Allocations - m_StartAllocations.Allocations;
+	allocations.Bytes = m_StopAllocations.Bytes - m_StartAllocations.Bytes;
+	return allocations;
+}
+
+void Moonlight::Xbox::Interop::PrintBenchmarkResult(FILE* output, const char* name, const BenchmarkResult& result, const LatencyHistogram& latency)
+{
+	double seconds = result.ElapsedNs / 1000000000.0;
+	double items = result.Items > 0 ? (double)result.Items : 1.0;
+
+	fprintf(output, "%s\n", name);
+	fprintf(output, "  %-13s %lld %ss in %.3f s, %.0f %ss/s\n",
+		"throughput",
+		result.Items,
+		result.ItemName,
+		seconds,
+		seconds > 0 ? result.Items / seconds : 0.0,
+		result.ItemName);
+	fprintf(output, "  %-13s %lld (%.1f MB/s, %.0f per %s)\n",
+		"bytes copied",
+		result.BytesCopied,
+		seconds > 0 ? result.BytesCopied / seconds / 1000000.0 : 0.0,
+		result.BytesCopied / items,
+		result.ItemName);
+	fprintf(output, "  %-13s %lld (%lld bytes, %.3f per %s)\n",
+		"allocations",
+		result.Allocations.Allocations,
+		result.Allocations.Bytes,
+		result.Allocations.Allocations / items,
+		result.ItemName);
+
+	char mean[32];
+	char p50[32];
+	char p90[32];
+	char p99[32];
+	char p999[32];
+	char max[32];
+	FormatDuration(mean, sizeof(mean), latency.GetMean());
+	FormatDuration(p50, sizeof(p50), latency.GetPercentile(50));
+	FormatDuration(p90, sizeof(p90), latency.GetPercentile(90));
+	FormatDuration(p99, sizeof(p99), latency.GetPercentile(99));
+	FormatDuration(p999, sizeof(p999), latency.GetPercentile(99.9));
+	FormatDuration(max, sizeof(max), latency.GetMax());
+	fprintf(output, "  %-13s mean %s, p50 %s, p90 %s, p99 %s, p99.9 %s, max %s\n",
+		"latency",
+		mean,
+		p50,
+		p90,
+		p99,
+		p999,
+		max);
+	latency.Print(output);
+
+	if (result.Notes != NULL)
+	{
+		fprintf(output, "  %-13s %s\n", "notes", result.Notes);
+	}
+
+	fprintf(output, "\n");
+}
+
+SyntheticVideoStream::SyntheticVideoStream()
+	: m_VideoFormat(0),
+	m_FrameSize(0),
+	m_IdrFrameSize(0),
+	m_SlicesPerFrame(0),
+	m_PacketSize(0),
+	m_IdrInterval(0),
+	m_FrameNumber(0),
+	m_Seed(1)
+{
+	memset(&m_DecodeUnit, 0, sizeof(m_DecodeUnit));
+}
+
+void SyntheticVideoStream::AppendNalUnit(std::vector<char>& data, int nalType, unsigned char firstByte, int length)
+{
+	static const char startCode[] = { 0, 0, 0, 1 };
+	data.insert(data.end(), startCode, startCode + sizeof(startCode));
+
+	if (m_VideoFormat & VIDEO_FORMAT_MASK_H265)
+	{
+		data.push_back((char)(nalType << 1));
+		data.push_back(1);
+	}
+	else
+	{
+		// nal_ref_idc 3, so every H.264 picture counts as a reference
+		data.push_back((char)(0x60 | nalType));
+	}
+
+	int payloadStart = (int)data.size();
+	if (firstByte != 0)
+	{
+		data.push_back((char)firstByte);
+	}
+
+	// Payload bytes are never 0, so no start code can appear inside a NAL unit
+	while ((int)data.size() - payloadStart < length)
+	{
+		m_Seed = m_Seed * 1103515245 + 12345;
+		data.push_back((char)(((m_Seed >> 16) % 255) + 1));
+	}
+}
+
+void SyntheticVideoStream::BuildFrame(bool idr, std::vector<char>& data, std::vector<LENTRY>& entries)
+{
+	bool hevc = (m_VideoFormat & VIDEO_FORMAT_MASK_H265) != 0;
+	int headerLength = 4 + (hevc ? 2 : 1);
+
+	// Parameter sets, each in a buffer of its own
+	std::vector<int> parameterSetTypes;
+	if (idr)
+	{
+		if (hevc)
+		{
+			AppendNalUnit(data, 32, 0, PARAMETER_SET_LENGTH);
+			parameterSetTypes.push_back(BUFFER_TYPE_VPS);
+			AppendNalUnit(data, 33, 0, PARAMETER_SET_LENGTH);
+			parameterSetTypes.push_back(BUFFER_TYPE_SPS);
+
+			// pps_pic_parameter_set_id 0, pps_seq_parameter_set_id 0, both flags
+			// clear and no extra slice header bits
+			AppendNalUnit(data, 34, 0xC1, PARAMETER_SET_LENGTH);
+			parameterSetTypes.push_back(BUFFER_TYPE_PPS);
+		}
+		else
+		{
+			AppendNalUnit(data, 7, 0, PARAMETER_SET_LENGTH);
+			parameterSetTypes.push_back(BUFFER_TYPE_SPS);
+			AppendNalUnit(data, 8, 0, PARAMETER_SET_LENGTH);
+			parameterSetTypes.push_back(BUFFER_TYPE_PPS);
+		}
+	}
+
+	// Slice headers that parse as the first slice of an I or P picture. For HEVC:
+	// first_slice_segment_in_pic_flag, no_output_of_prior_pics_flag on IDR NAL units,
+	// slice_pic_parameter_set_id 0, then slice_type 2 (I) or 1 (P). For H.264:
+	// first_mb_in_slice 0, then slice_type 7 (I) or 5 (P).
+	int sliceType;
+	unsigned char sliceHeader;
+	if (hevc)
+	{
+		sliceType = idr ? 19 : 1;
+		sliceHeader = idr ? 0xAF : 0xD7;
+	}
+	else
+	{
+		sliceType = idr ? 5 : 1;
+		sliceHeader = idr ? 0x88 : 0x9B;
+	}
+
+	int pictureStart = (int)data.size();
+	for (int i = 0; i < m_SlicesPerFrame; i++)
+	{
+		int sliceLength = (idr ? m_IdrFrameSize : m_FrameSize) / m_SlicesPerFrame - headerLength;
+		AppendNalUnit(data, sliceType, sliceHeader, sliceLength > 1 ? sliceLength : 1);
+	}
+
+	// Only now that the data won't move can the entries point into it
+	int offset = 0;
+	for (size_t i = 0; i < parameterSetTypes.size(); i++)
+	{
+		LENTRY entry;
+		entry.next = NULL;
+		entry.data = &data[offset];
+		entry.length = headerLength + PARAMETER_SET_LENGTH;
+		entry.bufferType = parameterSetTypes[i];
+		entries.push_back(entry);
+		offset += entry.length;
+	}
+
+	for (offset = pictureStart; offset < (int)data.size(); offset += m_PacketSize)
+	{
+		LENTRY entry;
+		entry.next = NULL;
+		entry.data = &data[offset];
+		entry.length = (int)data.size() - offset < m_PacketSize ? (int)data.size() - offset : m_PacketSize;
+		entry.bufferType = BUFFER_TYPE_PICDATA;
+		entries.push_back(entry);
+	}
+
+	for (size_t i = 0; i + 1 < entries.size(); i++)
+	{
+		entries[i].next = &entries[i + 1];
+	}
+}
+
+void SyntheticVideoStream::Initialize(int videoFormat, int frameSize, int idrFrameSize, int slicesPerFrame, int packetSize, int idrInterval)
+{
+	m_VideoFormat = videoFormat;
+	m_FrameSize = frameSize;
+	m_IdrFrameSize = idrFrameSize;
+	m_SlicesPerFrame = slicesPerFrame > 0 ? slicesPerFrame : 1;
+	m_PacketSize = packetSize;
+	m_IdrInterval = idrInterval;
+	m_FrameNumber = 0;
+
+	m_IdrData.clear();
+	m_IdrEntries.clear();
+	m_PFrameData.clear();
+	m_PFrameEntries.clear();
+	BuildFrame(true, m_IdrData, m_IdrEntries);
+	BuildFrame(false, m_PFrameData, m_PFrameEntries);
+}
+
+PDECODE_UNIT SyntheticVideoStream::NextFrame()
+{
+	bool idr = m_IdrInterval > 0 ? m_FrameNumber % m_IdrInterval == 0 : m_FrameNumber == 0;
+	m_FrameNumber++;
+
+	m_DecodeUnit.frameNumber = m_FrameNumber;
+	m_DecodeUnit.frameType = idr ? FRAME_TYPE_IDR : FRAME_TYPE_PFRAME;
+	m_DecodeUnit.receiveTimeMs = LiGetMillis();
+	m_DecodeUnit.fullLength = idr ? (int)m_IdrData.size() : (int)m_PFrameData.size();
+	m_DecodeUnit.bufferList = idr ? m_IdrEntries.data() : m_PFrameEntries.data();
+	return &m_DecodeUnit;
+}
+
+int SyntheticVideoStream::GetFrameSize() const
+{
+	return m_FrameSize;
+}
+
+bool Moonlight::Xbox::Interop::GetOpusConfiguration(int channelCount, int samplesPerFrame, POPUS_MULTISTREAM_CONFIGURATION opusConfig)
+{
+	static const unsigned char stereoMapping[] = { 0, 1 };
+	static const unsigned char surround51Mapping[] = { 0, 4, 1, 5, 2, 3 };
+	static const unsigned char surround71Mapping[] = { 0, 6, 1, 7, 2, 3, 4, 5 };
+
+	memset(opusConfig, 0, sizeof(*opusConfig));
+	opusConfig->sampleRate = 48000;
+	opusConfig->channelCount = channelCount;
+	opusConfig->samplesPerFrame = samplesPerFrame;
+
+	switch (channelCount)
+	{
+	case 2:
+		opusConfig->streams = 1;
+		opusConfig->coupledStreams = 1;
+		memcpy(opusConfig->mapping, stereoMapping, sizeof(stereoMapping));
+		return true;
+	case 6:
+		opusConfig->streams = 4;
+		opusConfig->coupledStreams = 2;
+		memcpy(opusConfig->mapping, surround51Mapping, sizeof(surround51Mapping));
+		return true;
+	case 8:
+		opusConfig->streams = 5;
+		opusConfig->coupledStreams = 3;
+		memcpy(opusConfig->mapping, surround71Mapping, sizeof(surround71Mapping));
+		return true;
+	default:
+		return false;
+	}
+}
+
+int Moonlight::Xbox::Interop::GetAudioConfiguration(int channelCount)
+{
+	switch (channelCount)
+	{
+	case 6:
+		return AUDIO_CONFIGURATION_51_SURROUND;
+	case 8:
+		return AUDIO_CONFIGURATION_71_SURROUND;
+	default:
+		return AUDIO_CONFIGURATION_STEREO;
+	}
+}
+
+SyntheticAudioStream::SyntheticAudioStream()
+	: m_ChannelCount(0),
+	m_SamplesPerFrame(0)
+{
+}
+
+bool SyntheticAudioStream::Initialize(const OPUS_MULTISTREAM_CONFIGURATION& opusConfig, int packetCount)
+{
+	int err;
+	OpusMSEncoder* encoder =
+		opus_multistream_encoder_create(
+			opusConfig.sampleRate,
+			opusConfig.channelCount,
+			opusConfig.streams,
+			opusConfig.coupledStreams,
+			opusConfig.mapping,
+			OPUS_APPLICATION_RESTRICTED_LOWDELAY,
+			&err);
+	if (encoder == NULL)
+	{
+		return false;
+	}
+
+	opus_multistream_encoder_ctl(encoder, OPUS_SET_BITRATE(AUDIO_BITRATE_PER_CHANNEL * opusConfig.channelCount));
+
+	m_ChannelCount = opusConfig.channelCount;
+	m_SamplesPerFrame = opusConfig.samplesPerFrame;
+	m_Data.clear();
+	m_Offsets.clear();
+	m_SourcePcm.resize((size_t)packetCount * m_SamplesPerFrame * m_ChannelCount);
+
+	for (int i = 0; i < packetCount * m_SamplesPerFrame; i++)
+	{
+		for (int channel = 0; channel < m_ChannelCount; channel++)
+		{
+			double frequency = AUDIO_TONE_BASE_HZ * (channel + 1);
+			m_SourcePcm[(size_t)i * m_ChannelCount + channel] =
+				AUDIO_TONE_AMPLITUDE * (float)sin(2 * M_PI * frequency * i / opusConfig.sampleRate);
+		}
+	}
+
+	std::vector<unsigned char> packet((size_t)MAX_OPUS_STREAM_PACKET_SIZE * opusConfig.streams);
+	for (int i = 0; i < packetCount; i++)
+	{
+		int length =
+			opus_multistream_encode_float(
+				encoder,
+				GetSourcePcm(i),
+				m_SamplesPerFrame,
+				packet.data(),
+				(opus_int32)packet.size());
+		if (length < 0)
+		{
+			opus_multistream_encoder_destroy(encoder);
+			return false;
+		}
+
+		m_Offsets.push_back((int)m_Data.size());
+		m_Data.insert(m_Data.end(), packet.begin(), packet.begin() + length);
+	}
+
+	m_Offsets.push_back((int)m_Data.size());
+	opus_multistream_encoder_destroy(encoder);
+	return true;
+}
+
+int SyntheticAudioStream::GetPacketCount() const
+{
+	return m_Offsets.empty() ? 0 : (int)m_Offsets.size() - 1;
+}
+
+const char* SyntheticAudioStream::GetPacket(int index, int* length) const
+{
+	*length = m_Offsets[index + 1] - m_Offsets[index];
+	return &m_Data[m_Offsets[index]];
+}
+
+const float* SyntheticAudioStream::GetSourcePcm(int index) const
+{
+	return &m_SourcePcm[(size_t)index * m_SamplesPerFrame * m_ChannelCount];
+}
+
+long long SyntheticAudioStream::GetEncodedBytes() const
+{
+	return (long long)m_Data.size();
+}
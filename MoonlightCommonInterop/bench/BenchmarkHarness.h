@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "Limelight.h"
+#include "SessionInterfaces.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			struct BenchmarkOptions
+			{
+				// Measured calls per benchmark, after the warmup
+				int Iterations;
+				int WarmupIterations;
+
+				// Only run benchmarks whose name contains this, if it isn't NULL
+				const char* Filter;
+			};
+
+			bool IsBenchmarkSelected(const BenchmarkOptions& options, const char* name);
+
+			// 1080p60 at 20 Mbps with no decode queue, pacing, jitter buffer or adaptive
+			// bitrate, and every log message delivered
+			StreamingSessionConfiguration GetBenchmarkSessionConfiguration();
+
+			struct AllocationCounts
+			{
+				long long Allocations;
+				long long Bytes;
+			};
+
+			// Heap allocations made so far by any thread. operator new is always counted.
+			// malloc, calloc and realloc are counted when the linker can wrap them, which
+			// covers the streaming core but not libopus.
+			AllocationCounts GetAllocationCounts();
+
+			// Calls the streaming core made to moonlight-common-c's connectionDetectedFrameLoss
+			long long GetFrameLossReports();
+
+			inline long long GetTimeNanoseconds()
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			#define LATENCY_HISTOGRAM_OCTAVES 40
+			#define LATENCY_HISTOGRAM_SUB_BUCKETS 8
+
+			// Fixed-size log-linear histogram of call durations in nanoseconds, so that
+			// recording never allocates. Each power of two is split into equal sub-buckets
+			// and percentiles report the upper edge of the bucket they fall in.
+			class LatencyHistogram
+			{
+			public:
+				LatencyHistogram();
+
+				void Reset();
+
+				void Record(long long durationNs);
+
+				long long GetCount() const;
+
+				long long GetMean() const;
+
+				long long GetMax() const;
+
+				long long GetPercentile(double percentile) const;
+
+				// One row per non-empty power of two
+				void Print(FILE* output) const;
+
+			private:
+				static int GetBucket(long long durationNs);
+
+				static long long GetBucketUpperBound(int bucket);
+
+				long long m_Buckets[LATENCY_HISTOGRAM_OCTAVES * LATENCY_HISTOGRAM_SUB_BUCKETS];
+				long long m_Count;
+				long long m_Total;
+				long long m_Max;
+			};
+
+			// What a benchmark measured over its timed iterations
+			struct BenchmarkResult
+			{
+				// Singular, such as "frame"
+				const char* ItemName;
+				long long Items;
+				long long ElapsedNs;
+				long long BytesCopied;
+				AllocationCounts Allocations;
+
+				// Anything else worth reporting, or NULL
+				const char* Notes;
+			};
+
+			// Brackets the timed part of a benchmark, sampling the clock and the allocation
+			// counters at either end
+			class BenchmarkTimer
+			{
+			public:
+				void Start();
+
+				void Stop();
+
+				long long GetElapsedNs() const;
+
+				AllocationCounts GetAllocations() const;
+
+			private:
+				long long m_StartNs;
+				long long m_StopNs;
+				AllocationCounts m_StartAllocations;
+				AllocationCounts m_StopAllocations;
+			};
+
+			void PrintBenchmarkResult(FILE* output, const char* name, const BenchmarkResult& result, const LatencyHistogram& latency);
+
+			// Decode units shaped like the ones moonlight-common-c reassembles: parameter
+			// sets in their own buffers on IDR frames, and picture data split into
+			// packet-sized buffers whose boundaries fall anywhere within a NAL unit. All
+			// memory is allocated up front, so producing a frame doesn't allocate.
+			class SyntheticVideoStream
+			{
+			public:
+				SyntheticVideoStream();
+
+				// Frames are frameSize bytes of picture data in slicesPerFrame NAL units,
+				// with an IDR frame of idrFrameSize bytes every idrInterval frames
+				void Initialize(int videoFormat, int frameSize, int idrFrameSize, int slicesPerFrame, int packetSize, int idrInterval);
+
+				// Valid until the next call
+				PDECODE_UNIT NextFrame();
+
+				int GetFrameSize() const;
+
+			private:
+				SyntheticVideoStream(const SyntheticVideoStream&) = delete;
+				SyntheticVideoStream& operator=(const SyntheticVideoStream&) = delete;
+
+				// Appends a start code, the NAL unit header and length bytes of payload
+				// starting with firstByte, or with a random byte if it is 0
+				void AppendNalUnit(std::vector<char>& data, int nalType, unsigned char firstByte, int length);
+
+				void BuildFrame(bool idr, std::vector<char>& data, std::vector<LENTRY>& entries);
+
+				int m_VideoFormat;
+				int m_FrameSize;
+				int m_IdrFrameSize;
+				int m_SlicesPerFrame;
+				int m_PacketSize;
+				int m_IdrInterval;
+				int m_FrameNumber;
+				unsigned int m_Seed;
+
+				std::vector<char> m_IdrData;
+				std::vector<LENTRY> m_IdrEntries;
+				std::vector<char> m_PFrameData;
+				std::vector<LENTRY> m_PFrameEntries;
+				DECODE_UNIT m_DecodeUnit;
+			};
+
+			// The Opus multistream layouts GFE uses for stereo, 5.1 and 7.1
+			bool GetOpusConfiguration(int channelCount, int samplesPerFrame, POPUS_MULTISTREAM_CONFIGURATION opusConfig);
+
+			int GetAudioConfiguration(int channelCount);
+
+			// Opus packets encoded ahead of time from a tone on every channel, each
+			// channel at its own pitch so a mixed-up channel order is audible in the PCM
+			class SyntheticAudioStream
+			{
+			public:
+				SyntheticAudioStream();
+
+				// Returns false if the encoder rejects the configuration
+				bool Initialize(const OPUS_MULTISTREAM_CONFIGURATION& opusConfig, int packetCount);
+
+				int GetPacketCount() const;
+
+				const char* GetPacket(int index, int* length) const;
+
+				// The PCM that was encoded into the packet, interleaved in stream channel order
+				const float* GetSourcePcm(int index) const;
+
+				long long GetEncodedBytes() const;
+
+			private:
+				int m_ChannelCount;
+				int m_SamplesPerFrame;
+				std::vector<char> m_Data;
+				std::vector<int> m_Offsets;
+				std::vector<float> m_SourcePcm;
+			};
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "BenchmarkHarness.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Each returns false if a selected benchmark couldn't run
+
+			// StreamingSession::SubmitDecodeUnit on each of its delivery paths
+			bool RunVideoBenchmarks(const BenchmarkOptions& options);
+
+			// FrameBufferPool replaying synthetic decode units, against a malloc per frame
+			bool RunPoolBenchmarks(const BenchmarkOptions& options);
+
+			// StreamingSession::DecodeAndPlayAudioSample for each output format and layout
+			bool RunAudioBenchmarks(const BenchmarkOptions& options);
+
+			// The audio sample kernels against their portable scalar versions
+			bool RunAudioKernelBenchmarks(const BenchmarkOptions& options);
+
+			// StreamingSession::LogMessage, as moonlight-common-c's log callback calls it
+			bool RunLogBenchmarks(const BenchmarkOptions& options);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Benchmarks.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+#define DEFAULT_ITERATIONS 20000
+#define DEFAULT_WARMUP_ITERATIONS 500
+
+static void PrintUsage(const char* program)
+{
+	fprintf(stderr,
+		"Usage: %s [--iterations N] [--warmup N] [--filter TEXT]\n"
+		"Feeds synthetic decode units, Opus packets and log messages through the\n"
+		"streaming core into null renderers and reports throughput, bytes copied,\n"
+		"heap allocations and per-call latency.\n",
+		program);
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+	options.Iterations = DEFAULT_ITERATIONS;
+	options.WarmupIterations = DEFAULT_WARMUP_ITERATIONS;
+	options.Filter = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+		{
+			options.Iterations = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+		{
+			options.WarmupIterations = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			options.Filter = argv[++i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (options.Iterations <= 0 || options.WarmupIterations < 0)
+	{
+		PrintUsage(argv[0]);
+		return 2;
+	}
+
+	bool succeeded = RunVideoBenchmarks(options);
+	succeeded &= RunPoolBenchmarks(options);
+	succeeded &= RunAudioBenchmarks(options);
+	succeeded &= RunAudioKernelBenchmarks(options);
+	succeeded &= RunLogBenchmarks(options);
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+// The subset of moonlight-common-c's Limelight.h that the portable streaming core
+// uses, so it can be built and benchmarked without the submodule or a host. The
+// values and layouts match the pinned revision. LimelightStub.cpp implements the
+// few functions the core calls.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STAGE_NONE 0
+#define STAGE_PLATFORM_INIT 1
+#define STAGE_NAME_RESOLUTION 2
+#define STAGE_RTSP_HANDSHAKE 3
+#define STAGE_CONTROL_STREAM_INIT 4
+#define STAGE_VIDEO_STREAM_INIT 5
+#define STAGE_AUDIO_STREAM_INIT 6
+#define STAGE_INPUT_STREAM_INIT 7
+#define STAGE_CONTROL_STREAM_START 8
+#define STAGE_VIDEO_STREAM_START 9
+#define STAGE_AUDIO_STREAM_START 10
+#define STAGE_INPUT_STREAM_START 11
+#define STAGE_MAX 12
+
+#define BUFFER_TYPE_PICDATA 0x00
+#define BUFFER_TYPE_SPS 0x01
+#define BUFFER_TYPE_PPS 0x02
+#define BUFFER_TYPE_VPS 0x03
+
+#define FRAME_TYPE_PFRAME 0x00
+#define FRAME_TYPE_IDR 0x01
+
+#define DR_OK 0
+#define DR_NEED_IDR -1
+
+#define VIDEO_FORMAT_H264 0x0001
+#define VIDEO_FORMAT_H265 0x0100
+#define VIDEO_FORMAT_H265_MAIN10 0x0200
+#define VIDEO_FORMAT_MASK_H264 0x00FF
+#define VIDEO_FORMAT_MASK_H265 0xFF00
+
+#define CAPABILITY_DIRECT_SUBMIT 0x1
+#define CAPABILITY_REFERENCE_FRAME_INVALIDATION_AVC 0x2
+#define CAPABILITY_REFERENCE_FRAME_INVALIDATION_HEVC 0x4
+#define CAPABILITY_SLICES_PER_FRAME(x) (((unsigned char)(x)) << 24)
+
+#define MAKE_AUDIO_CONFIGURATION(channelCount, channelMask) \
+	(((channelMask) << 16) | (channelCount << 8) | 0xCA)
+#define AUDIO_CONFIGURATION_STEREO MAKE_AUDIO_CONFIGURATION(2, 0x3)
+#define AUDIO_CONFIGURATION_51_SURROUND MAKE_AUDIO_CONFIGURATION(6, 0x3F)
+#define AUDIO_CONFIGURATION_71_SURROUND MAKE_AUDIO_CONFIGURATION(8, 0x63F)
+
+typedef struct _LENTRY
+{
+	struct _LENTRY* next;
+	char* data;
+	int length;
+	int bufferType;
+} LENTRY, *PLENTRY;
+
+typedef struct _DECODE_UNIT
+{
+	int frameNumber;
+	int frameType;
+	unsigned long long receiveTimeMs;
+	int fullLength;
+	PLENTRY bufferList;
+} DECODE_UNIT, *PDECODE_UNIT;
+
+typedef struct _STREAM_CONFIGURATION
+{
+	int width;
+	int height;
+	int fps;
+	int bitrate;
+	int packetSize;
+	int streamingRemotely;
+	int audioConfiguration;
+	int supportsHevc;
+	int enableHdr;
+	int hevcBitratePercentageMultiplier;
+	int clientRefreshRateX100;
+	char remoteInputAesKey[16];
+	char remoteInputAesIv[16];
+} STREAM_CONFIGURATION, *PSTREAM_CONFIGURATION;
+
+typedef struct _OPUS_MULTISTREAM_CONFIGURATION
+{
+	int sampleRate;
+	int channelCount;
+	int streams;
+	int coupledStreams;
+	int samplesPerFrame;
+	unsigned char mapping[8];
+} OPUS_MULTISTREAM_CONFIGURATION, *POPUS_MULTISTREAM_CONFIGURATION;
+
+typedef int(*DecoderRendererSetup)(int videoFormat, int width, int height, int redrawRate, void* context, int drFlags);
+typedef void(*DecoderRendererStart)(void);
+typedef void(*DecoderRendererStop)(void);
+typedef void(*DecoderRendererCleanup)(void);
+typedef int(*DecoderRendererSubmitDecodeUnit)(PDECODE_UNIT decodeUnit);
+
+typedef struct _DECODER_RENDERER_CALLBACKS
+{
+	DecoderRendererSetup setup;
+	DecoderRendererStart start;
+	DecoderRendererStop stop;
+	DecoderRendererCleanup cleanup;
+	DecoderRendererSubmitDecodeUnit submitDecodeUnit;
+	int capabilities;
+} DECODER_RENDERER_CALLBACKS, *PDECODER_RENDERER_CALLBACKS;
+
+typedef int(*AudioRendererInit)(int audioConfiguration, const POPUS_MULTISTREAM_CONFIGURATION opusConfig, void* context, int arFlags);
+typedef void(*AudioRendererStart)(void);
+typedef void(*AudioRendererStop)(void);
+typedef void(*AudioRendererCleanup)(void);
+typedef void(*AudioRendererDecodeAndPlaySample)(char* sampleData, int sampleLength);
+
+typedef struct _AUDIO_RENDERER_CALLBACKS
+{
+	AudioRendererInit init;
+	AudioRendererStart start;
+	AudioRendererStop stop;
+	AudioRendererCleanup cleanup;
+	AudioRendererDecodeAndPlaySample decodeAndPlaySample;
+	int capabilities;
+} AUDIO_RENDERER_CALLBACKS, *PAUDIO_RENDERER_CALLBACKS;
+
+typedef void(*ConnListenerStageStarting)(int stage);
+typedef void(*ConnListenerStageComplete)(int stage);
+typedef void(*ConnListenerStageFailed)(int stage, long errorCode);
+typedef void(*ConnListenerConnectionStarted)(void);
+typedef void(*ConnListenerConnectionTerminated)(long errorCode);
+typedef void(*ConnListenerDisplayMessage)(const char* message);
+typedef void(*ConnListenerDisplayTransientMessage)(const char* message);
+typedef void(*ConnListenerLogMessage)(const char* format, ...);
+
+typedef struct _CONNECTION_LISTENER_CALLBACKS
+{
+	ConnListenerStageStarting stageStarting;
+	ConnListenerStageComplete stageComplete;
+	ConnListenerStageFailed stageFailed;
+	ConnListenerConnectionStarted connectionStarted;
+	ConnListenerConnectionTerminated connectionTerminated;
+	ConnListenerDisplayMessage displayMessage;
+	ConnListenerDisplayTransientMessage displayTransientMessage;
+	ConnListenerLogMessage logMessage;
+} CONNECTION_LISTENER_CALLBACKS, *PCONNECTION_LISTENER_CALLBACKS;
+
+void LiInitializeStreamConfiguration(PSTREAM_CONFIGURATION streamConfig);
+
+void LiInitializeVideoCallbacks(PDECODER_RENDERER_CALLBACKS drCallbacks);
+
+void LiInitializeAudioCallbacks(PAUDIO_RENDERER_CALLBACKS arCallbacks);
+
+void LiInitializeConnectionCallbacks(PCONNECTION_LISTENER_CALLBACKS clCallbacks);
+
+const char* LiGetStageName(int stage);
+
+unsigned long long LiGetMillis(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,69 @@
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include "Limelight.h"
+#include "BenchmarkHarness.h"
+
+// Stands in for the parts of moonlight-common-c the streaming core calls. No
+// connection is ever made, so the callback tables are only zeroed.
+
+static std::atomic<long long> s_FrameLossReports(0);
+
+void LiInitializeStreamConfiguration(PSTREAM_CONFIGURATION streamConfig)
+{
+	memset(streamConfig, 0, sizeof(*streamConfig));
+}
+
+void LiInitializeVideoCallbacks(PDECODER_RENDERER_CALLBACKS drCallbacks)
+{
+	memset(drCallbacks, 0, sizeof(*drCallbacks));
+}
+
+void LiInitializeAudioCallbacks(PAUDIO_RENDERER_CALLBACKS arCallbacks)
+{
+	memset(arCallbacks, 0, sizeof(*arCallbacks));
+}
+
+void LiInitializeConnectionCallbacks(PCONNECTION_LISTENER_CALLBACKS clCallbacks)
+{
+	memset(clCallbacks, 0, sizeof(*clCallbacks));
+}
+
+const char* LiGetStageName(int stage)
+{
+	static const char* const s_StageNames[STAGE_MAX] =
+	{
+		"none",
+		"platform initialization",
+		"name resolution",
+		"RTSP handshake",
+		"control stream initialization",
+		"video stream initialization",
+		"audio stream initialization",
+		"input stream initialization",
+		"control stream establishment",
+		"video stream establishment",
+		"audio stream establishment",
+		"input stream establishment",
+	};
+
+	return stage >= 0 && stage < STAGE_MAX ? s_StageNames[stage] : "unknown";
+}
+
+unsigned long long LiGetMillis(void)
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+extern "C" void connectionDetectedFrameLoss(int startFrame, int endFrame)
+{
+	(void)startFrame;
+	(void)endFrame;
+	s_FrameLossReports++;
+}
+
+long long Moonlight::Xbox::Interop::GetFrameLossReports()
+{
+	return s_FrameLossReports;
+}
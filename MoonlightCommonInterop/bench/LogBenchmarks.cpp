@@ -0,0 +1,73 @@
+#include <stdarg.h>
+#include "Benchmarks.h"
+#include "NullRenderers.h"
+#include "StreamingSession.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Shaped like moonlight-common-c's chattier messages. Each format string is its
+// own call site as far as the logger's rate limiting goes.
+static const char* const s_LogFormats[] =
+{
+	"Received first video packet after %d ms\n",
+	"Network dropped audio data (expected %d, but received %d)\n",
+	"Unrecoverable frame %d: %d+%d=%d received < %d needed\n",
+	"Waiting for IDR frame\n",
+};
+
+static void LogMessage(StreamingSession& session, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	session.LogMessage(format, args);
+	va_end(args);
+}
+
+static void RunLogBenchmark(const BenchmarkOptions& options, const char* name, int callSites)
+{
+	StreamingSession session(
+		GetBenchmarkSessionConfiguration(),
+		new NullVideoRenderer(0),
+		new NullAudioRenderer(0, 0, 1),
+		new NullConnectionListener());
+
+	for (int i = 0; i < options.WarmupIterations; i++)
+	{
+		LogMessage(session, s_LogFormats[i % callSites], i, i + 1, 2, 3, 4);
+	}
+
+	LatencyHistogram latency;
+	BenchmarkTimer timer;
+	timer.Start();
+	for (int i = 0; i < options.Iterations; i++)
+	{
+		long long startNs = GetTimeNanoseconds();
+		LogMessage(session, s_LogFormats[i % callSites], i, i + 1, 2, 3, 4);
+		latency.Record(GetTimeNanoseconds() - startNs);
+	}
+	timer.Stop();
+
+	BenchmarkResult result;
+	result.ItemName = "message";
+	result.Items = options.Iterations;
+	result.ElapsedNs = timer.GetElapsedNs();
+	result.BytesCopied = 0;
+	result.Allocations = timer.GetAllocations();
+	result.Notes = NULL;
+	PrintBenchmarkResult(stdout, name, result, latency);
+}
+
+bool Moonlight::Xbox::Interop::RunLogBenchmarks(const BenchmarkOptions& options)
+{
+	if (IsBenchmarkSelected(options, "log/one-call-site"))
+	{
+		RunLogBenchmark(options, "log/one-call-site", 1);
+	}
+
+	if (IsBenchmarkSelected(options, "log/four-call-sites"))
+	{
+		RunLogBenchmark(options, "log/four-call-sites", 4);
+	}
+
+	return true;
+}
@@ -0,0 +1,263 @@
+#include <limits.h>
+#include <string.h>
+#include "BenchmarkHarness.h"
+#include "NullRenderers.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+NullVideoRenderer::NullVideoRenderer(int capabilities)
+	: m_Capabilities(capabilities),
+	m_Frames(0),
+	m_Bytes(0),
+	m_NalUnits(0)
+{
+}
+
+int NullVideoRenderer::GetCapabilities()
+{
+	return m_Capabilities;
+}
+
+int NullVideoRenderer::Initialize(int videoFormat, int width, int height, int redrawRate)
+{
+	(void)videoFormat;
+	(void)width;
+	(void)height;
+	(void)redrawRate;
+	return 0;
+}
+
+void NullVideoRenderer::Start()
+{
+}
+
+void NullVideoRenderer::Stop()
+{
+}
+
+void NullVideoRenderer::Cleanup()
+{
+}
+
+int NullVideoRenderer::HandleFrame(const char* frameData, int length, int frameType, int frameNumber, long long receiveTimeMs)
+{
+	(void)frameData;
+	(void)frameType;
+	(void)frameNumber;
+	(void)receiveTimeMs;
+	m_Frames++;
+	m_Bytes += length;
+	return 0;
+}
+
+int NullVideoRenderer::HandleFrameBufferList(const NativeBufferView* buffers, int count, int frameType, int frameNumber, long long receiveTimeMs)
+{
+	(void)frameType;
+	(void)frameNumber;
+	(void)receiveTimeMs;
+	long long bytes = 0;
+	for (int i = 0; i < count; i++)
+	{
+		bytes += buffers[i].Length;
+	}
+
+	m_Frames++;
+	m_Bytes += bytes;
+	return 0;
+}
+
+void NullVideoRenderer::HandleFrameDescriptor(const NativeFrameDescriptor& descriptor)
+{
+	m_NalUnits += descriptor.NalUnitCount;
+}
+
+long long NullVideoRenderer::GetFrames() const
+{
+	return m_Frames;
+}
+
+long long NullVideoRenderer::GetBytes() const
+{
+	return m_Bytes;
+}
+
+long long NullVideoRenderer::GetNalUnits() const
+{
+	return m_NalUnits;
+}
+
+NullAudioRenderer::NullAudioRenderer(int capabilities, int outputSampleRate, int maxFramesPerSubmission)
+	: m_Capabilities(capabilities),
+	m_OutputSampleRate(outputSampleRate),
+	m_MaxFramesPerSubmission(maxFramesPerSubmission),
+	m_AudioConfiguration(0),
+	m_CaptureBuffer(NULL),
+	m_CaptureCapacity(0),
+	m_CapturedBytes(0),
+	m_CallCostNs(0),
+	m_Calls(0),
+	m_Bytes(0),
+	m_MinLength(INT_MAX),
+	m_MaxLength(0)
+{
+}
+
+int NullAudioRenderer::GetCapabilities()
+{
+	return m_Capabilities;
+}
+
+int NullAudioRenderer::GetOutputSampleRate()
+{
+	return m_OutputSampleRate;
+}
+
+int NullAudioRenderer::GetMaxFramesPerSubmission()
+{
+	return m_MaxFramesPerSubmission;
+}
+
+int NullAudioRenderer::Initialize(int audioFormat)
+{
+	m_AudioConfiguration = audioFormat;
+	return 0;
+}
+
+void NullAudioRenderer::Start()
+{
+}
+
+void NullAudioRenderer::Stop()
+{
+}
+
+void NullAudioRenderer::Cleanup()
+{
+}
+
+void NullAudioRenderer::HandleFrame(const char* frameData, int length)
+{
+	if (m_CallCostNs > 0)
+	{
+		long long endNs = GetTimeNanoseconds() + m_CallCostNs;
+		while (GetTimeNanoseconds() < endNs)
+		{
+		}
+	}
+
+	// Calls never overlap, so the bounds needn't be updated atomically
+	m_Calls++;
+	m_Bytes += length;
+	if (length < m_MinLength)
+	{
+		m_MinLength = length;
+	}
+	if (length > m_MaxLength)
+	{
+		m_MaxLength = length;
+	}
+
+	int captureLength = m_CaptureCapacity - m_CapturedBytes;
+	if (captureLength > length)
+	{
+		captureLength = length;
+	}
+	if (captureLength > 0)
+	{
+		memcpy(&m_CaptureBuffer[m_CapturedBytes], frameData, captureLength);
+		m_CapturedBytes += captureLength;
+	}
+}
+
+void NullAudioRenderer::SetCaptureBuffer(char* buffer, int capacity)
+{
+	m_CaptureBuffer = buffer;
+	m_CaptureCapacity = capacity;
+	m_CapturedBytes = 0;
+}
+
+void NullAudioRenderer::SetCallCost(long long callCostNs)
+{
+	m_CallCostNs = callCostNs;
+}
+
+int NullAudioRenderer::GetAudioConfiguration() const
+{
+	return m_AudioConfiguration;
+}
+
+long long NullAudioRenderer::GetCalls() const
+{
+	return m_Calls;
+}
+
+long long NullAudioRenderer::GetBytes() const
+{
+	return m_Bytes;
+}
+
+int NullAudioRenderer::GetMinLength() const
+{
+	return m_MinLength;
+}
+
+int NullAudioRenderer::GetMaxLength() const
+{
+	return m_MaxLength;
+}
+
+int NullAudioRenderer::GetCapturedBytes() const
+{
+	return m_CapturedBytes;
+}
+
+NullConnectionListener::NullConnectionListener()
+	: m_MessagesLogged(0)
+{
+}
+
+void NullConnectionListener::StageStarting(const char* stage)
+{
+	(void)stage;
+}
+
+void NullConnectionListener::StageComplete(const char* stage)
+{
+	(void)stage;
+}
+
+void NullConnectionListener::StageFailed(const char* stage, long errorCode)
+{
+	(void)stage;
+	(void)errorCode;
+}
+
+void NullConnectionListener::ConnectionStarted()
+{
+}
+
+void NullConnectionListener::ConnectionTerminated(long errorCode)
+{
+	(void)errorCode;
+}
+
+void NullConnectionListener::DisplayMessage(const char* message)
+{
+	(void)message;
+}
+
+void NullConnectionListener::DisplayTransientMessage(const char* message)
+{
+	(void)message;
+}
+
+void NullConnectionListener::LogMessage(const char* message)
+{
+	(void)message;
+	m_MessagesLogged++;
+}
+
+long long NullConnectionListener::GetMessagesLogged() const
+{
+	return m_MessagesLogged;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include "SessionInterfaces.h"
+
+namespace Moonlight
+{
+	namespace Xbox
+	{
+		namespace Interop
+		{
+			// Renderers and listener that accept everything and only count it, so a
+			// benchmark measures the streaming core rather than a decoder. The session
+			// owns them, so read the counters before it is destroyed.
+
+			class NullVideoRenderer : public INativeVideoRenderer
+			{
+			public:
+				NullVideoRenderer(int capabilities);
+
+				int GetCapabilities() override;
+
+				int Initialize(int videoFormat, int width, int height, int redrawRate) override;
+
+				void Start() override;
+
+				void Stop() override;
+
+				void Cleanup() override;
+
+				int HandleFrame(const char* frameData, int length, int frameType, int frameNumber, long long receiveTimeMs) override;
+
+				int HandleFrameBufferList(const NativeBufferView* buffers, int count, int frameType, int frameNumber, long long receiveTimeMs) override;
+
+				void HandleFrameDescriptor(const NativeFrameDescriptor& descriptor) override;
+
+				long long GetFrames() const;
+
+				long long GetBytes() const;
+
+				long long GetNalUnits() const;
+
+			private:
+				int m_Capabilities;
+				std::atomic<long long> m_Frames;
+				std::atomic<long long> m_Bytes;
+				std::atomic<long long> m_NalUnits;
+			};
+
+			class NullAudioRenderer : public INativeAudioRenderer
+			{
+			public:
+				// An outputSampleRate of 0 keeps the stream's rate
+				NullAudioRenderer(int capabilities, int outputSampleRate, int maxFramesPerSubmission);
+
+				int GetCapabilities() override;
+
+				int GetOutputSampleRate() override;
+
+				int GetMaxFramesPerSubmission() override;
+
+				int Initialize(int audioFormat) override;
+
+				void Start() override;
+
+				void Stop() override;
+
+				void Cleanup() override;
+
+				void HandleFrame(const char* frameData, int length) override;
+
+				// Copies everything submitted into the buffer until it's full
+				void SetCaptureBuffer(char* buffer, int capacity);
+
+				// Spins for this long in every HandleFrame, to stand in for what
+				// submitting a buffer costs a real audio API
+				void SetCallCost(long long callCostNs);
+
+				int GetAudioConfiguration() const;
+
+				long long GetCalls() const;
+
+				long long GetBytes() const;
+
+				int GetMinLength() const;
+
+				int GetMaxLength() const;
+
+				int GetCapturedBytes() const;
+
+			private:
+				int m_Capabilities;
+				int m_OutputSampleRate;
+				int m_MaxFramesPerSubmission;
+				int m_AudioConfiguration;
+				char* m_CaptureBuffer;
+				int m_CaptureCapacity;
+				int m_CapturedBytes;
+				long long m_CallCostNs;
+				std::atomic<long long> m_Calls;
+				std::atomic<long long> m_Bytes;
+				std::atomic<int> m_MinLength;
+				std::atomic<int> m_MaxLength;
+			};
+
+			class NullConnectionListener : public INativeConnectionListener
+			{
+			public:
+				NullConnectionListener();
+
+				void StageStarting(const char* stage) override;
+
+				void StageComplete(const char* stage) override;
+
+				void StageFailed(const char* stage, long errorCode) override;
+
+				void ConnectionStarted() override;
+
+				void ConnectionTerminated(long errorCode) override;
+
+				void DisplayMessage(const char* message) override;
+
+				void DisplayTransientMessage(const char* message) override;
+
+				void LogMessage(const char* message) override;
+
+				long long GetMessagesLogged() const;
+
+			private:
+				std::atomic<long long> m_MessagesLogged;
+			};
+		}
+	}
+}
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Benchmarks.h"
+#include "FrameBufferPool.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Same as VideoBenchmarks.cpp
+#define VIDEO_PACKET_PAYLOAD_SIZE 1392
+#define VIDEO_SLICES_PER_FRAME 4
+#define VIDEO_IDR_INTERVAL 120
+
+// IDR frames in GFE streams are typically several times the size of P frames
+#define POOL_IDR_FRAME_SIZE_MULTIPLIER 4
+
+#define POOL_MAX_FRAMES_HELD 8
+
+struct PoolBenchmark
+{
+	const char* Name;
+	int VideoFormat;
+	int Width;
+	int Height;
+	int Fps;
+	int BitrateKbps;
+
+	// IDR frame size, or 0 for POOL_IDR_FRAME_SIZE_MULTIPLIER times the average
+	int IdrFrameSize;
+
+	// Buffers in the pool, and frames the renderer holds on to at once
+	int BufferCount;
+	int FramesHeld;
+
+	// Allocate and free every frame instead, as a baseline for the pool
+	bool MallocPerFrame;
+};
+
+static const PoolBenchmark s_PoolBenchmarks[] =
+{
+	{ "pool/1080p/h264", VIDEO_FORMAT_H264, 1920, 1080, 60, 20000, 0, 2, 1, false },
+	{ "pool/1080p/h264/decode-queue", VIDEO_FORMAT_H264, 1920, 1080, 60, 20000, 0, 4, 3, false },
+	{ "pool/4k/hevc", VIDEO_FORMAT_H265, 3840, 2160, 60, 80000, 0, 2, 1, false },
+	{ "pool/4k/hevc/malloc-per-frame", VIDEO_FORMAT_H265, 3840, 2160, 60, 80000, 0, 2, 1, true },
+
+	// IDR frames bigger than the pool's estimate, which grow the buffers once
+	{ "pool/4k/hevc/oversized-idr", VIDEO_FORMAT_H265, 3840, 2160, 60, 80000, 4 * 1024 * 1024, 2, 1, false },
+
+	// A renderer holding more frames than the pool has buffers
+	{ "pool/4k/hevc/exhausted", VIDEO_FORMAT_H265, 3840, 2160, 60, 80000, 0, 2, 3, false },
+};
+
+// Acquires a buffer for the decode unit and copies it in, as StreamingSession's copy path does
+static FrameBuffer* CopyDecodeUnit(FrameBufferPool& pool, const PoolBenchmark& benchmark, PDECODE_UNIT decodeUnit)
+{
+	FrameBuffer* buffer;
+	if (benchmark.MallocPerFrame)
+	{
+		buffer = new FrameBuffer();
+		buffer->Data = (char*)malloc(decodeUnit->fullLength);
+		buffer->Capacity = decodeUnit->fullLength;
+		buffer->Pooled = false;
+	}
+	else
+	{
+		buffer = pool.Acquire(decodeUnit->fullLength);
+	}
+
+	int offset = 0;
+	for (PLENTRY entry = decodeUnit->bufferList; entry != NULL; entry = entry->next)
+	{
+		memcpy(buffer->Data + offset, entry->data, entry->length);
+		offset += entry->length;
+	}
+
+	return buffer;
+}
+
+static void ReleaseBuffer(FrameBufferPool& pool, const PoolBenchmark& benchmark, FrameBuffer* buffer)
+{
+	if (benchmark.MallocPerFrame)
+	{
+		free(buffer->Data);
+		delete buffer;
+	}
+	else
+	{
+		pool.Release(buffer);
+	}
+}
+
+// Each iteration hands the renderer a frame and takes back the oldest one it holds
+static void ReplayFrame(FrameBufferPool& pool, const PoolBenchmark& benchmark, PDECODE_UNIT decodeUnit,
+	FrameBuffer** heldFrames, int& heldCount)
+{
+	if (heldCount == benchmark.FramesHeld)
+	{
+		ReleaseBuffer(pool, benchmark, heldFrames[0]);
+		memmove(heldFrames, heldFrames + 1, (heldCount - 1) * sizeof(FrameBuffer*));
+		heldCount--;
+	}
+
+	heldFrames[heldCount++] = CopyDecodeUnit(pool, benchmark, decodeUnit);
+}
+
+static bool RunPoolBenchmark(const BenchmarkOptions& options, const PoolBenchmark& benchmark)
+{
+	FrameBufferPool pool;
+	if (!pool.Initialize(benchmark.Width, benchmark.Height, benchmark.Fps, benchmark.BitrateKbps, benchmark.BufferCount))
+	{
+		fprintf(stderr, "%s: couldn't allocate the pool\n", benchmark.Name);
+		return false;
+	}
+
+	int frameSize = benchmark.BitrateKbps * 1000 / 8 / benchmark.Fps;
+	int idrFrameSize = benchmark.IdrFrameSize != 0 ? benchmark.IdrFrameSize : frameSize * POOL_IDR_FRAME_SIZE_MULTIPLIER;
+	SyntheticVideoStream stream;
+	stream.Initialize(
+		benchmark.VideoFormat,
+		frameSize,
+		idrFrameSize,
+		VIDEO_SLICES_PER_FRAME,
+		VIDEO_PACKET_PAYLOAD_SIZE,
+		VIDEO_IDR_INTERVAL);
+
+	FrameBuffer* heldFrames[POOL_MAX_FRAMES_HELD];
+	int heldCount = 0;
+	for (int i = 0; i < options.WarmupIterations; i++)
+	{
+		ReplayFrame(pool, benchmark, stream.NextFrame(), heldFrames, heldCount);
+	}
+
+	LatencyHistogram latency;
+	BenchmarkTimer timer;
+	long long bytesCopied = 0;
+	timer.Start();
+	for (int i = 0; i < options.Iterations; i++)
+	{
+		PDECODE_UNIT decodeUnit = stream.NextFrame();
+		long long startNs = GetTimeNanoseconds();
+		ReplayFrame(pool, benchmark, decodeUnit, heldFrames, heldCount);
+		latency.Record(GetTimeNanoseconds() - startNs);
+		bytesCopied += decodeUnit->fullLength;
+	}
+	timer.Stop();
+
+	while (heldCount > 0)
+	{
+		ReleaseBuffer(pool, benchmark, heldFrames[--heldCount]);
+	}
+
+	// Counted from the first frame, so buffers grown during warmup still show
+	char notes[128];
+	snprintf(notes, sizeof(notes), "%lld hits, %lld misses in %d frames, %d KB buffers",
+		pool.GetHitCount(),
+		pool.GetMissCount(),
+		options.WarmupIterations + options.Iterations,
+		pool.GetBufferSize() / 1024);
+
+	BenchmarkResult result;
+	result.ItemName = "frame";
+	result.Items = options.Iterations;
+	result.ElapsedNs = timer.GetElapsedNs();
+	result.BytesCopied = bytesCopied;
+	result.Allocations = timer.GetAllocations();
+	result.Notes = benchmark.MallocPerFrame ? NULL : notes;
+	PrintBenchmarkResult(stdout, benchmark.Name, result, latency);
+
+	pool.Cleanup();
+	return true;
+}
+
+bool Moonlight::Xbox::Interop::RunPoolBenchmarks(const BenchmarkOptions& options)
+{
+	bool succeeded = true;
+	for (const PoolBenchmark& benchmark : s_PoolBenchmarks)
+	{
+		if (IsBenchmarkSelected(options, benchmark.Name) && !RunPoolBenchmark(options, benchmark))
+		{
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}
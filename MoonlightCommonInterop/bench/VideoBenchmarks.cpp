@@ -0,0 +1,143 @@
+#include <thread>
+#include "Benchmarks.h"
+#include "NullRenderers.h"
+#include "StreamingSession.h"
+
+using namespace Moonlight::Xbox::Interop;
+
+// Same values as VideoRendererCapabilities
+#define VIDEO_CAPABILITY_SCATTER_GATHER 0x10000
+#define VIDEO_CAPABILITY_FRAME_DESCRIPTORS 0x40000
+#define VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_4 0x80000
+#define VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_2 0x100000
+
+// Payload moonlight-common-c packs into each video packet at its default packet size
+#define VIDEO_PACKET_PAYLOAD_SIZE 1392
+
+#define VIDEO_SLICES_PER_FRAME 4
+
+// Two seconds at 60 fps, about what GFE's default GOP works out to
+#define VIDEO_IDR_INTERVAL 120
+
+#define VIDEO_DRAIN_TIMEOUT_NS 1000000000LL
+
+struct VideoBenchmark
+{
+	const char* Name;
+	int VideoFormat;
+	int Capabilities;
+	int DecodeQueueDepth;
+
+	// 0 for the harness's 1080p60 defaults
+	int Width;
+	int Height;
+	int BitrateKbps;
+};
+
+static const VideoBenchmark s_VideoBenchmarks[] =
+{
+	{ "video/h264/copy", VIDEO_FORMAT_H264, 0, 0, 0, 0, 0 },
+	{ "video/h264/scatter-gather", VIDEO_FORMAT_H264, VIDEO_CAPABILITY_SCATTER_GATHER, 0, 0, 0, 0 },
+	{ "video/h264/frame-descriptors", VIDEO_FORMAT_H264, VIDEO_CAPABILITY_FRAME_DESCRIPTORS, 0, 0, 0, 0 },
+	{ "video/h264/decode-queue", VIDEO_FORMAT_H264, 0, 2, 0, 0, 0 },
+	{ "video/hevc/copy", VIDEO_FORMAT_H265, 0, 0, 0, 0, 0 },
+	{ "video/hevc/scatter-gather", VIDEO_FORMAT_H265, VIDEO_CAPABILITY_SCATTER_GATHER, 0, 0, 0, 0 },
+	{ "video/hevc-4k/annex-b", VIDEO_FORMAT_H265, 0, 0, 3840, 2160, 80000 },
+	{ "video/hevc-4k/length-prefix-4", VIDEO_FORMAT_H265, VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_4, 0, 3840, 2160, 80000 },
+	{ "video/hevc-4k/length-prefix-2", VIDEO_FORMAT_H265, VIDEO_CAPABILITY_NAL_LENGTH_PREFIX_2, 0, 3840, 2160, 80000 },
+};
+
+static bool RunVideoBenchmark(const BenchmarkOptions& options, const VideoBenchmark& benchmark)
+{
+	StreamingSessionConfiguration configuration = GetBenchmarkSessionConfiguration();
+	configuration.VideoDecodeQueueDepth = benchmark.DecodeQueueDepth;
+	if (benchmark.Width != 0)
+	{
+		configuration.Width = benchmark.Width;
+		configuration.Height = benchmark.Height;
+		configuration.Bitrate = benchmark.BitrateKbps;
+	}
+
+	NullVideoRenderer* videoRenderer = new NullVideoRenderer(benchmark.Capabilities);
+	StreamingSession session(
+		configuration,
+		videoRenderer,
+		new NullAudioRenderer(0, 0, 1),
+		new NullConnectionListener());
+	if (session.SetupVideo(benchmark.VideoFormat, configuration.Width, configuration.Height, configuration.Fps) != 0)
+	{
+		fprintf(stderr, "%s: SetupVideo failed\n", benchmark.Name);
+		return false;
+	}
+
+	int frameSize = configuration.Bitrate * 1000 / 8 / configuration.Fps;
+	SyntheticVideoStream stream;
+	stream.Initialize(
+		benchmark.VideoFormat,
+		frameSize,
+		frameSize,
+		VIDEO_SLICES_PER_FRAME,
+		VIDEO_PACKET_PAYLOAD_SIZE,
+		VIDEO_IDR_INTERVAL);
+
+	session.StartVideo();
+	for (int i = 0; i < options.WarmupIterations; i++)
+	{
+		session.SubmitDecodeUnit(stream.NextFrame());
+	}
+
+	LatencyHistogram latency;
+	BenchmarkTimer timer;
+	long long bytesCopied = session.GetVideoBytesCopied();
+	timer.Start();
+	for (int i = 0; i < options.Iterations; i++)
+	{
+		PDECODE_UNIT decodeUnit = stream.NextFrame();
+		long long startNs = GetTimeNanoseconds();
+		session.SubmitDecodeUnit(decodeUnit);
+		latency.Record(GetTimeNanoseconds() - startNs);
+	}
+	timer.Stop();
+
+	// Stopping discards whatever is still queued, which with short runs can be
+	// everything if the decode thread hasn't been scheduled yet
+	long long drainDeadlineNs = GetTimeNanoseconds() + VIDEO_DRAIN_TIMEOUT_NS;
+	while (session.GetVideoDecodeQueue().GetOccupancy() > 0 && GetTimeNanoseconds() < drainDeadlineNs)
+	{
+		std::this_thread::yield();
+	}
+
+	session.StopVideo();
+	session.CleanupVideo();
+
+	BenchmarkResult result;
+	result.ItemName = "frame";
+	result.Items = options.Iterations;
+	result.ElapsedNs = timer.GetElapsedNs();
+	result.BytesCopied = session.GetVideoBytesCopied() - bytesCopied;
+	result.Allocations = timer.GetAllocations();
+	result.Notes = NULL;
+	PrintBenchmarkResult(stdout, benchmark.Name, result, latency);
+
+	if (videoRenderer->GetFrames() == 0)
+	{
+		fprintf(stderr, "%s: no frames reached the renderer\n", benchmark.Name);
+		return false;
+	}
+
+	return true;
+}
+
+bool Moonlight::Xbox::Interop::RunVideoBenchmarks(const BenchmarkOptions& options)
+{
+	bool succeeded = true;
+	for (const VideoBenchmark& benchmark : s_VideoBenchmarks)
+	{
+		if (IsBenchmarkSelected(options, benchmark.Name) && !RunVideoBenchmark(options, benchmark))
+		{
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}